@@ -0,0 +1,151 @@
+/* Arduino SdFat Library
+ * Copyright (C) 2012 by William Greiman
+ *
+ * This file is part of the Arduino SdFat Library
+ *
+ * This Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Arduino SdFat Library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#include "SdCardArray.h"
+//------------------------------------------------------------------------------
+bool SdCardArray::begin(SdSpiCard* const* cards, uint8_t count,
+                        uint8_t mode, uint8_t part) {
+  uint32_t size = 0XFFFFFFFF;
+  if (count == 0 || mode > ARRAY_MIRROR) {
+    goto fail;
+  }
+  for (uint8_t i = 0; i < count; i++) {
+    uint32_t n = cards[i]->cardSize();
+    if (n == 0) {
+      goto fail;
+    }
+    if (n < size) {
+      size = n;
+    }
+  }
+  m_cards = cards;
+  m_cardCount = count;
+  m_mode = mode;
+  m_readCard = 0;
+  m_blockCount = mode == ARRAY_STRIPE ? size*count : size;
+  return FatFileSystem::begin(part);
+
+fail:
+  m_cardCount = 0;
+  return false;
+}
+//------------------------------------------------------------------------------
+bool SdCardArray::isBusy() {
+  for (uint8_t i = 0; i < m_cardCount; i++) {
+    if (m_cards[i]->isBusy()) {
+      return true;
+    }
+  }
+  return false;
+}
+//------------------------------------------------------------------------------
+bool SdCardArray::readBlock(uint32_t block, uint8_t* dst) {
+  if (m_mode == ARRAY_STRIPE) {
+    return m_cards[block % m_cardCount]->readBlock(block/m_cardCount, dst);
+  }
+  // Try each mirror, starting with the last one that worked.
+  for (uint8_t i = 0; i < m_cardCount; i++) {
+    if (m_cards[m_readCard]->readBlock(block, dst)) {
+      return true;
+    }
+    if (++m_readCard >= m_cardCount) {
+      m_readCard = 0;
+    }
+  }
+  return false;
+}
+//------------------------------------------------------------------------------
+#if SD_READ_SINK_SIZE
+bool SdCardArray::readBlockSink(uint32_t block,
+                                readSink_t sink, void* context) {
+  // The sink may have seen part of the block so mirrors are not retried.
+  if (m_mode == ARRAY_STRIPE) {
+    return m_cards[block % m_cardCount]->readBlock(block/m_cardCount,
+                                                   sink, context);
+  }
+  return m_cards[m_readCard]->readBlock(block, sink, context);
+}
+#endif  // SD_READ_SINK_SIZE
+//------------------------------------------------------------------------------
+bool SdCardArray::readBlocks(uint32_t block, uint8_t* dst, size_t n) {
+  if (m_mode == ARRAY_MIRROR) {
+    if (m_cards[m_readCard]->readBlocks(block, dst, n)) {
+      return true;
+    }
+  }
+  // Block at a time keeps a read sequence open on each card.
+  for (size_t i = 0; i < n; i++, dst += 512) {
+    if (!readBlock(block + i, dst)) {
+      return false;
+    }
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+bool SdCardArray::syncBlocks() {
+  bool rtn = true;
+  for (uint8_t i = 0; i < m_cardCount; i++) {
+    rtn = m_cards[i]->syncBlocks() && rtn;
+  }
+  return rtn;
+}
+//------------------------------------------------------------------------------
+bool SdCardArray::writeBlock(uint32_t block, const uint8_t* src) {
+  if (m_mode == ARRAY_STRIPE) {
+    return m_cards[block % m_cardCount]->writeBlock(block/m_cardCount, src);
+  }
+  for (uint8_t i = 0; i < m_cardCount; i++) {
+    if (!m_cards[i]->writeBlock(block, src)) {
+      return false;
+    }
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+bool SdCardArray::writeBlocks(uint32_t block, const uint8_t* src, size_t n) {
+  // Writing each block to the next card overlaps one card's programming
+  // time with the transfer to the next.  Each card continues its own open
+  // write sequence.
+  for (size_t i = 0; i < n; i++, src += 512) {
+    if (!writeBlock(block + i, src)) {
+      return false;
+    }
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+bool SdCardArray::writeStart(uint32_t block, uint32_t eraseCount) {
+  if (m_mode == ARRAY_MIRROR) {
+    for (uint8_t i = 0; i < m_cardCount; i++) {
+      if (!m_cards[i]->writeStart(block, eraseCount)) {
+        return false;
+      }
+    }
+    return true;
+  }
+  // Start each card at its first block at or after block.
+  uint32_t count = (eraseCount + m_cardCount - 1)/m_cardCount;
+  for (uint8_t i = 0; i < m_cardCount; i++) {
+    uint32_t b = block + (i + m_cardCount - block % m_cardCount) % m_cardCount;
+    if (!m_cards[b % m_cardCount]->writeStart(b/m_cardCount, count)) {
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,94 @@
+/* Arduino SdFat Library
+ * Copyright (C) 2012 by William Greiman
+ *
+ * This file is part of the Arduino SdFat Library
+ *
+ * This Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Arduino SdFat Library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#ifndef SdCardArray_h
+#define SdCardArray_h
+/**
+ * \file
+ * \brief SdCardArray class
+ */
+#include "SdSpiCard.h"
+#include "utility/FatLib.h"
+//==============================================================================
+/**
+ * \class SdCardArray
+ * \brief File system on blocks striped or mirrored across SD cards.
+ *
+ * Each card has its own chip select pin.  Blocks are written to the cards
+ * in turn so one card programs a block while the next card receives data.
+ *
+ * A striped volume must be formatted as one device of blockCount() blocks.
+ * Mirrored cards must hold identical images.
+ */
+class SdCardArray : public FatFileSystem {
+ public:
+  /** Block n is on card n % count at card block n / count. */
+  static const uint8_t ARRAY_STRIPE = 0;
+  /** Each block is written to every card and read from one card. */
+  static const uint8_t ARRAY_MIRROR = 1;
+  /** Create an instance of SdCardArray. */
+  SdCardArray() : m_cardCount(0) {}
+  /** Initialize the file system on cards that have been initialized.
+   *
+   * \param[in] cards Array of pointers to cards.  The array must remain
+   * valid while the file system is used.
+   * \param[in] count Number of cards.
+   * \param[in] mode ARRAY_STRIPE or ARRAY_MIRROR.
+   * \param[in] part Partition to initialize, zero for the first one found.
+   * \return true for success else false.
+   */
+  bool begin(SdSpiCard* const* cards, uint8_t count,
+             uint8_t mode = ARRAY_STRIPE, uint8_t part = 0);
+  /** \return The number of blocks in the array. */
+  uint32_t blockCount() const {
+    return m_blockCount;
+  }
+  /** \param[in] i Card index.
+   * \return Pointer to the card.
+   */
+  SdSpiCard* card(uint8_t i) {
+    return m_cards[i];
+  }
+  /** \return The number of cards. */
+  uint8_t cardCount() const {
+    return m_cardCount;
+  }
+  /** \return ARRAY_STRIPE or ARRAY_MIRROR. */
+  uint8_t mode() const {
+    return m_mode;
+  }
+
+ private:
+  bool readBlock(uint32_t block, uint8_t* dst);
+  bool writeBlock(uint32_t block, const uint8_t* src);
+  bool readBlocks(uint32_t block, uint8_t* dst, size_t n);
+  bool writeBlocks(uint32_t block, const uint8_t* src, size_t n);
+#if SD_READ_SINK_SIZE
+  bool readBlockSink(uint32_t block, readSink_t sink, void* context);
+#endif  // SD_READ_SINK_SIZE
+  bool syncBlocks();
+  bool isBusy();
+  bool writeStart(uint32_t block, uint32_t eraseCount);
+  SdSpiCard* const* m_cards;     // Cards in the array.
+  uint32_t m_blockCount;         // Blocks in the array.
+  uint8_t m_cardCount;           // Number of cards.
+  uint8_t m_mode;                // ARRAY_STRIPE or ARRAY_MIRROR.
+  uint8_t m_readCard;            // Mirror card for reads.
+};
+#endif  // SdCardArray_h
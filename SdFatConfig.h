@@ -28,6 +28,31 @@
 #include <avr/io.h>
 #endif  // __AVR__
 //------------------------------------------------------------------------------
+/** SD_FAT_PROFILE bit for a build without write paths. */
+#define SD_FAT_PROFILE_READ_ONLY 1
+/** SD_FAT_PROFILE bit for 8.3 file names only. */
+#define SD_FAT_PROFILE_NO_LFN 2
+/** SD_FAT_PROFILE bit for apps that use one file at a time. */
+#define SD_FAT_PROFILE_SINGLE_FILE 4
+/** SD_FAT_PROFILE bit for a cache buffer lent by the application. */
+#define SD_FAT_PROFILE_APP_CACHE 8
+/**
+ * Set SD_FAT_PROFILE to zero or more SD_FAT_PROFILE_ bits to reduce RAM
+ * and flash use, for example on an ATmega328P that drives a display.
+ * The bits replace the settings below at the end of this file.
+ *
+ * SD_FAT_PROFILE_READ_ONLY sets FAT_READ_ONLY and turns off the write
+ * buffer, lazy sync, trim and free cluster tracking.
+ *
+ * SD_FAT_PROFILE_NO_LFN sets USE_LONG_FILE_NAMES to zero.
+ *
+ * SD_FAT_PROFILE_SINGLE_FILE uses one cache block with no FAT cache,
+ * path cache, hash index or extent map.
+ *
+ * SD_FAT_PROFILE_APP_CACHE sets USE_APP_CACHE_BUFFER.
+ */
+#define SD_FAT_PROFILE 0
+//------------------------------------------------------------------------------
 /**
  * Set USE_LONG_FILE_NAMES nonzero to use long file names (LFN).
  * Long File Name are limited to a maximum length of 255 characters.
@@ -48,6 +73,13 @@
  */
 #define USE_LONG_FILE_NAMES 1
 //------------------------------------------------------------------------------
+/**
+ * Size of the name field in FatDirInfo_t records returned by
+ * FatFile::readDirInfo().  Longer names are truncated.  Must be at
+ * least 13 to hold a 8.3 name.
+ */
+#define DIR_INFO_NAME_DIM 64
+//------------------------------------------------------------------------------
 /**
  * Set ARDUINO_FILE_USES_STREAM nonzero to use Stream as the base class
  * for the Arduino File class.  If ARDUINO_FILE_USES_STREAM is zero, Print
@@ -122,6 +154,57 @@ uint8_t const SOFT_SPI_SCK_PIN = 13;
  */
 #define ENABLE_SPI_YIELD 0
 //------------------------------------------------------------------------------
+/**
+ * Set ENABLE_BUSY_CALLBACK nonzero to enable SdSpiCard::setBusyCallback().
+ * The callback is called while the card is busy programming or erasing and
+ * while waiting for read data so other tasks can run during card stalls.
+ */
+#define ENABLE_BUSY_CALLBACK 1
+//------------------------------------------------------------------------------
+/**
+ * Set ENABLE_BUS_SESSION nonzero to enable SdSpiCard::beginSession(),
+ * SdSpiCard::lendBus() and SdSpiCard::endSession().  A session keeps the
+ * SPI bus configured for the card across a batch of card operations and
+ * switches between the card and another device by restoring a few SPI
+ * registers.
+ */
+#define ENABLE_BUS_SESSION 0
+//------------------------------------------------------------------------------
+/**
+ * Set ENABLE_WARM_MOUNT nonzero to enable FatVolume::saveGeometry() and
+ * warm mount with SdFat::beginWarm().  A warm mount checks saved volume
+ * parameters with one boot sector read and skips SD card initialization
+ * if the card is still powered and in SPI mode.
+ */
+#define ENABLE_WARM_MOUNT 1
+//------------------------------------------------------------------------------
+/**
+ * Set ENABLE_ERASE_TRIM nonzero to enable erase of preallocated files by
+ * FatFile::createContiguous() and FatVolume::setTrim() to erase clusters
+ * freed by remove() and truncate().  Writes to erased blocks are faster
+ * and have more consistent latency on most cards.
+ */
+#define ENABLE_ERASE_TRIM 1
+//------------------------------------------------------------------------------
+/**
+ * HAS_SDIO_CLASS is nonzero for boards with a 4-bit SDIO socket supported
+ * by SdioCard and SdFatSdio.  Teensy 3.5 and 3.6 use the built in SDHC
+ * controller.
+ */
+#if defined(__MK64FX512__) || defined(__MK66FX1M0__)
+#define HAS_SDIO_CLASS 1
+#else  // defined(__MK64FX512__) || defined(__MK66FX1M0__)
+#define HAS_SDIO_CLASS 0
+#endif  // defined(__MK64FX512__) || defined(__MK66FX1M0__)
+//------------------------------------------------------------------------------
+/**
+ * Set ENABLE_LOCK_HOOKS nonzero for RTOS builds.  Lock hooks may then be
+ * set for the SPI bus with SdSpiCard::setBusLock(), for the cache and FAT
+ * with FatVolume::setLock() and for a file with FatFile::setLock().
+ * Locks must be recursive since calls nest.
+ */
+#define ENABLE_LOCK_HOOKS 0
+//------------------------------------------------------------------------------
 /**
  * Set FAT12_SUPPORT nonzero to enable use if FAT12 volumes.
  * FAT12 has not been well tested and requires additional flash.
@@ -135,6 +218,17 @@ uint8_t const SOFT_SPI_SCK_PIN = 13;
  */
 #define DESTRUCTOR_CLOSES_FILE 0
 //------------------------------------------------------------------------------
+/**
+ * Size of the read window in fstream and ifstream.  Characters are taken
+ * from the window instead of calling FatFile::read() for each character.
+ * Set to zero to save RAM, at most 255.
+ */
+#if defined(RAMEND) && RAMEND < 3000
+#define FSTREAM_READ_BUF_SIZE 16
+#else  // RAMEND
+#define FSTREAM_READ_BUF_SIZE 64
+#endif  // RAMEND
+//------------------------------------------------------------------------------
 /**
  * Call flush for endl if ENDL_CALLS_FLUSH is nonzero
  *
@@ -159,11 +253,27 @@ uint8_t const SOFT_SPI_SCK_PIN = 13;
  * or greater
  */
 #ifdef __AVR__
+#if F_CPU <= 8000000
+// 250 kHz, the fastest AVR rate not above the 400 kHz init limit.
+const uint8_t SPI_SCK_INIT_DIVISOR = 32;
+#else  // F_CPU <= 8000000
 const uint8_t SPI_SCK_INIT_DIVISOR = 64;
+#endif  // F_CPU <= 8000000
 #else
 const uint8_t SPI_SCK_INIT_DIVISOR = 128;
 #endif
 //------------------------------------------------------------------------------
+/**
+ * Number of test reads of block zero that must pass at a SCK divisor
+ * before begin() with SPI_AUTO_SPEED selects the divisor.  Reads are
+ * checked against a read at SPI_SCK_INIT_DIVISOR and by CRC if
+ * USE_SD_CRC is nonzero.
+ *
+ * The test reads use the read sink.  If SD_READ_SINK_SIZE is zero,
+ * SPI_AUTO_SPEED does no test reads and selects SPI_HALF_SPEED.
+ */
+const uint8_t SPI_AUTO_SPEED_READS = 4;
+//------------------------------------------------------------------------------
 /**
  * Set USE_SEPARATE_FAT_CACHE nonzero to use a second 512 byte cache
  * for FAT table entries.  This improves performance for large writes
@@ -175,6 +285,135 @@ const uint8_t SPI_SCK_INIT_DIVISOR = 128;
 #define USE_SEPARATE_FAT_CACHE 0
 #endif  // __arm__
 //------------------------------------------------------------------------------
+/**
+ * Set CACHE_BLOCK_COUNT to the number of 512 byte blocks in the volume
+ * cache.  With more than one block the cache keeps the least recently
+ * used blocks so directory, FAT and small file reads do not evict each
+ * other.  FAT blocks use the separate FAT cache if USE_SEPARATE_FAT_CACHE
+ * is nonzero.
+ */
+#ifdef __arm__
+#define CACHE_BLOCK_COUNT 4
+#else  // __arm__
+#define CACHE_BLOCK_COUNT 1
+#endif  // __arm__
+//------------------------------------------------------------------------------
+/**
+ * Set ENABLE_CACHE_STATS nonzero to count cache hits, misses, writebacks
+ * and fatGet() calls.  Use FatVolume::cacheHitCount() and
+ * FatVolume::cacheMissCount() to choose CACHE_BLOCK_COUNT.
+ */
+#define ENABLE_CACHE_STATS 0
+//------------------------------------------------------------------------------
+/**
+ * Set USE_CACHE_STORE nonzero to allow FatVolume::setCacheStore() to keep
+ * recently used blocks in a second level cache such as serial SRAM.
+ */
+#if defined(RAMEND) && RAMEND < 3000
+#define USE_CACHE_STORE 0
+#else  // RAMEND
+#define USE_CACHE_STORE 1
+#endif  // RAMEND
+//------------------------------------------------------------------------------
+/**
+ * Set USE_EXTENT_MAP nonzero to allow FatFile::setExtentMap() to map a
+ * file's cluster chain into a user supplied table.  Adds three to five
+ * bytes to each FatFile.
+ */
+#if defined(RAMEND) && RAMEND < 3000
+#define USE_EXTENT_MAP 0
+#else  // RAMEND
+#define USE_EXTENT_MAP 1
+#endif  // RAMEND
+//------------------------------------------------------------------------------
+/**
+ * Set MAINTAIN_FREE_CLUSTER_COUNT nonzero to keep a count of free
+ * clusters so FatVolume::freeClusterCount() only scans the FAT once.
+ * For FAT32 the count and next free cluster are read from the FSINFO
+ * sector at mount and written back by sync when they change.
+ */
+#if defined(RAMEND) && RAMEND < 3000
+#define MAINTAIN_FREE_CLUSTER_COUNT 0
+#else  // RAMEND
+#define MAINTAIN_FREE_CLUSTER_COUNT 1
+#endif  // RAMEND
+//------------------------------------------------------------------------------
+/**
+ * Set USE_FREE_CLUSTER_BITMAP nonzero to allow
+ * FatVolume::setFreeClusterBitmap() to give cluster allocation a user
+ * supplied bitmap of free clusters.  The bitmap covers a window of the
+ * FAT that moves as clusters are allocated.
+ */
+#if defined(RAMEND) && RAMEND < 3000
+#define USE_FREE_CLUSTER_BITMAP 0
+#else  // RAMEND
+#define USE_FREE_CLUSTER_BITMAP 1
+#endif  // RAMEND
+//------------------------------------------------------------------------------
+/**
+ * Set USE_AU_ALLOC nonzero to allow FatVolume::setAllocUnit() to align
+ * contiguous files and the growth of large files to the card's allocation
+ * unit.  SdFat::begin() reads the AU size from the SD Status register.
+ */
+#if defined(RAMEND) && RAMEND < 3000
+#define USE_AU_ALLOC 0
+#else  // RAMEND
+#define USE_AU_ALLOC 1
+#endif  // RAMEND
+//------------------------------------------------------------------------------
+/**
+ * Set USE_DIR_HASH_INDEX nonzero to allow FatVolume::setDirHashIndex()
+ * to give open() a user supplied table of name hashes for the most
+ * recently searched directory.  Requires USE_LONG_FILE_NAMES.
+ */
+#if defined(RAMEND) && RAMEND < 3000
+#define USE_DIR_HASH_INDEX 0
+#else  // RAMEND
+#define USE_DIR_HASH_INDEX 1
+#endif  // RAMEND
+//------------------------------------------------------------------------------
+/**
+ * Set PATH_CACHE_SIZE to the number of resolved directory paths kept
+ * by each volume.  An open() of a path with a cached directory prefix
+ * only searches for the last path component.  Zero disables the cache.
+ *
+ * PATH_CACHE_PATH_DIM is the longest directory prefix that is cached.
+ */
+#if defined(RAMEND) && RAMEND < 3000
+#define PATH_CACHE_SIZE 0
+#else  // RAMEND
+#define PATH_CACHE_SIZE 4
+#endif  // RAMEND
+#define PATH_CACHE_PATH_DIM 40
+//------------------------------------------------------------------------------
+/**
+ * Set USE_WRITE_BUFFER nonzero to allow FatFile::setWriteBuffer() to
+ * combine small writes into whole block writes.
+ */
+#if defined(RAMEND) && RAMEND < 3000
+#define USE_WRITE_BUFFER 0
+#else  // RAMEND
+#define USE_WRITE_BUFFER 1
+#endif  // RAMEND
+//------------------------------------------------------------------------------
+/**
+ * Set USE_FILE_PIN nonzero to allow FatFile::prefetch() to load a region
+ * of a file into a user supplied buffer.  read() then copies data in the
+ * region from the buffer.  Adds ten bytes to each FatFile.
+ */
+#if defined(RAMEND) && RAMEND < 3000
+#define USE_FILE_PIN 0
+#else  // RAMEND
+#define USE_FILE_PIN 1
+#endif  // RAMEND
+//------------------------------------------------------------------------------
+/**
+ * Set ENABLE_LAZY_SYNC nonzero to enable FatVolume::setLazySync() and
+ * FatFile::commit().  Lazy sync defers directory entry, second FAT and
+ * FSINFO writes to a commit.
+ */
+#define ENABLE_LAZY_SYNC 1
+//------------------------------------------------------------------------------
 /**
  * Set USE_MULTI_BLOCK_IO nonzero to use multi-block SD read/write.
  *
@@ -185,4 +424,113 @@ const uint8_t SPI_SCK_INIT_DIVISOR = 128;
 #else  // RAMEND
 #define USE_MULTI_BLOCK_IO 1
 #endif  // RAMEND
+//------------------------------------------------------------------------------
+/**
+ * Set USE_FAT_SCAN_BUFFER nonzero to allow FatVolume::setFatScanBuffer()
+ * to give FAT scans a user supplied buffer.  freeClusterCount() and
+ * contiguous allocation then read runs of FAT blocks with one multi-block
+ * read.  Requires USE_MULTI_BLOCK_IO.
+ */
+#define USE_FAT_SCAN_BUFFER USE_MULTI_BLOCK_IO
+//------------------------------------------------------------------------------
+/**
+ * Set ENABLE_READ_STREAMING nonzero to leave the SD card in multiple block
+ * read mode between calls to readBlock() and readBlocks().
+ *
+ * Random single block reads, such as FAT, directory and cache misses, use
+ * CMD17.  A read of the block following the last block read opens or
+ * continues a CMD18 sequence so the command and stop overhead is paid once
+ * per run of consecutive blocks instead of once per call.  The sequence is
+ * ended by a read of any other block, by any other card command, or by
+ * syncBlocks() which is called when a file is closed.
+ */
+#define ENABLE_READ_STREAMING 1
+//------------------------------------------------------------------------------
+/**
+ * Set SD_READ_SINK_SIZE to the number of bytes received from the SD card
+ * for each call to a FatFile::read() sink when a whole block is read.
+ * SD_READ_SINK_SIZE must divide 512 and is allocated on the stack.
+ *
+ * The sink is called with the SD card selected so it must not use the
+ * SD card's SPI bus.  Set SD_READ_SINK_SIZE zero to read whole blocks into
+ * the cache and call the sink after the card is deselected.  Use zero for
+ * a display that shares the SPI bus with the SD card.  begin() with
+ * SPI_AUTO_SPEED needs the sink and selects SPI_HALF_SPEED if it is zero.
+ */
+#define SD_READ_SINK_SIZE 32
+//------------------------------------------------------------------------------
+/**
+ * Set ENABLE_ASYNC_READ nonzero to enable SdSpiCard::readBlocksAsync()
+ * and FatFile::readAsync().
+ *
+ * SAM3X, STM32F1 and Teensy 3.x receive blocks by DMA so the CPU can
+ * process one block while the next is received.  Other SPI versions receive the data before
+ * returning so the API works but there is no overlap.
+ */
+#ifdef __arm__
+#define ENABLE_ASYNC_READ 1
+#else  // __arm__
+#define ENABLE_ASYNC_READ 0
+#endif  // __arm__
+//------------------------------------------------------------------------------
+/**
+ * Set ENABLE_SD_STATS nonzero to count SdSpiCard commands, busy and token
+ * wait time and bytes moved by single and multi-block transfers.  Read the
+ * counters with SdSpiCard::stats().  The counters use 280 bytes of RAM.
+ *
+ * Set ENABLE_CACHE_STATS for FatVolume cache and FAT access counters.
+ */
+#define ENABLE_SD_STATS 0
+//------------------------------------------------------------------------------
+/**
+ * Set FAT_READ_ONLY nonzero to remove the write paths.  Opens with
+ * O_WRITE, O_TRUNC or O_CREAT fail and FatFile::write() returns -1, so
+ * cluster allocation and directory updates are not linked.
+ */
+#define FAT_READ_ONLY 0
+//------------------------------------------------------------------------------
+/**
+ * Set USE_APP_CACHE_BUFFER nonzero to use a buffer lent by the
+ * application for the volume cache.  See FatVolume::setCacheBuffer().
+ * Saves 512 bytes of RAM for each cache block.
+ */
+#define USE_APP_CACHE_BUFFER 0
+//------------------------------------------------------------------------------
+// Settings selected by SD_FAT_PROFILE replace the values above.
+#if SD_FAT_PROFILE & SD_FAT_PROFILE_READ_ONLY
+#undef FAT_READ_ONLY
+#define FAT_READ_ONLY 1
+#undef USE_WRITE_BUFFER
+#define USE_WRITE_BUFFER 0
+#undef ENABLE_LAZY_SYNC
+#define ENABLE_LAZY_SYNC 0
+#undef ENABLE_ERASE_TRIM
+#define ENABLE_ERASE_TRIM 0
+#undef MAINTAIN_FREE_CLUSTER_COUNT
+#define MAINTAIN_FREE_CLUSTER_COUNT 0
+#undef USE_FREE_CLUSTER_BITMAP
+#define USE_FREE_CLUSTER_BITMAP 0
+#undef USE_AU_ALLOC
+#define USE_AU_ALLOC 0
+#endif  // SD_FAT_PROFILE & SD_FAT_PROFILE_READ_ONLY
+#if SD_FAT_PROFILE & SD_FAT_PROFILE_NO_LFN
+#undef USE_LONG_FILE_NAMES
+#define USE_LONG_FILE_NAMES 0
+#endif  // SD_FAT_PROFILE & SD_FAT_PROFILE_NO_LFN
+#if SD_FAT_PROFILE & SD_FAT_PROFILE_SINGLE_FILE
+#undef CACHE_BLOCK_COUNT
+#define CACHE_BLOCK_COUNT 1
+#undef USE_SEPARATE_FAT_CACHE
+#define USE_SEPARATE_FAT_CACHE 0
+#undef PATH_CACHE_SIZE
+#define PATH_CACHE_SIZE 0
+#undef USE_DIR_HASH_INDEX
+#define USE_DIR_HASH_INDEX 0
+#undef USE_EXTENT_MAP
+#define USE_EXTENT_MAP 0
+#endif  // SD_FAT_PROFILE & SD_FAT_PROFILE_SINGLE_FILE
+#if SD_FAT_PROFILE & SD_FAT_PROFILE_APP_CACHE
+#undef USE_APP_CACHE_BUFFER
+#define USE_APP_CACHE_BUFFER 1
+#endif  // SD_FAT_PROFILE & SD_FAT_PROFILE_APP_CACHE
 #endif  // SdFatConfig_h
@@ -118,6 +118,9 @@ programs when ENABLE_SPI_TRANSACTION is nonzero.
 Set ENABLE_SPI_YIELD nonzero to enable release of the SPI bus during
 SD card busy waits.
 
+Set ENABLE_BUSY_CALLBACK nonzero to call a function set by
+SdSpiCard::setBusyCallback() during SD card busy and read data waits.
+
 \section SDPath Paths and Working Directories
 
 Relative paths in SdFat are resolved in a manner similar to Windows.
@@ -88,6 +88,16 @@ uint8_t const SD_CARD_ERROR_CMD59 = 0X1A;
 uint8_t const SD_CARD_ERROR_READ_CRC = 0X1B;
 /** SPI DMA error */
 uint8_t const SD_CARD_ERROR_SPI_DMA = 0X1C;
+/** SDIO CMD2, CMD3 or CMD7 failed while selecting the card */
+uint8_t const SD_CARD_ERROR_SDIO_SELECT = 0X1D;
+/** SDIO ACMD6 failed to set the bus width */
+uint8_t const SD_CARD_ERROR_ACMD6 = 0X1E;
+/** SDIO data transfer or DMA error */
+uint8_t const SD_CARD_ERROR_SDIO_DMA = 0X1F;
+/** SDIO CMD13 status failed or timed out */
+uint8_t const SD_CARD_ERROR_CMD13 = 0X20;
+/** card returned an error for ACMD13 (read SD Status) */
+uint8_t const SD_CARD_ERROR_ACMD13 = 0X21;
 //------------------------------------------------------------------------------
 // card types
 /** Standard capacity V1 SD card */
@@ -98,6 +108,8 @@ uint8_t const SD_CARD_TYPE_SD2  = 2;
 uint8_t const SD_CARD_TYPE_SDHC = 3;
 //------------------------------------------------------------------------------
 // SPI divisor constants
+/** Probe for the fastest SCK rate that reads reliably in begin(). */
+uint8_t const SPI_AUTO_SPEED = 0;
 /** Set SCK to max rate of F_CPU/2. */
 uint8_t const SPI_FULL_SPEED = 2;
 /** Set SCK rate to F_CPU/3 for Due */
@@ -126,6 +138,12 @@ uint16_t const SD_WRITE_TIMEOUT = 600;
 // SD card commands
 /** GO_IDLE_STATE - init card in spi mode if CS low */
 uint8_t const CMD0 = 0X00;
+/** ALL_SEND_CID - SD bus mode, ask all cards to send their CID */
+uint8_t const CMD2 = 0X02;
+/** SEND_RELATIVE_ADDR - SD bus mode, publish a new relative address */
+uint8_t const CMD3 = 0X03;
+/** SELECT_CARD - SD bus mode, select the card by relative address */
+uint8_t const CMD7 = 0X07;
 /** SEND_IF_COND - verify SD Memory Card interface operating condition.*/
 uint8_t const CMD8 = 0X08;
 /** SEND_CSD - read the Card Specific Data (CSD register) */
@@ -157,6 +175,10 @@ uint8_t const CMD55 = 0X37;
 uint8_t const CMD58 = 0X3A;
 /** CRC_ON_OFF - enable or disable CRC checking */
 uint8_t const CMD59 = 0X3B;
+/** SET_BUS_WIDTH - SD bus mode, select one or four data lines */
+uint8_t const ACMD6 = 0X06;
+/** SD_STATUS - read the 64 byte SD Status register */
+uint8_t const ACMD13 = 0X0D;
 /** SET_WR_BLK_ERASE_COUNT - Set the number of write blocks to be
      pre-erased before writing */
 uint8_t const ACMD23 = 0X17;
@@ -378,4 +400,96 @@ union csd_t {
   csd1_t v1;
   csd2_t v2;
 };
+//==============================================================================
+/**
+ * \class SDS
+ * \brief SD Status register, 64 bytes read with ACMD13.
+ */
+typedef struct SDS {
+  // byte 0
+  unsigned char reserved1 : 5;
+  /** card is in secured mode */
+  unsigned char secured_mode : 1;
+  /** 0 - one bit bus, 2 - four bit bus */
+  unsigned char dat_bus_width : 2;
+  // byte 1
+  unsigned char reserved2;
+  // byte 2
+  /** zero for a regular SD card */
+  unsigned char sd_card_type_high;
+  // byte 3
+  unsigned char sd_card_type_low;
+  // byte 4-7
+  /** size of protected area, big-endian */
+  unsigned char size_of_protected_area[4];
+  // byte 8
+  /** 0, 1, 2, 3 or 4 for class 0, 2, 4, 6 or 10 */
+  unsigned char speed_class;
+  // byte 9
+  /** MB/sec for a move of a file, 0 - class 0, 0XFF - infinity */
+  unsigned char performance_move;
+  // byte 10
+  unsigned char reserved3 : 4;
+  /** allocation unit, 1 - 16 KB doubled up to 9 - 4 MB, 0XA - 0XF SDXC */
+  unsigned char au_size : 4;
+  // byte 11
+  /** AUs erased in erase_timeout seconds, zero if not supported */
+  unsigned char erase_size_high;
+  // byte 12
+  unsigned char erase_size_low;
+  // byte 13
+  /** seconds added to the erase time */
+  unsigned char erase_offset : 2;
+  /** seconds to erase erase_size AUs, zero if not supported */
+  unsigned char erase_timeout : 6;
+  // byte 14
+  /** UHS allocation unit, same codes as au_size */
+  unsigned char uhs_au_size : 4;
+  /** UHS speed grade in 10 MB/sec units */
+  unsigned char uhs_speed_grade : 4;
+  // byte 15
+  /** video speed class in MB/sec */
+  unsigned char video_speed_class;
+  // byte 16-63
+  unsigned char reserved4[48];
+} __attribute__((packed)) sds_t;
+//------------------------------------------------------------------------------
+/** Speed class of a card.
+ *
+ * \param[in] sds SD Status register.
+ * \return Class 0, 2, 4, 6 or 10.
+ */
+inline uint8_t sdsSpeedClass(const sds_t* sds) {
+  return sds->speed_class < 4 ? 2*sds->speed_class :
+         sds->speed_class == 4 ? 10 : 0;
+}
+//------------------------------------------------------------------------------
+/** Allocation unit size of a card.
+ *
+ * \param[in] sds SD Status register.
+ * \return Number of 512 byte blocks in an AU or zero if not defined.
+ */
+inline uint32_t sdsAuBlocks(const sds_t* sds) {
+  // 8, 12, 16, 24, 32 and 64 MB for codes 0XA to 0XF.
+  static const uint8_t sdxcMB[6] = {8, 12, 16, 24, 32, 64};
+  uint8_t au = sds->au_size;
+  if (au == 0) {
+    return 0;
+  }
+  return au < 10 ? 16UL << au : 2048UL*sdxcMB[au - 10];
+}
+//------------------------------------------------------------------------------
+/** Time to erase allocation units.
+ *
+ * \param[in] sds SD Status register.
+ * \param[in] auCount Number of AUs to be erased.
+ * \return Timeout in milliseconds or zero if the card does not say.
+ */
+inline uint32_t sdsEraseMillis(const sds_t* sds, uint32_t auCount) {
+  uint16_t size = (sds->erase_size_high << 8) | sds->erase_size_low;
+  if (size == 0 || sds->erase_timeout == 0) {
+    return 0;
+  }
+  return 1000UL*sds->erase_timeout*auCount/size + 1000UL*sds->erase_offset;
+}
 #endif  // SdInfo_h
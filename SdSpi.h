@@ -25,7 +25,51 @@
 #define SdSpi_h
 #include <Arduino.h>
 #include "SdFatConfig.h"
-
+#if USE_SD_CRC
+//------------------------------------------------------------------------------
+// CRC-CCITT functions for data blocks.  They use the x^16,x^12,x^5,x^1
+// polynomial with a seed of zero.
+#if USE_SD_CRC > 1
+/** Table for the faster byte at a time CRC-CCITT. */
+#ifdef __AVR__
+extern const uint16_t sdCrcTable[256] PROGMEM;
+#else  // __AVR__
+extern const uint16_t sdCrcTable[256];
+#endif  // __AVR__
+#endif  // USE_SD_CRC > 1
+/** Update a CRC-CCITT with one byte.
+ *
+ * \param[in] crc CRC of the previous data.
+ * \param[in] data Next data byte.
+ *
+ * \return The new CRC.
+ */
+inline uint16_t sdCrcUpdate(uint16_t crc, uint8_t data) {
+#if USE_SD_CRC == 1
+  // slower CRC-CCITT
+  crc = (uint8_t)(crc >> 8) | (crc << 8);
+  crc ^= data;
+  crc ^= (uint8_t)(crc & 0xff) >> 4;
+  crc ^= crc << 12;
+  crc ^= (crc & 0xff) << 5;
+  return crc;
+#elif defined(__AVR__)  // USE_SD_CRC == 1
+  return pgm_read_word(&sdCrcTable[(crc >> 8 ^ data) & 0XFF]) ^ (crc << 8);
+#else  // USE_SD_CRC == 1
+  return sdCrcTable[(crc >> 8 ^ data) & 0XFF] ^ (crc << 8);
+#endif  // USE_SD_CRC == 1
+}
+/** Update a CRC-CCITT with multiple bytes.  Hardware CRC is used on
+ * Teensy 3.x.
+ *
+ * \param[in] crc CRC of the previous data.
+ * \param[in] data Next data bytes.
+ * \param[in] n Number of bytes.
+ *
+ * \return The new CRC.
+ */
+uint16_t sdCrcUpdate(uint16_t crc, const uint8_t* data, size_t n);
+#endif  // USE_SD_CRC
 //------------------------------------------------------------------------------
 /**
  * \class SdSpiBase
@@ -53,6 +97,46 @@ class SdSpiBase {
    * \return Zero for no error or nonzero error code.
    */
   virtual uint8_t receive(uint8_t* buf, size_t n) = 0;
+#if USE_SD_CRC
+  /** Receive multiple bytes and update a CRC.  The default computes
+   * the CRC after the data is received.
+   *
+   * \param[out] buf Buffer to receive the data.
+   * \param[in] n Number of bytes to receive.
+   * \param[in,out] crc CRC-CCITT to be updated with the data.
+   *
+   * \return Zero for no error or nonzero error code.
+   */
+  virtual uint8_t receive(uint8_t* buf, size_t n, uint16_t* crc) {
+    uint8_t rtn = receive(buf, n);
+    *crc = sdCrcUpdate(*crc, buf, n);
+    return rtn;
+  }
+#endif  // USE_SD_CRC
+#if ENABLE_ASYNC_READ
+  /** Start receiving multiple bytes.  The default receives all bytes
+   * before returning.
+   *
+   * \param[out] buf Buffer to receive the data.
+   * \param[in] n Number of bytes to receive.
+   *
+   * \return Zero for no error or nonzero error code.
+   */
+  virtual uint8_t receiveStart(uint8_t* buf, size_t n) {
+    return receive(buf, n);
+  }
+  /** \return true if the transfer from receiveStart() is done. */
+  virtual bool receiveDone() {
+    return true;
+  }
+  /** Wait for the transfer from receiveStart() to finish.
+   *
+   * \return Zero for no error or nonzero error code.
+   */
+  virtual uint8_t receiveEnd() {
+    return 0;
+  }
+#endif  // ENABLE_ASYNC_READ
   /** Send a byte.
    *
    * \param[in] data Byte to send
@@ -62,8 +146,23 @@ class SdSpiBase {
   *
   * \param[in] buf Buffer for data to be sent.
   * \param[in] n Number of bytes to send.
+  * \return Zero for no error or nonzero error code.
   */
-  virtual void send(const uint8_t* buf, size_t n) = 0;
+  virtual uint8_t send(const uint8_t* buf, size_t n) = 0;
+#if USE_SD_CRC
+  /** Send multiple bytes and update a CRC.  The default computes
+   * the CRC before the data is sent.
+   *
+   * \param[in] buf Buffer for data to be sent.
+   * \param[in] n Number of bytes to send.
+   * \param[in,out] crc CRC-CCITT to be updated with the data.
+   * \return Zero for no error or nonzero error code.
+   */
+  virtual uint8_t send(const uint8_t* buf, size_t n, uint16_t* crc) {
+    *crc = sdCrcUpdate(*crc, buf, n);
+    return send(buf, n);
+  }
+#endif  // USE_SD_CRC
   /** \return true if hardware SPI else false */
   virtual bool useSpiTransactions() = 0;
 };
@@ -98,6 +197,36 @@ class SdSpi {
    * \return Zero for no error or nonzero error code.
    */
   uint8_t receive(uint8_t* buf, size_t n);
+#if USE_SD_CRC
+  /** Receive multiple bytes and update a CRC.  The CRC is computed
+   * while the SPI controller or DMA is busy with the transfer.
+   *
+   * \param[out] buf Buffer to receive the data.
+   * \param[in] n Number of bytes to receive.
+   * \param[in,out] crc CRC-CCITT to be updated with the data.
+   *
+   * \return Zero for no error or nonzero error code.
+   */
+  uint8_t receive(uint8_t* buf, size_t n, uint16_t* crc);
+#endif  // USE_SD_CRC
+#if ENABLE_ASYNC_READ
+  /** Start receiving multiple bytes.  DMA versions return as soon as
+   * the transfer is started.
+   *
+   * \param[out] buf Buffer to receive the data.
+   * \param[in] n Number of bytes to receive.
+   *
+   * \return Zero for no error or nonzero error code.
+   */
+  uint8_t receiveStart(uint8_t* buf, size_t n);
+  /** \return true if the transfer from receiveStart() is done. */
+  bool receiveDone();
+  /** Wait for the transfer from receiveStart() to finish.
+   *
+   * \return Zero for no error or nonzero error code.
+   */
+  uint8_t receiveEnd();
+#endif  // ENABLE_ASYNC_READ
   /** Send a byte.
    *
    * \param[in] data Byte to send
@@ -107,8 +236,20 @@ class SdSpi {
    *
    * \param[in] buf Buffer for data to be sent.
    * \param[in] n Number of bytes to send.
+   * \return Zero for no error or nonzero error code.
    */
-  void send(const uint8_t* buf, size_t n);
+  uint8_t send(const uint8_t* buf, size_t n);
+#if USE_SD_CRC
+  /** Send multiple bytes and update a CRC.  The CRC is computed
+   * while the SPI controller or DMA is busy with the transfer.
+   *
+   * \param[in] buf Buffer for data to be sent.
+   * \param[in] n Number of bytes to send.
+   * \param[in,out] crc CRC-CCITT to be updated with the data.
+   * \return Zero for no error or nonzero error code.
+   */
+  uint8_t send(const uint8_t* buf, size_t n, uint16_t* crc);
+#endif  // USE_SD_CRC
   /** \return true - uses SPI transactions */
   bool useSpiTransactions() {
     return true;
@@ -183,6 +324,45 @@ class SdSpiLib {
     }
     return 0;
   }
+#if USE_SD_CRC
+  /** Receive multiple bytes and update a CRC.
+   *
+   * \param[out] buf Buffer to receive the data.
+   * \param[in] n Number of bytes to receive.
+   * \param[in,out] crc CRC-CCITT to be updated with the data.
+   *
+   * \return Zero for no error or nonzero error code.
+   */
+  uint8_t receive(uint8_t* buf, size_t n, uint16_t* crc) {
+    uint16_t c = *crc;
+    for (size_t i = 0; i < n; i++) {
+      buf[i] = SPI.transfer(0XFF);
+      c = sdCrcUpdate(c, buf[i]);
+    }
+    *crc = c;
+    return 0;
+  }
+#endif  // USE_SD_CRC
+#if ENABLE_ASYNC_READ
+  /** Receive multiple bytes.  There is no background transfer.
+   *
+   * \param[out] buf Buffer to receive the data.
+   * \param[in] n Number of bytes to receive.
+   *
+   * \return Zero for no error or nonzero error code.
+   */
+  uint8_t receiveStart(uint8_t* buf, size_t n) {
+    return receive(buf, n);
+  }
+  /** \return true - receiveStart() has finished the transfer. */
+  bool receiveDone() {
+    return true;
+  }
+  /** \return Zero - nothing to wait for. */
+  uint8_t receiveEnd() {
+    return 0;
+  }
+#endif  // ENABLE_ASYNC_READ
   /** Send a byte.
    *
    * \param[in] b Byte to send
@@ -194,12 +374,32 @@ class SdSpiLib {
    *
    * \param[in] buf Buffer for data to be sent.
    * \param[in] n Number of bytes to send.
+   * \return Zero for no error or nonzero error code.
    */
-  void send(const uint8_t* buf , size_t n) {
+  uint8_t send(const uint8_t* buf , size_t n) {
     for (size_t i = 0; i < n; i++) {
       SPI.transfer(buf[i]);
     }
+    return 0;
   }
+#if USE_SD_CRC
+  /** Send multiple bytes and update a CRC.
+   *
+   * \param[in] buf Buffer for data to be sent.
+   * \param[in] n Number of bytes to send.
+   * \param[in,out] crc CRC-CCITT to be updated with the data.
+   * \return Zero for no error or nonzero error code.
+   */
+  uint8_t send(const uint8_t* buf , size_t n, uint16_t* crc) {
+    uint16_t c = *crc;
+    for (size_t i = 0; i < n; i++) {
+      SPI.transfer(buf[i]);
+      c = sdCrcUpdate(c, buf[i]);
+    }
+    *crc = c;
+    return 0;
+  }
+#endif  // USE_SD_CRC
   /** \return true - uses SPI transactions */
   bool useSpiTransactions() {
     return true;
@@ -247,6 +447,45 @@ class SdSpiSoft : public SdSpiBase {
     }
     return 0;
   }
+#if USE_SD_CRC
+  /** Receive multiple bytes and update a CRC.
+   *
+   * \param[out] buf Buffer to receive the data.
+   * \param[in] n Number of bytes to receive.
+   * \param[in,out] crc CRC-CCITT to be updated with the data.
+   *
+   * \return Zero for no error or nonzero error code.
+   */
+  uint8_t receive(uint8_t* buf, size_t n, uint16_t* crc) {
+    uint16_t c = *crc;
+    for (size_t i = 0; i < n; i++) {
+      buf[i] = receive();
+      c = sdCrcUpdate(c, buf[i]);
+    }
+    *crc = c;
+    return 0;
+  }
+#endif  // USE_SD_CRC
+#if ENABLE_ASYNC_READ
+  /** Receive multiple bytes.  There is no background transfer.
+   *
+   * \param[out] buf Buffer to receive the data.
+   * \param[in] n Number of bytes to receive.
+   *
+   * \return Zero for no error or nonzero error code.
+   */
+  uint8_t receiveStart(uint8_t* buf, size_t n) {
+    return receive(buf, n);
+  }
+  /** \return true - receiveStart() has finished the transfer. */
+  bool receiveDone() {
+    return true;
+  }
+  /** \return Zero - nothing to wait for. */
+  uint8_t receiveEnd() {
+    return 0;
+  }
+#endif  // ENABLE_ASYNC_READ
   /** Send a byte.
    *
    * \param[in] data Byte to send
@@ -258,12 +497,32 @@ class SdSpiSoft : public SdSpiBase {
    *
    * \param[in] buf Buffer for data to be sent.
    * \param[in] n Number of bytes to send.
+   * \return Zero for no error or nonzero error code.
    */
-  void send(const uint8_t* buf , size_t n) {
+  uint8_t send(const uint8_t* buf , size_t n) {
     for (size_t i = 0; i < n; i++) {
       send(buf[i]);
     }
+    return 0;
   }
+#if USE_SD_CRC
+  /** Send multiple bytes and update a CRC.
+   *
+   * \param[in] buf Buffer for data to be sent.
+   * \param[in] n Number of bytes to send.
+   * \param[in,out] crc CRC-CCITT to be updated with the data.
+   * \return Zero for no error or nonzero error code.
+   */
+  uint8_t send(const uint8_t* buf , size_t n, uint16_t* crc) {
+    uint16_t c = *crc;
+    for (size_t i = 0; i < n; i++) {
+      send(buf[i]);
+      c = sdCrcUpdate(c, buf[i]);
+    }
+    *crc = c;
+    return 0;
+  }
+#endif  // USE_SD_CRC
   /** \return false - no SPI transactions */
   bool useSpiTransactions() {
     return false;
@@ -287,6 +546,79 @@ SpiDefault_t;
 #else  // SD_SPI_CONFIGURATION == 0 || SD_SPI_CONFIGURATION >= 3
 #error bad SD_SPI_CONFIGURATION
 #endif  // SD_SPI_CONFIGURATION == 0 || SD_SPI_CONFIGURATION >= 3
+#if ENABLE_BUS_SESSION
+//------------------------------------------------------------------------------
+#if defined(__AVR__)
+/** SPI controller registers can be saved and restored. */
+#define SPI_HAS_REGS_SAVE 1
+#elif defined(__arm__) && defined(CORE_TEENSY) && defined(KINETISK)
+#define SPI_HAS_REGS_SAVE 1
+#else  // defined(__AVR__)
+#define SPI_HAS_REGS_SAVE 0
+#endif  // defined(__AVR__)
+/**
+ * \struct SpiRegs_t
+ * \brief SPI controller settings for one device on a shared bus.
+ *
+ * Use spiSaveRegs() after a device driver has configured the bus and
+ * spiRestoreRegs() to switch back to the device.  Settings are only saved
+ * for AVR and Teensy 3.x.  Other processors must be configured by the
+ * device driver.
+ */
+struct SpiRegs_t {
+#if defined(__AVR__)
+  /** SPI control register */
+  uint8_t spcr;
+  /** SPI status register, only SPI2X is used */
+  uint8_t spsr;
+#elif SPI_HAS_REGS_SAVE
+  /** clock and 8-bit frame attributes */
+  uint32_t ctar0;
+  /** clock and 16-bit frame attributes */
+  uint32_t ctar1;
+#else  // defined(__AVR__)
+  /** not used */
+  uint8_t unused;
+#endif  // defined(__AVR__)
+};
+//------------------------------------------------------------------------------
+/** Save the current SPI controller settings.
+ *
+ * \param[out] regs Location for the settings.
+ */
+inline void spiSaveRegs(SpiRegs_t* regs) {
+#if defined(__AVR__)
+  regs->spcr = SPCR;
+  regs->spsr = SPSR;
+#elif SPI_HAS_REGS_SAVE
+  regs->ctar0 = SPI0_CTAR0;
+  regs->ctar1 = SPI0_CTAR1;
+#else  // defined(__AVR__)
+  (void)regs;
+#endif  // defined(__AVR__)
+}
+//------------------------------------------------------------------------------
+/** Restore SPI controller settings saved by spiSaveRegs().
+ *
+ * \param[in] regs Saved settings.
+ */
+inline void spiRestoreRegs(const SpiRegs_t* regs) {
+#if defined(__AVR__)
+  SPCR = regs->spcr;
+  SPSR = regs->spsr;
+#elif SPI_HAS_REGS_SAVE
+  if (SPI0_CTAR0 != regs->ctar0 || SPI0_CTAR1 != regs->ctar1) {
+    // CTAR registers may only be changed while the module is halted
+    SPI0_MCR = SPI_MCR_MSTR | SPI_MCR_MDIS | SPI_MCR_HALT | SPI_MCR_PCSIS(0x1F);
+    SPI0_CTAR0 = regs->ctar0;
+    SPI0_CTAR1 = regs->ctar1;
+    SPI0_MCR = SPI_MCR_MSTR | SPI_MCR_PCSIS(0x1F);
+  }
+#else  // defined(__AVR__)
+  (void)regs;
+#endif  // defined(__AVR__)
+}
+#endif  // ENABLE_BUS_SESSION
 //------------------------------------------------------------------------------
 // Use of in-line for AVR to save flash.
 #ifdef __AVR__
@@ -328,25 +660,223 @@ inline uint8_t SdSpi::receive() {
   return SPDR;
 }
 //------------------------------------------------------------------------------
+/**
+ * CPU cycles added to the 8*Div cycles a byte takes in timed transfers.
+ * Bytes are written to SPDR 8*Div + SPI_TIMED_MARGIN cycles apart so the
+ * write can't collide with the byte still being shifted.
+ */
+const uint8_t SPI_TIMED_MARGIN = 2;
+//------------------------------------------------------------------------------
+/** \return Reference to a flag set when a timed transfer had a collision. */
+inline bool& spiTimedCollision() {
+  static bool collision = false;
+  return collision;
+}
+//------------------------------------------------------------------------------
+/** Return the SCK divisor selected by SPCR and SPSR, zero if not timed. */
+inline uint8_t spiTimedDivisor() {
+  if (spiTimedCollision()) {
+    return 0;
+  }
+  uint8_t r = SPCR & ((1 << SPR1) | (1 << SPR0));
+  bool x2 = SPSR & (1 << SPI2X);
+  if (r == 0) {
+    return x2 ? 2 : 4;
+  }
+  return r == 1 && x2 ? 8 : 0;
+}
+//------------------------------------------------------------------------------
+// Delay of 3*k + r cycles in a timed transfer: ldi 1, k - 1 taken loops
+// of dec 1 and brne 2, a final dec 1 and brne 1, then r nops.
+#define SPI_TIMED_DELAY(k, r)\
+  ".if " k "\n"\
+  "ldi %[cnt], " k "\n"\
+  "2: dec %[cnt]\n"\
+  "brne 2b\n"\
+  ".endif\n"\
+  ".rept " r "\n"\
+  "nop\n"\
+  ".endr\n"
+//------------------------------------------------------------------------------
 // Modified by Bodmer to use delays rather than SPIF flag checks
+// The loops are unrolled by four and written in assembly so the cycle
+// counts don't depend on the compiler or -O level.  The time between SPDR
+// writes is T = 8*Div + SPI_TIMED_MARGIN, Div is relative to F_CPU so the
+// timing is the same for 8MHz and 16MHz parts.  Interrupts only make the
+// gaps longer.  WCOL stays set until SPSR and SPDR are read, so one check
+// at the end finds a collision anywhere in the block.
+//
+// Each receive step is in 1, out 1, st 2 and a delay of T - 4 cycles.  The
+// fourth step delays T - 8 cycles for sbiw 2 and a taken brne 2.  A byte
+// is read one cycle before the next byte is started.
+//
+// n - 1 must be a nonzero multiple of four.
+template<uint8_t Div>
+inline uint8_t spiReceiveTimed(uint8_t* buf, size_t n) {
+  const uint8_t T = 8*Div + SPI_TIMED_MARGIN;
+  uint8_t status;
+  uint8_t tmp;
+  uint8_t cnt;
+  size_t groups = (n - 1) >> 2;
+  SPDR = 0XFF;
+  while (!(SPSR & (1 << SPIF))) {}
+  asm volatile(
+    "1:\n"
+    "in %[tmp], %[spdr]\n"
+    "out %[spdr], %[ff]\n"
+    "st %a[buf]+, %[tmp]\n"
+    SPI_TIMED_DELAY("%[k1]", "%[r1]")
+    "in %[tmp], %[spdr]\n"
+    "out %[spdr], %[ff]\n"
+    "st %a[buf]+, %[tmp]\n"
+    SPI_TIMED_DELAY("%[k1]", "%[r1]")
+    "in %[tmp], %[spdr]\n"
+    "out %[spdr], %[ff]\n"
+    "st %a[buf]+, %[tmp]\n"
+    SPI_TIMED_DELAY("%[k1]", "%[r1]")
+    "in %[tmp], %[spdr]\n"
+    "out %[spdr], %[ff]\n"
+    "st %a[buf]+, %[tmp]\n"
+    SPI_TIMED_DELAY("%[k2]", "%[r2]")
+    "sbiw %[groups], 1\n"
+    "brne 1b\n"
+    : [buf] "+e" (buf), [groups] "+w" (groups),
+      [tmp] "=&r" (tmp), [cnt] "=&d" (cnt)
+    : [spdr] "I" (_SFR_IO_ADDR(SPDR)), [ff] "r" ((uint8_t)0XFF),
+      [k1] "M" ((T - 4)/3), [r1] "M" ((T - 4) % 3),
+      [k2] "M" ((T - 8)/3), [r2] "M" ((T - 8) % 3)
+    : "memory");
+  // the last byte is done T cycles after it was started
+  __builtin_avr_delay_cycles(T);
+  status = SPSR;
+  *buf = SPDR;
+  if (status & (1 << WCOL)) {
+    spiTimedCollision() = true;
+    return 1;
+  }
+  return 0;
+}
+//------------------------------------------------------------------------------
+// Each send step is ld 2, out 1 and a delay of T - 3 cycles.  The fourth
+// step delays T - 7 cycles for sbiw 2 and a taken brne 2.
+//
+// n must be a nonzero multiple of four.
+template<uint8_t Div>
+inline uint8_t spiSendTimed(const uint8_t* buf, size_t n) {
+  const uint8_t T = 8*Div + SPI_TIMED_MARGIN;
+  uint8_t status;
+  uint8_t tmp;
+  uint8_t cnt;
+  size_t groups = n >> 2;
+  asm volatile(
+    "1:\n"
+    "ld %[tmp], %a[buf]+\n"
+    "out %[spdr], %[tmp]\n"
+    SPI_TIMED_DELAY("%[k1]", "%[r1]")
+    "ld %[tmp], %a[buf]+\n"
+    "out %[spdr], %[tmp]\n"
+    SPI_TIMED_DELAY("%[k1]", "%[r1]")
+    "ld %[tmp], %a[buf]+\n"
+    "out %[spdr], %[tmp]\n"
+    SPI_TIMED_DELAY("%[k1]", "%[r1]")
+    "ld %[tmp], %a[buf]+\n"
+    "out %[spdr], %[tmp]\n"
+    SPI_TIMED_DELAY("%[k2]", "%[r2]")
+    "sbiw %[groups], 1\n"
+    "brne 1b\n"
+    : [buf] "+e" (buf), [groups] "+w" (groups),
+      [tmp] "=&r" (tmp), [cnt] "=&d" (cnt)
+    : [spdr] "I" (_SFR_IO_ADDR(SPDR)),
+      [k1] "M" ((T - 3)/3), [r1] "M" ((T - 3) % 3),
+      [k2] "M" ((T - 7)/3), [r2] "M" ((T - 7) % 3)
+    : "memory");
+  // the last byte is done T cycles after it was started
+  __builtin_avr_delay_cycles(T);
+  status = SPSR;
+  // Clear SPIF and WCOL for the next single byte transfer.
+  if (status & ((1 << SPIF) | (1 << WCOL))) {
+    (void)SPDR;
+  }
+  if (status & (1 << WCOL)) {
+    spiTimedCollision() = true;
+    return 1;
+  }
+  return 0;
+}
+#undef SPI_TIMED_DELAY
+//------------------------------------------------------------------------------
+// Use the timed kernel for F_CPU/2, /4 and /8.  Slower rates check SPIF
+// since the check is short compared to a byte time.
 inline uint8_t SdSpi::receive(uint8_t* buf, size_t n) {
+  uint8_t div = spiTimedDivisor();
+  if (div && n > 4) {
+    // single bytes until the rest is one byte and groups of four
+    for (; (n - 1) & 3; n--) {
+      *buf++ = receive();
+    }
+    switch (div) {
+      case 2:
+        return spiReceiveTimed<2>(buf, n);
+
+      case 4:
+        return spiReceiveTimed<4>(buf, n);
+
+      case 8:
+        return spiReceiveTimed<8>(buf, n);
+    }
+  }
   if (n-- == 0) {
     return 0;
   }
   SPDR = 0XFF;
+  for (size_t i = 0; i < n; i++) {
+    while (!(SPSR & (1 << SPIF))) {}
+    uint8_t b = SPDR;
+    SPDR = 0XFF;
+    buf[i] = b;
+  }
   while (!(SPSR & (1 << SPIF))) {}
+  buf[n] = SPDR;
+  return 0;
+}
+#if USE_SD_CRC
+//------------------------------------------------------------------------------
+// Update the CRC while each byte is shifted.  SPIF is checked since the
+// time for the CRC may vary.
+inline uint8_t SdSpi::receive(uint8_t* buf, size_t n, uint16_t* crc) {
+  uint16_t c = *crc;
+  if (n-- == 0) {
+    return 0;
+  }
+  SPDR = 0XFF;
   for (size_t i = 0; i < n; i++) {
-    //asm volatile( "nop\n" ::); // Sync bit check
-    //while (!(SPSR & (1 << SPIF))) {}
+    while (!(SPSR & (1 << SPIF))) {}
     uint8_t b = SPDR;
     SPDR = 0XFF;
     buf[i] = b;
-    asm volatile( "adiw r24,0 \n" "adiw	r24,0 \n" "adiw	r24,0 \n" "adiw	r24,0 \n" ::); // Minimum 8 cycle nop delay
+    c = sdCrcUpdate(c, b);
   }
   while (!(SPSR & (1 << SPIF))) {}
   buf[n] = SPDR;
+  *crc = sdCrcUpdate(c, buf[n]);
   return 0;
 }
+#endif  // USE_SD_CRC
+#if ENABLE_ASYNC_READ
+//------------------------------------------------------------------------------
+// No DMA on AVR - receive before returning.
+inline uint8_t SdSpi::receiveStart(uint8_t* buf, size_t n) {
+  return receive(buf, n);
+}
+//------------------------------------------------------------------------------
+inline bool SdSpi::receiveDone() {
+  return true;
+}
+//------------------------------------------------------------------------------
+inline uint8_t SdSpi::receiveEnd() {
+  return 0;
+}
+#endif  // ENABLE_ASYNC_READ
 //------------------------------------------------------------------------------
 // Modified to improve speed slightly by syncing the read to the SPIF flag
 inline void SdSpi::send(uint8_t data) {
@@ -355,9 +885,26 @@ inline void SdSpi::send(uint8_t data) {
   while (!(SPSR & (1 << SPIF))) {}
 }
 //------------------------------------------------------------------------------
-inline void SdSpi::send(const uint8_t* buf , size_t n) {
+inline uint8_t SdSpi::send(const uint8_t* buf , size_t n) {
+  uint8_t div = spiTimedDivisor();
+  if (div && n >= 4) {
+    // single bytes until the rest is groups of four
+    for (; n & 3; n--) {
+      send(*buf++);
+    }
+    switch (div) {
+      case 2:
+        return spiSendTimed<2>(buf, n);
+
+      case 4:
+        return spiSendTimed<4>(buf, n);
+
+      case 8:
+        return spiSendTimed<8>(buf, n);
+    }
+  }
   if (n == 0) {
-    return;
+    return 0;
   }
   SPDR = buf[0];
   if (n > 1) {
@@ -373,6 +920,28 @@ inline void SdSpi::send(const uint8_t* buf , size_t n) {
     }
   }
   while (!(SPSR & (1 << SPIF))) {}
+  return 0;
+}
+#if USE_SD_CRC
+//------------------------------------------------------------------------------
+// Update the CRC with each byte while the previous byte is shifted.
+inline uint8_t SdSpi::send(const uint8_t* buf , size_t n, uint16_t* crc) {
+  uint16_t c = *crc;
+  if (n == 0) {
+    return 0;
+  }
+  SPDR = buf[0];
+  c = sdCrcUpdate(c, buf[0]);
+  for (size_t i = 1; i < n; i++) {
+    uint8_t b = buf[i];
+    c = sdCrcUpdate(c, b);
+    while (!(SPSR & (1 << SPIF))) {}
+    SPDR = b;
+  }
+  while (!(SPSR & (1 << SPIF))) {}
+  *crc = c;
+  return 0;
 }
+#endif  // USE_SD_CRC
 #endif  // __AVR__
 #endif  // SdSpi_h
@@ -25,6 +25,14 @@
 // debug trace macro
 #define SD_TRACE(m, b)
 // #define SD_TRACE(m, b) Serial.print(m);Serial.println(b);
+// operation counter macros
+#if ENABLE_SD_STATS
+#define SD_STATS_ADD(field, n) m_stats.field += (n)
+#define SD_STATS_MICROS(m) uint32_t m = micros()
+#else  // ENABLE_SD_STATS
+#define SD_STATS_ADD(field, n)
+#define SD_STATS_MICROS(m)
+#endif  // ENABLE_SD_STATS
 //==============================================================================
 #if USE_SD_CRC
 // CRC functions
@@ -43,29 +51,13 @@ static uint8_t CRC7(const uint8_t* data, uint8_t n) {
   }
   return (crc << 1) | 1;
 }
+#if USE_SD_CRC > 1
 //------------------------------------------------------------------------------
-#if USE_SD_CRC == 1
-// slower CRC-CCITT
-// uses the x^16,x^12,x^5,x^1 polynomial.
-static uint16_t CRC_CCITT(const uint8_t *data, size_t n) {
-  uint16_t crc = 0;
-  for (size_t i = 0; i < n; i++) {
-    crc = (uint8_t)(crc >> 8) | (crc << 8);
-    crc ^= data[i];
-    crc ^= (uint8_t)(crc & 0xff) >> 4;
-    crc ^= crc << 12;
-    crc ^= (crc & 0xff) << 5;
-  }
-  return crc;
-}
-#elif USE_SD_CRC > 1  // CRC_CCITT
-//------------------------------------------------------------------------------
-// faster CRC-CCITT
-// uses the x^16,x^12,x^5,x^1 polynomial.
+// table for faster CRC-CCITT
 #ifdef __AVR__
-static const uint16_t crctab[] PROGMEM = {
+const uint16_t sdCrcTable[256] PROGMEM = {
 #else  // __AVR__
-static const uint16_t crctab[] = {
+const uint16_t sdCrcTable[256] = {
 #endif  // __AVR__
   0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
   0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
@@ -100,24 +92,53 @@ static const uint16_t crctab[] = {
   0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
   0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
 };
-static uint16_t CRC_CCITT(const uint8_t* data, size_t n) {
-  uint16_t crc = 0;
+#endif  // USE_SD_CRC > 1
+//------------------------------------------------------------------------------
+#if defined(__arm__) && defined(CORE_TEENSY) && defined(KINETISK)
+// define some symbols that may not be in kinetis.h
+#ifndef SIM_SCGC6_CRC
+#define SIM_SCGC6_CRC ((uint32_t)0x00040000)
+#endif  // SIM_SCGC6_CRC
+#ifndef CRC_CRC
+#define CRC_CRC (*(volatile uint32_t *)0x40032000)
+#define CRC_GPOLY (*(volatile uint32_t *)0x40032004)
+#define CRC_CTRL (*(volatile uint32_t *)0x40032008)
+#endif  // CRC_CRC
+#ifndef CRC_CTRL_WAS
+#define CRC_CTRL_WAS ((uint32_t)0x02000000)
+#endif  // CRC_CTRL_WAS
+// Kinetis CRC module in 16-bit mode with the CCITT polynomial.
+uint16_t sdCrcUpdate(uint16_t crc, const uint8_t* data, size_t n) {
+  volatile uint8_t* crcLL = reinterpret_cast<volatile uint8_t*>(&CRC_CRC);
+  SIM_SCGC6 |= SIM_SCGC6_CRC;
+  CRC_CTRL = CRC_CTRL_WAS;
+  CRC_GPOLY = 0X1021;
+  CRC_CRC = crc;
+  CRC_CTRL = 0;
   for (size_t i = 0; i < n; i++) {
-#ifdef __AVR__
-    crc = pgm_read_word(&crctab[(crc >> 8 ^ data[i]) & 0XFF]) ^ (crc << 8);
-#else  // __AVR__
-    crc = crctab[(crc >> 8 ^ data[i]) & 0XFF] ^ (crc << 8);
-#endif  // __AVR__
+    *crcLL = data[i];
+  }
+  return CRC_CRC;
+}
+#else  // defined(__arm__) && defined(CORE_TEENSY) && defined(KINETISK)
+uint16_t sdCrcUpdate(uint16_t crc, const uint8_t* data, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    crc = sdCrcUpdate(crc, data[i]);
   }
   return crc;
 }
-#endif  // CRC_CCITT
+#endif  // defined(__arm__) && defined(CORE_TEENSY) && defined(KINETISK)
 #endif  // USE_SD_CRC
 //==============================================================================
 // SdSpiCard member functions
 //------------------------------------------------------------------------------
 bool SdSpiCard::begin(m_spi_t* spi, uint8_t chipSelectPin, uint8_t sckDivisor) {
   m_errorCode = m_type = 0;
+  m_curState = IDLE_STATE;
+  m_nextRead = 0XFFFFFFFF;
+#if ENABLE_ASYNC_READ
+  m_asyncCount = 0;
+#endif  // ENABLE_ASYNC_READ
   m_spi = spi;
   m_chipSelectPin = chipSelectPin;
   // 16-bit init start time allows over a minute
@@ -193,6 +214,14 @@ bool SdSpiCard::begin(m_spi_t* spi, uint8_t chipSelectPin, uint8_t sckDivisor) {
     }
   }
   chipSelectHigh();
+  if (sckDivisor == SPI_AUTO_SPEED) {
+#if SD_READ_SINK_SIZE
+    return sckDivisorTune();
+#else  // SD_READ_SINK_SIZE
+    // test reads need the sink, use a rate that tolerates poor wiring
+    sckDivisor = SPI_HALF_SPEED;
+#endif  // SD_READ_SINK_SIZE
+  }
   m_sckDivisor = sckDivisor;
   return true;
 
@@ -201,10 +230,101 @@ fail:
   return false;
 }
 //------------------------------------------------------------------------------
-// send command and return error code.  Return zero for OK
+#if ENABLE_WARM_MOUNT
+bool SdSpiCard::beginWarm(m_spi_t* spi, uint8_t chipSelectPin,
+                          uint8_t sckDivisor, uint8_t cardType) {
+  if (cardType < SD_CARD_TYPE_SD1 || cardType > SD_CARD_TYPE_SDHC ||
+      sckDivisor == SPI_AUTO_SPEED) {
+    return begin(spi, chipSelectPin, sckDivisor);
+  }
+  m_errorCode = 0;
+  m_curState = IDLE_STATE;
+  m_nextRead = 0XFFFFFFFF;
+#if ENABLE_ASYNC_READ
+  m_asyncCount = 0;
+#endif  // ENABLE_ASYNC_READ
+  m_spi = spi;
+  m_chipSelectPin = chipSelectPin;
+  pinMode(m_chipSelectPin, OUTPUT);
+  digitalWrite(m_chipSelectPin, HIGH);
+  spiBegin();
+  m_sckDivisor = sckDivisor;
+  type(cardType);
+  // A card still in SPI mode answers CMD13 with a zero R2 status.
+  if (cardCommand(CMD13, 0) == 0 && spiReceive() == 0) {
+    chipSelectHigh();
+    return true;
+  }
+  chipSelectHigh();
+  return begin(spi, chipSelectPin, sckDivisor);
+}
+#endif  // ENABLE_WARM_MOUNT
+//------------------------------------------------------------------------------
+#if SD_READ_SINK_SIZE
+// Fletcher checksum of a block to compare test reads.
+static void sckDivisorSink(const uint8_t* data, size_t n, void* context) {
+  uint8_t* sum = reinterpret_cast<uint8_t*>(context);
+  for (size_t i = 0; i < n; i++) {
+    sum[0] += data[i];
+    sum[1] += sum[0];
+  }
+}
+//------------------------------------------------------------------------------
+// Return true if block zero reads with checksum sum at m_sckDivisor.
+bool SdSpiCard::sckDivisorTest(uint16_t sum) {
+  for (uint8_t i = 0; i < SPI_AUTO_SPEED_READS; i++) {
+    uint8_t s[2] = {0, 0};
+    if (!readBlock(0, sckDivisorSink, s) || !syncBlocks() ||
+        (s[0] | (s[1] << 8)) != sum) {
+      return false;
+    }
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+// Select the fastest SCK divisor that reads block zero correctly.
+bool SdSpiCard::sckDivisorTune() {
+  uint8_t s[2] = {0, 0};
+  // Reference read at the init rate.
+  m_sckDivisor = SPI_SCK_INIT_DIVISOR;
+  if (!readBlock(0, sckDivisorSink, s) || !syncBlocks()) {
+    return false;
+  }
+  for (uint8_t d = SPI_FULL_SPEED; d < SPI_SCK_INIT_DIVISOR; d <<= 1) {
+    m_sckDivisor = d;
+    if (sckDivisorTest(s[0] | (s[1] << 8))) {
+      // Clear any error from a faster divisor.
+      m_errorCode = 0;
+      return true;
+    }
+  }
+  m_sckDivisor = SPI_SCK_INIT_DIVISOR;
+  error(SD_CARD_ERROR_SCK_RATE);
+  return false;
+}
+#endif  // SD_READ_SINK_SIZE
+//------------------------------------------------------------------------------
+// send command and return error code.  Return zero for OK.  If an open
+// sequence can't be ended the command is not sent and 0XFF is returned.
 uint8_t SdSpiCard::cardCommand(uint8_t cmd, uint32_t arg) {
+#if ENABLE_ASYNC_READ
+  // finish any async read
+  // a failed async read has already ended its sequence
+  if (m_curState == ASYNC_STATE) {
+    readAsyncWait();
+  }
+#endif  // ENABLE_ASYNC_READ
+  // end any open read sequence
+  if (m_curState == READ_STATE && cmd != CMD12 && !readStop()) {
+    return 0XFF;
+  }
+  // end any open write sequence, data is not committed if this fails
+  if (m_curState == WRITE_STATE && !writeStop()) {
+    return 0XFF;
+  }
   // select card
   chipSelectLow();
+  SD_STATS_ADD(cmdCount[cmd & 0X3F], 1);
 
   // wait if busy
   waitNotBusy(SD_WRITE_TIMEOUT);
@@ -269,6 +389,14 @@ uint32_t SdSpiCard::cardSize() {
 }
 //------------------------------------------------------------------------------
 void SdSpiCard::spiYield() {
+#if ENABLE_BUSY_CALLBACK
+  if (m_busyCallback) {
+    chipSelectHigh();
+    m_busyCallback(true, m_busyContext);
+    chipSelectLow();
+    return;
+  }
+#endif  // ENABLE_BUSY_CALLBACK
 #if ENABLE_SPI_TRANSACTION && ENABLE_SPI_YIELD && defined(SPI_HAS_TRANSACTION)
   chipSelectHigh();
   chipSelectLow();
@@ -279,14 +407,46 @@ void SdSpiCard::chipSelectHigh() {
   digitalWrite(m_chipSelectPin, HIGH);
   // insure MISO goes high impedance
   spiSend(0XFF);
+#if ENABLE_BUS_SESSION
+  if (m_session) {
+    // keep the transaction and bus lock until endSession()
+    return;
+  }
+#endif  // ENABLE_BUS_SESSION
 #if ENABLE_SPI_TRANSACTION && defined(SPI_HAS_TRANSACTION)
   if (useSpiTransactions()) {
     SPI.endTransaction();
   }
 #endif  // ENABLE_SPI_TRANSACTION && defined(SPI_HAS_TRANSACTION)
+#if ENABLE_LOCK_HOOKS
+  if (m_busHeld) {
+    m_busHeld = false;
+    m_busLockHook(false, m_busLockContext);
+  }
+#endif  // ENABLE_LOCK_HOOKS
 }
 //------------------------------------------------------------------------------
 void SdSpiCard::chipSelectLow() {
+#if ENABLE_BUS_SESSION
+  if (m_session) {
+    if (m_busLent) {
+#if SPI_HAS_REGS_SAVE
+      spiRestoreRegs(&m_cardRegs);
+#else  // SPI_HAS_REGS_SAVE
+      spiInit(m_sckDivisor);
+#endif  // SPI_HAS_REGS_SAVE
+      m_busLent = false;
+    }
+    digitalWrite(m_chipSelectPin, LOW);
+    return;
+  }
+#endif  // ENABLE_BUS_SESSION
+#if ENABLE_LOCK_HOOKS
+  if (m_busLockHook && !m_busHeld) {
+    m_busLockHook(true, m_busLockContext);
+    m_busHeld = true;
+  }
+#endif  // ENABLE_LOCK_HOOKS
 #if ENABLE_SPI_TRANSACTION && defined(SPI_HAS_TRANSACTION)
   if (useSpiTransactions()) {
     SPI.beginTransaction(SPISettings());
@@ -295,6 +455,42 @@ void SdSpiCard::chipSelectLow() {
   spiInit(m_sckDivisor);
   digitalWrite(m_chipSelectPin, LOW);
 }
+#if ENABLE_BUS_SESSION
+//------------------------------------------------------------------------------
+void SdSpiCard::beginSession() {
+  if (m_session) {
+    return;
+  }
+  // take the lock and start the transaction with the card deselected
+  chipSelectLow();
+  digitalWrite(m_chipSelectPin, HIGH);
+  spiSaveRegs(&m_cardRegs);
+  m_busLent = false;
+  m_session = true;
+}
+//------------------------------------------------------------------------------
+void SdSpiCard::endSession() {
+  if (!m_session) {
+    return;
+  }
+  m_session = false;
+  if (m_busLent) {
+    m_busLent = false;
+    spiInit(m_sckDivisor);
+  }
+  chipSelectHigh();
+}
+//------------------------------------------------------------------------------
+void SdSpiCard::lendBus(const SpiRegs_t* regs) {
+  if (!m_session) {
+    return;
+  }
+  if (regs) {
+    spiRestoreRegs(regs);
+  }
+  m_busLent = true;
+}
+#endif  // ENABLE_BUS_SESSION
 //------------------------------------------------------------------------------
 bool SdSpiCard::erase(uint32_t firstBlock, uint32_t lastBlock) {
   csd_t csd;
@@ -338,8 +534,28 @@ bool SdSpiCard::eraseSingleBlockEnable() {
   return readCSD(&csd) ? csd.v1.erase_blk_en : false;
 }
 //------------------------------------------------------------------------------
+bool SdSpiCard::trim(uint32_t firstBlock, uint32_t lastBlock) {
+  csd_t csd;
+  if (!readCSD(&csd)) {
+    return false;
+  }
+  if (!csd.v1.erase_blk_en) {
+    // round to whole erase sectors
+    uint8_t m = (csd.v1.sector_size_high << 1) | csd.v1.sector_size_low;
+    firstBlock = (firstBlock + m) & ~(uint32_t)m;
+    lastBlock = ((lastBlock + 1) & ~(uint32_t)m) - 1;
+    if ((lastBlock + 1) <= firstBlock) {
+      return true;
+    }
+  }
+  return erase(firstBlock, lastBlock);
+}
+//------------------------------------------------------------------------------
 bool SdSpiCard::isBusy() {
   bool rtn;
+  if (m_curState != WRITE_STATE && !syncBlocks()) {
+    return true;
+  }
   chipSelectLow();
   for (uint8_t i = 0; i < 8; i++) {
     rtn = spiReceive() != 0XFF;
@@ -351,37 +567,178 @@ bool SdSpiCard::isBusy() {
   return rtn;
 }
 //------------------------------------------------------------------------------
-bool SdSpiCard::readBlock(uint32_t blockNumber, uint8_t* dst) {
-  SD_TRACE("RB", blockNumber);
-  // use address if not SDHC card
-  if (type() != SD_CARD_TYPE_SDHC) {
-    blockNumber <<= 9;
+#if ENABLE_ASYNC_READ
+// start receive of the next async block
+bool SdSpiCard::readAsyncBlock() {
+  chipSelectLow();
+  if (!readDataToken()) {
+    goto fail;
   }
-  if (cardCommand(CMD17, blockNumber)) {
-    error(SD_CARD_ERROR_CMD17);
+  if ((m_status = spiReceiveStart(m_asyncDst, 512))) {
+    error(SD_CARD_ERROR_SPI_DMA);
     goto fail;
   }
-  return readData(dst, 512);
+  return true;
 
 fail:
   chipSelectHigh();
   return false;
 }
 //------------------------------------------------------------------------------
-bool SdSpiCard::readBlocks(uint32_t block, uint8_t* dst, size_t count) {
-  if (!readStart(block)) {
+int8_t SdSpiCard::readAsyncStatus() {
+#if USE_SD_CRC
+  uint16_t crc;
+#endif  // USE_SD_CRC
+  if (m_curState != ASYNC_STATE) {
+    // blocks are left if the read failed
+    return m_asyncCount ? -1 : 1;
+  }
+  if (!spiReceiveDone()) {
+    return 0;
+  }
+  if ((m_status = spiReceiveEnd())) {
+    error(SD_CARD_ERROR_SPI_DMA);
+    goto fail;
+  }
+#if USE_SD_CRC
+  // get crc
+  crc = spiReceive() << 8;
+  crc |= spiReceive();
+  if (crc != sdCrcUpdate(0, m_asyncDst, 512)) {
+    error(SD_CARD_ERROR_READ_CRC);
+    goto fail;
+  }
+#else  // USE_SD_CRC
+  // discard crc
+  spiReceive();
+  spiReceive();
+#endif  // USE_SD_CRC
+  chipSelectHigh();
+  SD_STATS_ADD(multiBlockBytes, 512);
+  m_curBlock++;
+  m_asyncDst += 512;
+  if (--m_asyncCount) {
+    if (!readAsyncBlock()) {
+      // end the CMD18 sequence, the card is still sending data
+      readStop();
+      goto done;
+    }
+    return 0;
+  }
+  // leave the sequence open for the next read
+  m_curState = READ_STATE;
+
+done:
+  if (m_asyncCallback) {
+    m_asyncCallback(m_asyncCount == 0, m_asyncContext);
+  }
+  return m_asyncCount ? -1 : 1;
+
+fail:
+  chipSelectHigh();
+  // end the CMD18 sequence, the card is still sending data
+  readStop();
+  goto done;
+}
+//------------------------------------------------------------------------------
+bool SdSpiCard::readBlocksAsync(uint32_t block, uint8_t* dst, size_t count,
+                                readDone_t callback, void* context) {
+  // finish previous async read so an open sequence can continue
+  if (m_curState == ASYNC_STATE) {
+    readAsyncWait();
+  }
+  if (m_curState != READ_STATE || block != m_curBlock) {
+    if (!readStart(block)) {
+      return false;
+    }
+  }
+  m_asyncDst = dst;
+  m_asyncCount = count;
+  m_asyncCallback = callback;
+  m_asyncContext = context;
+  if (count == 0) {
+    return true;
+  }
+  if (!readAsyncBlock()) {
+    readStop();
+    return false;
+  }
+  m_curState = ASYNC_STATE;
+  return true;
+}
+#endif  // ENABLE_ASYNC_READ
+//------------------------------------------------------------------------------
+bool SdSpiCard::readBlock(uint32_t blockNumber, uint8_t* dst) {
+  SD_TRACE("RB", blockNumber);
+  if (readSequential(blockNumber)) {
+    return readBlocks(blockNumber, dst, 1);
+  }
+  if (!readSingleStart(blockNumber)) {
     return false;
   }
+  SD_STATS_ADD(singleBlockBytes, 512);
+  return readData(dst, 512);
+}
+//------------------------------------------------------------------------------
+bool SdSpiCard::readBlocks(uint32_t block, uint8_t* dst, size_t count) {
+  if (count == 1 && !readSequential(block)) {
+    return readBlock(block, dst);
+  }
+  // continue an open sequence if block is the next block
+  if (m_curState != READ_STATE || block != m_curBlock) {
+    if (!readStart(block)) {
+      return false;
+    }
+  }
   for (uint16_t b = 0; b < count; b++, dst += 512) {
     if (!readData(dst)) {
+      // end the CMD18 sequence, the card may still be sending data
+      readStop();
       return false;
     }
   }
+#if ENABLE_READ_STREAMING
+  return true;
+#else  // ENABLE_READ_STREAMING
   return readStop();
+#endif  // ENABLE_READ_STREAMING
 }
 //------------------------------------------------------------------------------
+#if SD_READ_SINK_SIZE
+bool SdSpiCard::readBlock(uint32_t block, readSink_t sink, void* context) {
+  if (!readSequential(block)) {
+    if (!readSingleStart(block)) {
+      return false;
+    }
+    SD_STATS_ADD(singleBlockBytes, 512);
+    return readData(sink, context);
+  }
+  // continue an open sequence if block is the next block
+  if (m_curState != READ_STATE || block != m_curBlock) {
+    if (!readStart(block)) {
+      return false;
+    }
+  }
+  chipSelectLow();
+  m_curBlock++;
+  SD_STATS_ADD(multiBlockBytes, 512);
+  if (!readData(sink, context)) {
+    // end the CMD18 sequence, the card may still be sending data
+    readStop();
+    return false;
+  }
+#if ENABLE_READ_STREAMING
+  return true;
+#else  // ENABLE_READ_STREAMING
+  return readStop();
+#endif  // ENABLE_READ_STREAMING
+}
+#endif  // SD_READ_SINK_SIZE
+//------------------------------------------------------------------------------
 bool SdSpiCard::readData(uint8_t *dst) {
   chipSelectLow();
+  m_curBlock++;
+  SD_STATS_ADD(multiBlockBytes, 512);
   return readData(dst, 512);
 }
 //------------------------------------------------------------------------------
@@ -389,32 +746,72 @@ bool SdSpiCard::readData(uint8_t* dst, size_t count) {
 #if USE_SD_CRC
   uint16_t crc;
 #endif  // USE_SD_CRC
-  // wait for start block token
-  uint16_t t0 = millis();
-  while ((m_status = spiReceive()) == 0XFF) {
-    if (((uint16_t)millis() - t0) > SD_READ_TIMEOUT) {
-      error(SD_CARD_ERROR_READ_TIMEOUT);
-      goto fail;
-    }
+  if (!readDataToken()) {
+    goto fail;
   }
-  if (m_status != DATA_START_BLOCK) {
-    error(SD_CARD_ERROR_READ);
+#if USE_SD_CRC
+  // transfer data and compute crc during the transfer
+  crc = 0;
+  if ((m_status = spiReceive(dst, count, &crc))) {
+    error(SD_CARD_ERROR_SPI_DMA);
+    goto fail;
+  }
+  // check crc
+  crc ^= spiReceive() << 8;
+  crc ^= spiReceive();
+  if (crc) {
+    error(SD_CARD_ERROR_READ_CRC);
     goto fail;
   }
+#else  // USE_SD_CRC
   // transfer data
   if ((m_status = spiReceive(dst, count))) {
     error(SD_CARD_ERROR_SPI_DMA);
     goto fail;
   }
+  // discard crc
+  spiReceive();
+  spiReceive();
+#endif  // USE_SD_CRC
+  chipSelectHigh();
+  return true;
 
+fail:
+  chipSelectHigh();
+  return false;
+}
+//------------------------------------------------------------------------------
+#if SD_READ_SINK_SIZE
+bool SdSpiCard::readData(readSink_t sink, void* context) {
+  uint8_t buf[SD_READ_SINK_SIZE];
 #if USE_SD_CRC
-  // get crc
-  crc = (spiReceive() << 8) | spiReceive();
-  if (crc != CRC_CCITT(dst, count)) {
+  uint16_t crc = 0;
+#endif  // USE_SD_CRC
+  if (!readDataToken()) {
+    goto fail;
+  }
+  // pass each run to the sink as it is received
+  for (size_t n = 0; n < 512; n += SD_READ_SINK_SIZE) {
+#if USE_SD_CRC
+    m_status = spiReceive(buf, SD_READ_SINK_SIZE, &crc);
+#else  // USE_SD_CRC
+    m_status = spiReceive(buf, SD_READ_SINK_SIZE);
+#endif  // USE_SD_CRC
+    if (m_status) {
+      error(SD_CARD_ERROR_SPI_DMA);
+      goto fail;
+    }
+    sink(buf, SD_READ_SINK_SIZE, context);
+  }
+#if USE_SD_CRC
+  // check crc - the sink has already seen the data
+  crc ^= spiReceive() << 8;
+  crc ^= spiReceive();
+  if (crc) {
     error(SD_CARD_ERROR_READ_CRC);
     goto fail;
   }
-#else
+#else  // USE_SD_CRC
   // discard crc
   spiReceive();
   spiReceive();
@@ -426,6 +823,32 @@ fail:
   chipSelectHigh();
   return false;
 }
+#endif  // SD_READ_SINK_SIZE
+//------------------------------------------------------------------------------
+// wait for start block token
+bool SdSpiCard::readDataToken() {
+  SD_STATS_MICROS(m);
+  uint16_t t0 = millis();
+  while ((m_status = spiReceive()) == 0XFF) {
+    if (((uint16_t)millis() - t0) > SD_READ_TIMEOUT) {
+      error(SD_CARD_ERROR_READ_TIMEOUT);
+      return false;
+    }
+#if ENABLE_BUSY_CALLBACK
+    // The card must stay selected until the token is received.
+    if (m_busyCallback) {
+      m_busyCallback(false, m_busyContext);
+    }
+#endif  // ENABLE_BUSY_CALLBACK
+  }
+  SD_STATS_ADD(tokenWaitCount, 1);
+  SD_STATS_ADD(tokenWaitMicros, micros() - m);
+  if (m_status != DATA_START_BLOCK) {
+    error(SD_CARD_ERROR_READ);
+    return false;
+  }
+  return true;
+}
 //------------------------------------------------------------------------------
 bool SdSpiCard::readOCR(uint32_t* ocr) {
   uint8_t *p = reinterpret_cast<uint8_t*>(ocr);
@@ -459,15 +882,47 @@ fail:
   return false;
 }
 //------------------------------------------------------------------------------
+bool SdSpiCard::readStatus(sds_t* sds) {
+  uint8_t* dst = reinterpret_cast<uint8_t*>(sds);
+  // R2 response, R1 then a status byte.
+  if (cardAcmd(ACMD13, 0) || spiReceive()) {
+    error(SD_CARD_ERROR_ACMD13);
+    goto fail;
+  }
+  return readData(dst, sizeof(sds_t));
+
+fail:
+  chipSelectHigh();
+  return false;
+}
+//------------------------------------------------------------------------------
+// Send CMD17 for a random block read.
+bool SdSpiCard::readSingleStart(uint32_t blockNumber) {
+  m_nextRead = blockNumber + 1;
+  // use address if not SDHC card
+  if (type() != SD_CARD_TYPE_SDHC) {
+    blockNumber <<= 9;
+  }
+  if (cardCommand(CMD17, blockNumber)) {
+    error(SD_CARD_ERROR_CMD17);
+    chipSelectHigh();
+    return false;
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
 bool SdSpiCard::readStart(uint32_t blockNumber) {
   SD_TRACE("RS", blockNumber);
+  uint32_t arg = blockNumber;
   if (type() != SD_CARD_TYPE_SDHC) {
-    blockNumber <<= 9;
+    arg <<= 9;
   }
-  if (cardCommand(CMD18, blockNumber)) {
+  if (cardCommand(CMD18, arg)) {
     error(SD_CARD_ERROR_CMD18);
     goto fail;
   }
+  m_curBlock = blockNumber;
+  m_curState = READ_STATE;
   chipSelectHigh();
   return true;
 
@@ -477,6 +932,7 @@ fail:
 }
 //------------------------------------------------------------------------------
 bool SdSpiCard::readStop() {
+  m_curState = IDLE_STATE;
   if (cardCommand(CMD12, 0)) {
     error(SD_CARD_ERROR_CMD12);
     goto fail;
@@ -489,8 +945,21 @@ fail:
   return false;
 }
 //------------------------------------------------------------------------------
+bool SdSpiCard::syncBlocks() {
+#if ENABLE_ASYNC_READ
+  if (m_curState == ASYNC_STATE && !readAsyncWait()) {
+    return false;
+  }
+#endif  // ENABLE_ASYNC_READ
+  if (m_curState == WRITE_STATE) {
+    return writeStop();
+  }
+  return m_curState == READ_STATE ? readStop() : true;
+}
+//------------------------------------------------------------------------------
 // wait for card to go not busy
 bool SdSpiCard::waitNotBusy(uint16_t timeoutMillis) {
+  SD_STATS_MICROS(m);
   uint16_t t0 = millis();
   while (spiReceive() != 0XFF) {
     if (((uint16_t)millis() - t0) >= timeoutMillis) {
@@ -498,14 +967,22 @@ bool SdSpiCard::waitNotBusy(uint16_t timeoutMillis) {
     }
     spiYield();
   }
+  SD_STATS_ADD(busyWaitCount, 1);
+  SD_STATS_ADD(busyWaitMicros, micros() - m);
   return true;
 
 fail:
+  SD_STATS_ADD(busyWaitCount, 1);
+  SD_STATS_ADD(busyWaitMicros, micros() - m);
   return false;
 }
 //------------------------------------------------------------------------------
 bool SdSpiCard::writeBlock(uint32_t blockNumber, const uint8_t* src) {
   SD_TRACE("WB", blockNumber);
+  // continue an open sequence if block is the next block
+  if (m_curState == WRITE_STATE && blockNumber == m_curBlock) {
+    return writeData(src);
+  }
   // use address if not SDHC card
   if (type() != SD_CARD_TYPE_SDHC) {
     blockNumber <<= 9;
@@ -517,6 +994,7 @@ bool SdSpiCard::writeBlock(uint32_t blockNumber, const uint8_t* src) {
   if (!writeData(DATA_START_BLOCK, src)) {
     goto fail;
   }
+  SD_STATS_ADD(singleBlockBytes, 512);
 
 #define CHECK_PROGRAMMING 0
 #if CHECK_PROGRAMMING
@@ -541,7 +1019,9 @@ fail:
 }
 //------------------------------------------------------------------------------
 bool SdSpiCard::writeBlocks(uint32_t block, const uint8_t* src, size_t count) {
-  if (!writeStart(block, count)) {
+  // continue an open sequence if block is the next block
+  bool next = m_curState == WRITE_STATE && block == m_curBlock;
+  if (!next && !writeStart(block, count)) {
     return false;
   }
   for (size_t b = 0; b < count; b++, src += 512) {
@@ -549,7 +1029,7 @@ bool SdSpiCard::writeBlocks(uint32_t block, const uint8_t* src, size_t count) {
       return false;
     }
   }
-  return writeStop();
+  return next ? true : writeStop();
 }
 //------------------------------------------------------------------------------
 bool SdSpiCard::writeData(const uint8_t* src) {
@@ -561,6 +1041,8 @@ bool SdSpiCard::writeData(const uint8_t* src) {
   if (!writeData(WRITE_MULTIPLE_TOKEN, src)) {
     goto fail;
   }
+  SD_STATS_ADD(multiBlockBytes, 512);
+  m_curBlock++;
   chipSelectHigh();
   return true;
 
@@ -572,17 +1054,25 @@ fail:
 //------------------------------------------------------------------------------
 // send one block of data for write block or write multiple blocks
 bool SdSpiCard::writeData(uint8_t token, const uint8_t* src) {
+  uint8_t rtn;
+  spiSend(token);
 #if USE_SD_CRC
-  uint16_t crc = CRC_CCITT(src, 512);
+  // compute crc during the transfer
+  uint16_t crc = 0;
+  rtn = spiSend(src, 512, &crc);
 #else  // USE_SD_CRC
   uint16_t crc = 0XFFFF;
+  rtn = spiSend(src, 512);
 #endif  // USE_SD_CRC
-  spiSend(token);
-  spiSend(src, 512);
   spiSend(crc >> 8);
   spiSend(crc & 0XFF);
 
   m_status = spiReceive();
+  // The card may accept a block with a lost byte if CRC is not used.
+  if (rtn) {
+    error(SD_CARD_ERROR_SPI_DMA);
+    goto fail;
+  }
   if ((m_status & DATA_RES_MASK) != DATA_RES_ACCEPTED) {
     error(SD_CARD_ERROR_WRITE);
     goto fail;
@@ -596,19 +1086,26 @@ fail:
 //------------------------------------------------------------------------------
 bool SdSpiCard::writeStart(uint32_t blockNumber, uint32_t eraseCount) {
   SD_TRACE("WS", blockNumber);
+  uint32_t address;
+  if (m_curState == WRITE_STATE && blockNumber == m_curBlock) {
+    return true;
+  }
   // send pre-erase count
   if (cardAcmd(ACMD23, eraseCount)) {
     error(SD_CARD_ERROR_ACMD23);
     goto fail;
   }
   // use address if not SDHC card
+  address = blockNumber;
   if (type() != SD_CARD_TYPE_SDHC) {
-    blockNumber <<= 9;
+    address <<= 9;
   }
-  if (cardCommand(CMD25, blockNumber)) {
+  if (cardCommand(CMD25, address)) {
     error(SD_CARD_ERROR_CMD25);
     goto fail;
   }
+  m_curBlock = blockNumber;
+  m_curState = WRITE_STATE;
   chipSelectHigh();
   return true;
 
@@ -618,6 +1115,7 @@ fail:
 }
 //------------------------------------------------------------------------------
 bool SdSpiCard::writeStop() {
+  m_curState = IDLE_STATE;
   chipSelectLow();
   if (!waitNotBusy(SD_WRITE_TIMEOUT)) {
     goto fail;
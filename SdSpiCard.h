@@ -27,6 +27,32 @@
 #include <SdFatConfig.h>
 #include <SdInfo.h>
 #include <SdSpi.h>
+#if SD_READ_SINK_SIZE && 512 % SD_READ_SINK_SIZE
+#error SD_READ_SINK_SIZE must divide 512
+#endif  // SD_READ_SINK_SIZE
+//==============================================================================
+#if ENABLE_SD_STATS
+/**
+ * \struct SdCardStats_t
+ * \brief SdSpiCard operation counters.
+ */
+struct SdCardStats_t {
+  /** Commands issued, indexed by command number.  ACMDs follow CMD55. */
+  uint32_t cmdCount[64];
+  /** Calls to waitNotBusy(). */
+  uint32_t busyWaitCount;
+  /** Microseconds spent in waitNotBusy(). */
+  uint32_t busyWaitMicros;
+  /** Waits for a read data token. */
+  uint32_t tokenWaitCount;
+  /** Microseconds spent waiting for read data tokens. */
+  uint32_t tokenWaitMicros;
+  /** Data bytes moved by CMD17 and CMD24 single block transfers. */
+  uint32_t singleBlockBytes;
+  /** Data bytes moved by CMD18 and CMD25 multiple block transfers. */
+  uint32_t multiBlockBytes;
+};
+#endif  // ENABLE_SD_STATS
 //==============================================================================
 /**
  * \class SdSpiCard
@@ -40,16 +66,61 @@ class SdSpiCard {
 #else  // SD_SPI_CONFIGURATION < 3
   typedef SdSpiBase m_spi_t;
 #endif  // SD_SPI_CONFIGURATION < 3
+  /** typedef for a function that accepts a run of received data. */
+  typedef void (*readSink_t)(const uint8_t* data, size_t n, void* context);
+  /** typedef for a function called when an async read is done. */
+  typedef void (*readDone_t)(bool success, void* context);
+  /** typedef for a function called during card waits.  The card is
+   * deselected and the SPI bus may be used if busFree is true.
+   */
+  typedef void (*busyCallback_t)(bool busFree, void* context);
+  /** typedef for a lock hook.  The hook is called with take true to
+   * acquire the lock and false to release it.
+   */
+  typedef void (*lockHook_t)(bool take, void* context);
   /** Construct an instance of SdSpiCard. */
-  SdSpiCard() : m_errorCode(SD_CARD_ERROR_INIT_NOT_CALLED), m_type(0) {}
+  SdSpiCard() : m_curState(IDLE_STATE),
+    m_errorCode(SD_CARD_ERROR_INIT_NOT_CALLED), m_type(0) {
+#if ENABLE_BUSY_CALLBACK
+    m_busyCallback = 0;
+#endif  // ENABLE_BUSY_CALLBACK
+#if ENABLE_LOCK_HOOKS
+    m_busLockHook = 0;
+    m_busHeld = false;
+#endif  // ENABLE_LOCK_HOOKS
+#if ENABLE_BUS_SESSION
+    m_session = false;
+#endif  // ENABLE_BUS_SESSION
+#if ENABLE_SD_STATS
+    clearStats();
+#endif  // ENABLE_SD_STATS
+  }
   /** Initialize the SD card.
    * \param[in] spi SPI object.
    * \param[in] chipSelectPin SD chip select pin.
-   * \param[in] sckDivisor SPI clock divisor.
+   * \param[in] sckDivisor SPI clock divisor.  Use SPI_AUTO_SPEED to
+   * select the fastest divisor that passes test reads of block zero,
+   * SPI_HALF_SPEED if SD_READ_SINK_SIZE is zero.
    * \return true for success else false.
    */
   bool begin(m_spi_t* spi, uint8_t chipSelectPin = SS,
              uint8_t sckDivisor = SPI_FULL_SPEED);
+#if ENABLE_WARM_MOUNT
+  /** Use a card that is still initialized in SPI mode.
+   *
+   * CMD13 is sent at \a sckDivisor.  If the card does not answer it has
+   * been power cycled and begin() is called.  Pass the divisor found by
+   * SPI_AUTO_SPEED from sckDivisor() rather than SPI_AUTO_SPEED.
+   *
+   * \param[in] spi SPI object.
+   * \param[in] chipSelectPin SD chip select pin.
+   * \param[in] sckDivisor SPI clock divisor.
+   * \param[in] cardType Card type from type() after the last begin().
+   * \return true for success else false.
+   */
+  bool beginWarm(m_spi_t* spi, uint8_t chipSelectPin,
+                 uint8_t sckDivisor, uint8_t cardType);
+#endif  // ENABLE_WARM_MOUNT
   /**
    * Determine the size of an SD flash memory card.
    *
@@ -77,6 +148,18 @@ class SdSpiCard {
    * false is returned if single block erase is not supported.
    */
   bool eraseSingleBlockEnable();
+  /** Erase the part of a range of blocks that the card can erase.
+   *
+   * If the card does not support single block erase the range is reduced
+   * to whole erase sectors.  No command is sent if that leaves no blocks.
+   *
+   * \param[in] firstBlock The address of the first block in the range.
+   * \param[in] lastBlock The address of the last block in the range.
+   *
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool trim(uint32_t firstBlock, uint32_t lastBlock);
   /**
    *  Set SD error code.
    *  \param[in] code value for error code.
@@ -94,8 +177,20 @@ class SdSpiCard {
   int errorData() const {
     return m_status;
   }
+#if ENABLE_SD_STATS
+  /** Set all operation counters to zero. */
+  void clearStats() {
+    memset(&m_stats, 0, sizeof(m_stats));
+  }
+  /** \return Operation counters since construction or clearStats(). */
+  const SdCardStats_t* stats() const {
+    return &m_stats;
+  }
+#endif  // ENABLE_SD_STATS
   /**
-   * Check for busy.  MISO low indicates the card is busy.
+   * Check for busy.  MISO low indicates the card is busy.  An open
+   * write multiple blocks sequence is not ended so this may be used
+   * to poll for the end of programming between writeData() calls.
    *
    * \return true if busy else false.
    */
@@ -109,6 +204,59 @@ class SdSpiCard {
    * the value false is returned for failure.
    */
   bool readBlock(uint32_t block, uint8_t* dst);
+#if SD_READ_SINK_SIZE
+  /**
+   * Read a 512 byte block from an SD card and pass it to a sink in runs
+   * of SD_READ_SINK_SIZE bytes as it is received.
+   *
+   * \param[in] block Logical block to be read.
+   * \param[in] sink Function called with each run of data.  The card is
+   * selected while \a sink is called.
+   * \param[in] context Pointer passed to \a sink.
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool readBlock(uint32_t block, readSink_t sink, void* context);
+#endif  // SD_READ_SINK_SIZE
+#if ENABLE_ASYNC_READ
+  /**
+   * Start reading a 512 byte block.  See readBlocksAsync().
+   *
+   * \param[in] block Logical block to be read.
+   * \param[out] dst Pointer to the location that will receive the data.
+   * \param[in] callback Optional function called when the read is done.
+   * \param[in] context Pointer passed to \a callback.
+   * \return The value true is returned if the read was started and
+   * the value false is returned for failure.
+   */
+  bool readBlockAsync(uint32_t block, uint8_t* dst,
+                      readDone_t callback = 0, void* context = 0) {
+    return readBlocksAsync(block, dst, 1, callback, context);
+  }
+  /**
+   * Start reading multiple 512 byte blocks and return while the data is
+   * received.  Call readAsyncStatus() until it returns nonzero.  It
+   * starts each block after the previous block is received and calls
+   * \a callback when all blocks are done.  Any other card access waits
+   * for the read to finish.
+   *
+   * \param[in] block Logical block to be read.
+   * \param[out] dst Pointer to the location that will receive the data.
+   * \param[in] count Number of blocks to be read.
+   * \param[in] callback Optional function called when the read is done.
+   * \param[in] context Pointer passed to \a callback.
+   * \return The value true is returned if the read was started and
+   * the value false is returned for failure.
+   */
+  bool readBlocksAsync(uint32_t block, uint8_t* dst, size_t count,
+                       readDone_t callback = 0, void* context = 0);
+  /** Check for completion of readBlocksAsync().
+   *
+   * \return One if the read is done, zero if the read is in progress
+   * or minus one if the read failed.
+   */
+  int8_t readAsyncStatus();
+#endif  // ENABLE_ASYNC_READ
   /**
    * Read multiple 512 byte blocks from an SD card.
    *
@@ -156,6 +304,16 @@ class SdSpiCard {
    * \return true for success else false.
    */
   bool readOCR(uint32_t* ocr);
+  /** Read the SD Status register with ACMD13.
+   *
+   * The register has the speed class, allocation unit size and erase
+   * timing of the card.  See sdsSpeedClass(), sdsAuBlocks() and
+   * sdsEraseMillis() in SdInfo.h.
+   *
+   * \param[out] sds SD Status register.
+   * \return true for success else false.
+   */
+  bool readStatus(sds_t* sds);
   /** Start a read multiple blocks sequence.
    *
    * \param[in] blockNumber Address of first block in sequence.
@@ -180,6 +338,74 @@ class SdSpiCard {
   uint8_t sckDivisor() {
     return m_sckDivisor;
   }
+#if ENABLE_BUSY_CALLBACK
+  /** Set a function to be called while waiting for the card.
+   *
+   * The callback is called with \a busFree true and the card deselected
+   * during busy waits for programming, erase and stop transmission so it
+   * may use the SPI bus.  It is called with \a busFree false and the card
+   * selected while waiting for a read data token.  Busy waits are limited
+   * by SD_WRITE_TIMEOUT or SD_ERASE_TIMEOUT so the callback should return
+   * quickly.
+   *
+   * Use isBusy() to poll for the end of programming without blocking.
+   *
+   * \param[in] callback Function to call or zero for none.
+   * \param[in] context Pointer passed to \a callback.
+   */
+  void setBusyCallback(busyCallback_t callback, void* context = 0) {
+    m_busyCallback = callback;
+    m_busyContext = context;
+  }
+#endif  // ENABLE_BUSY_CALLBACK
+#if ENABLE_LOCK_HOOKS
+  /** Set a lock for the SPI bus.
+   *
+   * The lock is taken when the card is selected and released when the
+   * card is deselected so other tasks may use devices on the bus between
+   * card commands.
+   *
+   * \param[in] hook Lock hook or zero for none.
+   * \param[in] context Pointer passed to \a hook.
+   */
+  void setBusLock(lockHook_t hook, void* context = 0) {
+    m_busLockHook = hook;
+    m_busLockContext = context;
+  }
+#endif  // ENABLE_LOCK_HOOKS
+#if ENABLE_BUS_SESSION
+  /** Hold the SPI bus for a batch of card operations.
+   *
+   * The SPI transaction is started, the bus lock is taken and the SPI
+   * controller is configured once.  Card operations then only toggle chip
+   * select until endSession() is called.
+   */
+  void beginSession();
+  /** End a session started by beginSession(). */
+  void endSession();
+  /** \return true if a session is active. */
+  bool inSession() const {
+    return m_session;
+  }
+  /** Let another device use the bus during a session.
+   *
+   * The settings in \a regs are restored now and the card settings are
+   * restored by the next card operation.  Each switch is only a few
+   * register writes.  The other device's driver must not begin its own
+   * SPI transaction during the session.  Do not call while an async read
+   * is in progress.
+   *
+   * \param[in] regs Settings saved with spiSaveRegs() after the other
+   * device was configured, or zero if its driver configures the bus.
+   */
+  void lendBus(const SpiRegs_t* regs = 0);
+#endif  // ENABLE_BUS_SESSION
+  /** End any multiple block sequence left open by streaming.
+   *
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool syncBlocks();
   /** Return the card type: SD V1, SD V2 or SDHC
    * \return 0 - SD V1, 1 - SD V2, or 3 - SDHC.
    */
@@ -205,7 +431,11 @@ class SdSpiCard {
    * the value false is returned for failure.
    */
   bool writeBlocks(uint32_t block, const uint8_t* src, size_t count);
-  /** Write one data block in a multiple block write sequence
+  /** Write one data block in a multiple block write sequence.
+   *
+   * The card programs the block after the call returns.  The wait for
+   * programming to finish is done at the start of the next call.
+   *
    * \param[in] src Pointer to the location of the data to be written.
    * \return The value true is returned for success and
    * the value false is returned for failure.
@@ -217,7 +447,11 @@ class SdSpiCard {
    * \param[in] eraseCount The number of blocks to be pre-erased.
    *
    * \note This function is used with writeData() and writeStop()
-   * for optimized multiple block writes.
+   * for optimized multiple block writes.  The sequence stays open until
+   * writeStop() or another command is sent.  writeBlock() and
+   * writeBlocks() continue the sequence if they start at the next block.
+   * If \a blockNumber is the next block of an open sequence the call
+   * does nothing.
    *
    * \return The value true is returned for success and
    * the value false is returned for failure.
@@ -233,12 +467,49 @@ class SdSpiCard {
  private:
   // private functions
   uint8_t cardAcmd(uint8_t cmd, uint32_t arg) {
-    cardCommand(CMD55, 0);
+    // 0XFF if an open sequence could not be ended
+    if (cardCommand(CMD55, 0) == 0XFF) {
+      return 0XFF;
+    }
     return cardCommand(cmd, arg);
   }
   uint8_t cardCommand(uint8_t cmd, uint32_t arg);
   bool readData(uint8_t* dst, size_t count);
+  bool readData(readSink_t sink, void* context);
+  bool readDataToken();
+  // Use CMD18 for a block that continues the open sequence or follows the
+  // last CMD17 read, so random reads don't pay for CMD12.
+  bool readSequential(uint32_t block) {
+#if ENABLE_READ_STREAMING
+    return (m_curState == READ_STATE && block == m_curBlock) ||
+           block == m_nextRead;
+#else  // ENABLE_READ_STREAMING
+    return m_curState == READ_STATE && block == m_curBlock;
+#endif  // ENABLE_READ_STREAMING
+  }
+  bool readSingleStart(uint32_t blockNumber);
+#if ENABLE_ASYNC_READ
+  bool readAsyncBlock();
+  bool readAsyncWait() {
+    int8_t rtn;
+    while ((rtn = readAsyncStatus()) == 0) {}
+    return rtn > 0;
+  }
+  bool spiReceiveDone() {
+    return m_spi->receiveDone();
+  }
+  uint8_t spiReceiveEnd() {
+    return m_spi->receiveEnd();
+  }
+  uint8_t spiReceiveStart(uint8_t* buf, size_t n) {
+    return m_spi->receiveStart(buf, n);
+  }
+#endif  // ENABLE_ASYNC_READ
   bool readRegister(uint8_t cmd, void* buf);
+#if SD_READ_SINK_SIZE
+  bool sckDivisorTest(uint16_t sum);
+  bool sckDivisorTune();
+#endif  // SD_READ_SINK_SIZE
   void chipSelectHigh();
   void chipSelectLow();
   void spiYield();
@@ -259,21 +530,61 @@ class SdSpiCard {
   uint8_t spiReceive(uint8_t* buf, size_t n) {
     return m_spi->receive(buf, n);
   }
+#if USE_SD_CRC
+  uint8_t spiReceive(uint8_t* buf, size_t n, uint16_t* crc) {
+    return m_spi->receive(buf, n, crc);
+  }
+  uint8_t spiSend(const uint8_t* buf, size_t n, uint16_t* crc) {
+    return m_spi->send(buf, n, crc);
+  }
+#endif  // USE_SD_CRC
   void spiSend(uint8_t data) {
     m_spi->send(data);
   }
-  void spiSend(const uint8_t* buf, size_t n) {
-    m_spi->send(buf, n);
+  uint8_t spiSend(const uint8_t* buf, size_t n) {
+    return m_spi->send(buf, n);
   }
   bool useSpiTransactions() {
     return m_spi->useSpiTransactions();
   }
+  // m_curState values
+  static const uint8_t IDLE_STATE = 0;
+  static const uint8_t READ_STATE = 1;
+  static const uint8_t ASYNC_STATE = 2;
+  static const uint8_t WRITE_STATE = 3;
+
   m_spi_t* m_spi;
+  uint32_t m_curBlock;           // next block of an open sequence
+  uint32_t m_nextRead;           // block after the last CMD17 read
+  uint8_t m_curState;            // open multiple block sequence type
+#if ENABLE_ASYNC_READ
+  uint8_t* m_asyncDst;           // destination for next async block
+  size_t m_asyncCount;           // async blocks not yet received
+  readDone_t m_asyncCallback;    // called when async read is done
+  void* m_asyncContext;          // argument for m_asyncCallback
+#endif  // ENABLE_ASYNC_READ
+#if ENABLE_BUSY_CALLBACK
+  busyCallback_t m_busyCallback;  // called during card waits
+  void* m_busyContext;            // argument for m_busyCallback
+#endif  // ENABLE_BUSY_CALLBACK
+#if ENABLE_LOCK_HOOKS
+  lockHook_t m_busLockHook;      // lock for the SPI bus
+  void* m_busLockContext;        // argument for m_busLockHook
+  bool m_busHeld;                // bus lock is held
+#endif  // ENABLE_LOCK_HOOKS
+#if ENABLE_BUS_SESSION
+  bool m_session;                // beginSession() has been called
+  bool m_busLent;                // bus is configured for another device
+  SpiRegs_t m_cardRegs;          // card settings for the session
+#endif  // ENABLE_BUS_SESSION
   uint8_t m_chipSelectPin;
   uint8_t m_errorCode;
   uint8_t m_sckDivisor;
   uint8_t m_status;
   uint8_t m_type;
+#if ENABLE_SD_STATS
+  SdCardStats_t m_stats;         // operation counters
+#endif  // ENABLE_SD_STATS
 };
 //==============================================================================
 /**
@@ -25,6 +25,8 @@
 #define USE_SAM3X_BUS_MATRIX_FIX 0
 /** Time in ms for DMA receive timeout */
 #define SAM3X_DMA_TIMEOUT 100
+/** Bytes per DMA transfer if a CRC is computed during the transfer */
+#define SPI_CRC_CHUNK_SIZE 128
 /** chip select register number */
 #define SPI_CHIP_SEL 3
 /** DMAC receive channel */
@@ -130,6 +132,38 @@ static void spiDmaTX(const uint8_t* src, uint16_t count) {
 
   dmac_channel_enable(SPI_DMAC_TX_CH);
 }
+#if USE_SAM3X_DMAC
+//------------------------------------------------------------------------------
+// start time of receive DMA for timeout
+static uint32_t dmaStartMillis;
+//------------------------------------------------------------------------------
+// start receive DMA with dummy transmit DMA
+static void spiDmaReceiveStart(uint8_t* buf, size_t n) {
+  // clear overrun error
+  uint32_t s = SPI0->SPI_SR;
+
+  spiDmaRX(buf, n);
+  spiDmaTX(0, n);
+  dmaStartMillis = millis();
+}
+//------------------------------------------------------------------------------
+// wait for receive DMA and return error code
+static uint8_t spiDmaReceiveEnd() {
+  uint8_t rtn = 0;
+  while (!dmac_channel_transfer_done(SPI_DMAC_RX_CH)) {
+    if ((millis() - dmaStartMillis) > SAM3X_DMA_TIMEOUT)  {
+      dmac_channel_disable(SPI_DMAC_RX_CH);
+      dmac_channel_disable(SPI_DMAC_TX_CH);
+      rtn = 2;
+      break;
+    }
+  }
+  if (SPI0->SPI_SR & SPI_SR_OVRES) {
+    rtn |= 1;
+  }
+  return rtn;
+}
+#endif  // USE_SAM3X_DMAC
 //------------------------------------------------------------------------------
 //  initialize SPI controller
 void SdSpi::init(uint8_t sckDivisor) {
@@ -163,43 +197,89 @@ uint8_t SdSpi::receive() {
 //------------------------------------------------------------------------------
 /** SPI receive multiple bytes */
 uint8_t SdSpi::receive(uint8_t* buf, size_t n) {
+#if USE_SAM3X_DMAC
+  spiDmaReceiveStart(buf, n);
+  return spiDmaReceiveEnd();
+#else  // USE_SAM3X_DMAC
   Spi* pSpi = SPI0;
-  int rtn = 0;
+  for (size_t i = 0; i < n; i++) {
+    pSpi->SPI_TDR = 0XFF;
+    while ((pSpi->SPI_SR & SPI_SR_RDRF) == 0) {}
+    buf[i] = pSpi->SPI_RDR;
+  }
+  return 0;
+#endif  // USE_SAM3X_DMAC
+}
+#if USE_SD_CRC
+//------------------------------------------------------------------------------
+/** SPI receive multiple bytes and compute CRC of each chunk while the
+ *  next chunk is received */
+uint8_t SdSpi::receive(uint8_t* buf, size_t n, uint16_t* crc) {
 #if USE_SAM3X_DMAC
-  // clear overrun error
-  uint32_t s = pSpi->SPI_SR;
-
-  spiDmaRX(buf, n);
-  spiDmaTX(0, n);
-
-  uint32_t m = millis();
-  while (!dmac_channel_transfer_done(SPI_DMAC_RX_CH)) {
-    if ((millis() - m) > SAM3X_DMA_TIMEOUT)  {
-      dmac_channel_disable(SPI_DMAC_RX_CH);
-      dmac_channel_disable(SPI_DMAC_TX_CH);
-      rtn = 2;
-      break;
+  uint8_t* p = buf;
+  size_t m;
+  for (size_t i = 0; i < n; i += m) {
+    m = n - i < SPI_CRC_CHUNK_SIZE ? n - i : SPI_CRC_CHUNK_SIZE;
+    spiDmaReceiveStart(buf + i, m);
+    *crc = sdCrcUpdate(*crc, p, buf + i - p);
+    p = buf + i;
+    uint8_t rtn = spiDmaReceiveEnd();
+    if (rtn) {
+      return rtn;
     }
   }
-  if (pSpi->SPI_SR & SPI_SR_OVRES) {
-    rtn |= 1;
-  }
+  *crc = sdCrcUpdate(*crc, p, buf + n - p);
+  return 0;
 #else  // USE_SAM3X_DMAC
+  Spi* pSpi = SPI0;
+  uint16_t c = *crc;
   for (size_t i = 0; i < n; i++) {
     pSpi->SPI_TDR = 0XFF;
     while ((pSpi->SPI_SR & SPI_SR_RDRF) == 0) {}
     buf[i] = pSpi->SPI_RDR;
+    c = sdCrcUpdate(c, buf[i]);
   }
+  *crc = c;
+  return 0;
 #endif  // USE_SAM3X_DMAC
-  return rtn;
 }
+#endif  // USE_SD_CRC
+#if ENABLE_ASYNC_READ
+//------------------------------------------------------------------------------
+/** Start SPI receive - DMA continues after return */
+uint8_t SdSpi::receiveStart(uint8_t* buf, size_t n) {
+#if USE_SAM3X_DMAC
+  spiDmaReceiveStart(buf, n);
+  return 0;
+#else  // USE_SAM3X_DMAC
+  return receive(buf, n);
+#endif  // USE_SAM3X_DMAC
+}
+//------------------------------------------------------------------------------
+bool SdSpi::receiveDone() {
+#if USE_SAM3X_DMAC
+  return dmac_channel_transfer_done(SPI_DMAC_RX_CH)
+         || (millis() - dmaStartMillis) > SAM3X_DMA_TIMEOUT;
+#else  // USE_SAM3X_DMAC
+  return true;
+#endif  // USE_SAM3X_DMAC
+}
+//------------------------------------------------------------------------------
+uint8_t SdSpi::receiveEnd() {
+#if USE_SAM3X_DMAC
+  return spiDmaReceiveEnd();
+#else  // USE_SAM3X_DMAC
+  return 0;
+#endif  // USE_SAM3X_DMAC
+}
+#endif  // ENABLE_ASYNC_READ
 //------------------------------------------------------------------------------
 /** SPI send a byte */
 void SdSpi::send(uint8_t b) {
   spiTransfer(b);
 }
 //------------------------------------------------------------------------------
-void SdSpi::send(const uint8_t* buf , size_t n) {
+uint8_t SdSpi::send(const uint8_t* buf , size_t n) {
   Spi* pSpi = SPI0;
 #if USE_SAM3X_DMAC
   spiDmaTX(buf, n);
@@ -214,5 +294,29 @@ void SdSpi::send(const uint8_t* buf , size_t n) {
   while ((pSpi->SPI_SR & SPI_SR_TXEMPTY) == 0) {}
   // leave RDR empty
   uint8_t b = pSpi->SPI_RDR;
+  return 0;
+}
+#if USE_SD_CRC
+//------------------------------------------------------------------------------
+/** SPI send multiple bytes and compute CRC of each chunk while it is sent */
+uint8_t SdSpi::send(const uint8_t* buf , size_t n, uint16_t* crc) {
+#if USE_SAM3X_DMAC
+  Spi* pSpi = SPI0;
+  size_t m;
+  for (size_t i = 0; i < n; i += m) {
+    m = n - i < SPI_CRC_CHUNK_SIZE ? n - i : SPI_CRC_CHUNK_SIZE;
+    spiDmaTX(buf + i, m);
+    *crc = sdCrcUpdate(*crc, buf + i, m);
+    while (!dmac_channel_transfer_done(SPI_DMAC_TX_CH)) {}
+  }
+  while ((pSpi->SPI_SR & SPI_SR_TXEMPTY) == 0) {}
+  // leave RDR empty
+  uint8_t b = pSpi->SPI_RDR;
+  return 0;
+#else  // USE_SAM3X_DMAC
+  *crc = sdCrcUpdate(*crc, buf, n);
+  return send(buf, n);
+#endif  // USE_SAM3X_DMAC
 }
+#endif  // USE_SD_CRC
 #endif  // defined(__SAM3X8E__) || defined(__SAM3X8H__)
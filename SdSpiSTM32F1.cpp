@@ -27,6 +27,8 @@
 #define USE_STM32F1_DMAC 1
 /** Time in ms for DMA receive timeout */
 #define STM32F1_DMA_TIMEOUT 100
+/** Bytes per DMA transfer if a CRC is computed during the transfer */
+#define SPI_CRC_CHUNK_SIZE 128
 /** DMAC receive channel */
 #define SPI1_DMAC_RX_CH  DMA_CH2
 /** DMAC transmit channel */
@@ -38,7 +40,7 @@ volatile bool SPI_DMA_RX_Active = false;
 /** ISR for DMA TX event. */
 inline void SPI_DMA_TX_Event() {
   SPI_DMA_TX_Active = false;
-  dma_disable(DMA1, SPI_DMAC_TX_CH);
+  dma_disable(DMA1, SPI1_DMAC_TX_CH);
 }
 
 /** ISR for DMA RX event. */
@@ -92,6 +94,32 @@ static void spiDmaTX(const uint8_t* src, uint16_t count) {
   SPI_DMA_TX_Active = true;
   dma_enable(DMA1, SPI1_DMAC_TX_CH);
 }
+#if USE_STM32F1_DMAC
+//------------------------------------------------------------------------------
+// start time of receive DMA for timeout
+static uint32_t dmaStartMillis;
+//------------------------------------------------------------------------------
+// start receive DMA with dummy transmit DMA
+static void spiDmaReceiveStart(uint8_t* buf, size_t n) {
+  spiDmaRX(buf, n);
+  spiDmaTX(0, n);
+  dmaStartMillis = millis();
+}
+//------------------------------------------------------------------------------
+// wait for receive DMA and return error code
+static uint8_t spiDmaReceiveEnd() {
+  uint8_t rtn = 0;
+  while (SPI_DMA_RX_Active) {
+    if ((millis() - dmaStartMillis) > STM32F1_DMA_TIMEOUT)  {
+      dmac_channel_disable(SPI1_DMAC_RX_CH);
+      dmac_channel_disable(SPI1_DMAC_TX_CH);
+      rtn = 2;
+      break;
+    }
+  }
+  return rtn;
+}
+#endif  // USE_STM32F1_DMAC
 //------------------------------------------------------------------------------
 //  initialize SPI controller STM32F1
 void SdSpi::init(uint8_t sckDivisor) {
@@ -123,40 +151,84 @@ uint8_t SdSpi::receive() {
 }
 //------------------------------------------------------------------------------
 /** SPI receive multiple bytes */
-// check and finish.
-
 uint8_t SdSpi::receive(uint8_t* buf, size_t n) {
-  int rtn = 0;
-
 #if USE_STM32F1_DMAC
-
-  spiDmaRX(buf, n);
-  spiDmaTX(0, n);
-
-  uint32_t m = millis();
-  while (SPI_DMA_RX_Active) {
-    if ((millis() - m) > STM32F1_DMA_TIMEOUT)  {
-      dmac_channel_disable(SPI_DMAC_RX_CH);
-      dmac_channel_disable(SPI_DMAC_TX_CH);
-      rtn = 2;
-      break;
+  spiDmaReceiveStart(buf, n);
+  return spiDmaReceiveEnd();
+#else  // USE_STM32F1_DMAC
+  for (size_t i = 0; i < n; i++) {
+    buf[i] = SPI.transfer(0xFF);
+  }
+  return 0;
+#endif  // USE_STM32F1_DMAC
+}
+#if USE_SD_CRC
+//------------------------------------------------------------------------------
+/** SPI receive multiple bytes and compute CRC of each chunk while the
+ *  next chunk is received */
+uint8_t SdSpi::receive(uint8_t* buf, size_t n, uint16_t* crc) {
+#if USE_STM32F1_DMAC
+  uint8_t* p = buf;
+  size_t m;
+  for (size_t i = 0; i < n; i += m) {
+    m = n - i < SPI_CRC_CHUNK_SIZE ? n - i : SPI_CRC_CHUNK_SIZE;
+    spiDmaReceiveStart(buf + i, m);
+    *crc = sdCrcUpdate(*crc, p, buf + i - p);
+    p = buf + i;
+    uint8_t rtn = spiDmaReceiveEnd();
+    if (rtn) {
+      return rtn;
     }
   }
-
+  *crc = sdCrcUpdate(*crc, p, buf + n - p);
+  return 0;
 #else  // USE_STM32F1_DMAC
+  uint16_t c = *crc;
   for (size_t i = 0; i < n; i++) {
     buf[i] = SPI.transfer(0xFF);
+    c = sdCrcUpdate(c, buf[i]);
   }
+  *crc = c;
+  return 0;
+#endif  // USE_STM32F1_DMAC
+}
+#endif  // USE_SD_CRC
+#if ENABLE_ASYNC_READ
+//------------------------------------------------------------------------------
+/** Start SPI receive - DMA continues after return */
+uint8_t SdSpi::receiveStart(uint8_t* buf, size_t n) {
+#if USE_STM32F1_DMAC
+  spiDmaReceiveStart(buf, n);
+  return 0;
+#else  // USE_STM32F1_DMAC
+  return receive(buf, n);
+#endif  // USE_STM32F1_DMAC
+}
+//------------------------------------------------------------------------------
+bool SdSpi::receiveDone() {
+#if USE_STM32F1_DMAC
+  return !SPI_DMA_RX_Active
+         || (millis() - dmaStartMillis) > STM32F1_DMA_TIMEOUT;
+#else  // USE_STM32F1_DMAC
+  return true;
 #endif  // USE_STM32F1_DMAC
-  return rtn;
 }
 //------------------------------------------------------------------------------
+uint8_t SdSpi::receiveEnd() {
+#if USE_STM32F1_DMAC
+  return spiDmaReceiveEnd();
+#else  // USE_STM32F1_DMAC
+  return 0;
+#endif  // USE_STM32F1_DMAC
+}
+#endif  // ENABLE_ASYNC_READ
+//------------------------------------------------------------------------------
 /** SPI send a byte */
 void SdSpi::send(uint8_t b) {
   spiTransfer(b);
 }
 //------------------------------------------------------------------------------
-void SdSpi::send(const uint8_t* buf , size_t n) {
+uint8_t SdSpi::send(const uint8_t* buf , size_t n) {
 #if USE_STM32F1_DMAC
   spiDmaTX(buf, n);
   while (SPI_DMA_TX_Active) {}
@@ -167,5 +239,27 @@ void SdSpi::send(const uint8_t* buf , size_t n) {
   // leave RX register empty
   //  while (spi_is_rx_nonempty(SPI1))
   uint8_t b = spi_rx_reg(SPI1);
+  return 0;
+}
+#if USE_SD_CRC
+//------------------------------------------------------------------------------
+/** SPI send multiple bytes and compute CRC of each chunk while it is sent */
+uint8_t SdSpi::send(const uint8_t* buf , size_t n, uint16_t* crc) {
+#if USE_STM32F1_DMAC
+  size_t m;
+  for (size_t i = 0; i < n; i += m) {
+    m = n - i < SPI_CRC_CHUNK_SIZE ? n - i : SPI_CRC_CHUNK_SIZE;
+    spiDmaTX(buf + i, m);
+    *crc = sdCrcUpdate(*crc, buf + i, m);
+    while (SPI_DMA_TX_Active) {}
+  }
+  // leave RX register empty
+  uint8_t b = spi_rx_reg(SPI1);
+  return 0;
+#else  // USE_STM32F1_DMAC
+  *crc = sdCrcUpdate(*crc, buf, n);
+  return send(buf, n);
+#endif  // USE_STM32F1_DMAC
 }
+#endif  // USE_SD_CRC
 #endif  // USE_NATIVE_STM32F1_SPI
@@ -36,6 +36,66 @@
 #ifndef SPI_PUSHR_CTAS
 #define SPI_PUSHR_CTAS(n) (((n) & 7) << 28)
 #endif  // SPI_PUSHR_CTAS
+#if ENABLE_ASYNC_READ
+/** Use eDMA for async receive if nonzero */
+#define USE_KINETISK_DMA 1
+/** Time in ms for DMA receive timeout */
+#define KINETISK_DMA_TIMEOUT 100
+#endif  // ENABLE_ASYNC_READ
+#if USE_KINETISK_DMA
+#include "DMAChannel.h"
+//------------------------------------------------------------------------------
+// Channels are allocated by the Teensy core so other DMA users don't clash.
+static DMAChannel dmaRx;
+static DMAChannel dmaTx;
+// Byte sent while receiving.
+static const uint8_t dmaFill = 0XFF;
+static uint32_t dmaStartMillis;
+//------------------------------------------------------------------------------
+// Start an 8-bit frame receive.  The TX channel writes the low byte of
+// PUSHR so frames use CTAR0.
+static void spiDmaReceiveStart(uint8_t* buf, size_t n) {
+  // clear FIFOs and status flags
+  SPI0_MCR = SPI_MCR_MSTR | SPI_MCR_CLR_RXF | SPI_MCR_CLR_TXF |
+             SPI_MCR_PCSIS(0x1F);
+  SPI0_SR = 0XFF0F0000;
+  dmaRx.clearComplete();
+  dmaRx.clearError();
+  dmaRx.source((volatile uint8_t&)SPI0_POPR);
+  dmaRx.destinationBuffer(buf, n);
+  dmaRx.disableOnCompletion();
+  dmaRx.triggerAtHardwareEvent(DMAMUX_SOURCE_SPI0_RX);
+  dmaTx.clearComplete();
+  dmaTx.source(dmaFill);
+  dmaTx.destination((volatile uint8_t&)SPI0_PUSHR);
+  dmaTx.transferCount(n);
+  dmaTx.disableOnCompletion();
+  dmaTx.triggerAtHardwareEvent(DMAMUX_SOURCE_SPI0_TX);
+  dmaRx.enable();
+  dmaTx.enable();
+  SPI0_RSER = SPI_RSER_RFDF_RE | SPI_RSER_RFDF_DIRS |
+              SPI_RSER_TFFF_RE | SPI_RSER_TFFF_DIRS;
+  dmaStartMillis = millis();
+}
+//------------------------------------------------------------------------------
+// wait for receive DMA and return error code
+static uint8_t spiDmaReceiveEnd() {
+  uint8_t rtn = 0;
+  while (!dmaRx.complete()) {
+    if ((millis() - dmaStartMillis) > KINETISK_DMA_TIMEOUT) {
+      rtn = 2;
+      break;
+    }
+  }
+  dmaRx.disable();
+  dmaTx.disable();
+  SPI0_RSER = 0;
+  if (dmaRx.error() || (SPI0_SR & SPI_SR_RFOF)) {
+    rtn |= 1;
+  }
+  return rtn;
+}
+#endif  // USE_KINETISK_DMA
 //------------------------------------------------------------------------------
 /**
  * initialize SPI pins
@@ -156,6 +216,33 @@ uint8_t SdSpi::receive(uint8_t* buf, size_t n) {
 #endif  // SPI_USE_8BIT_FRAME
   return 0;
 }
+#if USE_SD_CRC
+//------------------------------------------------------------------------------
+/** SPI receive multiple bytes - the CRC module is fast enough to check
+ * the data after the transfer */
+uint8_t SdSpi::receive(uint8_t* buf, size_t n, uint16_t* crc) {
+  uint8_t rtn = receive(buf, n);
+  *crc = sdCrcUpdate(*crc, buf, n);
+  return rtn;
+}
+#endif  // USE_SD_CRC
+#if ENABLE_ASYNC_READ
+//------------------------------------------------------------------------------
+/** Start SPI receive - DMA continues after return */
+uint8_t SdSpi::receiveStart(uint8_t* buf, size_t n) {
+  spiDmaReceiveStart(buf, n);
+  return 0;
+}
+//------------------------------------------------------------------------------
+bool SdSpi::receiveDone() {
+  return dmaRx.complete()
+         || (millis() - dmaStartMillis) > KINETISK_DMA_TIMEOUT;
+}
+//------------------------------------------------------------------------------
+uint8_t SdSpi::receiveEnd() {
+  return spiDmaReceiveEnd();
+}
+#endif  // ENABLE_ASYNC_READ
 //------------------------------------------------------------------------------
 /** SPI send a byte */
 void SdSpi::send(uint8_t b) {
@@ -166,7 +253,7 @@ void SdSpi::send(uint8_t b) {
 }
 //------------------------------------------------------------------------------
 /** SPI send multiple bytes */
-void SdSpi::send(const uint8_t* buf , size_t n) {
+uint8_t SdSpi::send(const uint8_t* buf , size_t n) {
   // clear any data in RX FIFO
   SPI0_MCR = SPI_MCR_MSTR | SPI_MCR_CLR_RXF | SPI_MCR_PCSIS(0x1F);
 #if SPI_USE_8BIT_FRAME
@@ -220,7 +307,16 @@ void SdSpi::send(const uint8_t* buf , size_t n) {
     nf--;
   }
 #endif  // SPI_USE_8BIT_FRAME
+  return 0;
+}
+#if USE_SD_CRC
+//------------------------------------------------------------------------------
+/** SPI send multiple bytes and update a CRC */
+uint8_t SdSpi::send(const uint8_t* buf , size_t n, uint16_t* crc) {
+  *crc = sdCrcUpdate(*crc, buf, n);
+  return send(buf, n);
 }
+#endif  // USE_SD_CRC
 #else  // KINETISK
 //==============================================================================
 // Use standard SPI library if not KINETISK
@@ -280,6 +376,20 @@ uint8_t SdSpi::receive(uint8_t* buf, size_t n) {
   }
   return 0;
 }
+#if ENABLE_ASYNC_READ
+// No DMA version - receive before returning.
+uint8_t SdSpi::receiveStart(uint8_t* buf, size_t n) {
+  return receive(buf, n);
+}
+//------------------------------------------------------------------------------
+bool SdSpi::receiveDone() {
+  return true;
+}
+//------------------------------------------------------------------------------
+uint8_t SdSpi::receiveEnd() {
+  return 0;
+}
+#endif  // ENABLE_ASYNC_READ
 /** Send a byte.
  *
  * \param[in] b Byte to send
@@ -292,10 +402,33 @@ void SdSpi::send(uint8_t b) {
  * \param[in] buf Buffer for data to be sent.
  * \param[in] n Number of bytes to send.
  */
-void SdSpi::send(const uint8_t* buf , size_t n) {
+uint8_t SdSpi::send(const uint8_t* buf , size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    SPI.transfer(buf[i]);
+  }
+  return 0;
+}
+#if USE_SD_CRC
+/** Receive multiple bytes and update a CRC. */
+uint8_t SdSpi::receive(uint8_t* buf, size_t n, uint16_t* crc) {
+  uint16_t c = *crc;
+  for (size_t i = 0; i < n; i++) {
+    buf[i] = SPI.transfer(0XFF);
+    c = sdCrcUpdate(c, buf[i]);
+  }
+  *crc = c;
+  return 0;
+}
+/** Send multiple bytes and update a CRC. */
+uint8_t SdSpi::send(const uint8_t* buf , size_t n, uint16_t* crc) {
+  uint16_t c = *crc;
   for (size_t i = 0; i < n; i++) {
     SPI.transfer(buf[i]);
+    c = sdCrcUpdate(c, buf[i]);
   }
+  *crc = c;
+  return 0;
 }
+#endif  // USE_SD_CRC
 #endif  // KINETISK
 #endif  // defined(__arm__) && defined(CORE_TEENSY)
@@ -66,6 +66,29 @@ class SdVolume : public FatVolume {
   bool writeBlocks(uint32_t block, const uint8_t* src, size_t n) {
     return m_sdCard->writeBlocks(block, src, n);
   }
+#if ENABLE_ASYNC_READ
+  bool readBlocksAsync(uint32_t block, uint8_t* dst, size_t n,
+                       readDone_t callback, void* context) {
+    return m_sdCard->readBlocksAsync(block, dst, n, callback, context);
+  }
+  int8_t readAsyncStatus() {
+    return m_sdCard->readAsyncStatus();
+  }
+#endif  // ENABLE_ASYNC_READ
+#if SD_READ_SINK_SIZE
+  bool readBlockSink(uint32_t block, readSink_t sink, void* context) {
+    return m_sdCard->readBlock(block, sink, context);
+  }
+#endif  // SD_READ_SINK_SIZE
+  bool syncBlocks() {
+    return m_sdCard->syncBlocks();
+  }
+  bool isBusy() {
+    return m_sdCard->isBusy();
+  }
+  bool writeStart(uint32_t block, uint32_t eraseCount) {
+    return m_sdCard->writeStart(block, eraseCount);
+  }
   Sd2Card* m_sdCard;             // Sd2Card object for cache
 };
 #endif  // SdVolume_h
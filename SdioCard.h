@@ -0,0 +1,190 @@
+/* Arduino SdFat Library
+ * Copyright (C) 2012 by William Greiman
+ *
+ * This file is part of the Arduino SdFat Library
+ *
+ * This Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Arduino SdFat Library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#ifndef SdioCard_h
+#define SdioCard_h
+/**
+ * \file
+ * \brief SdioCard class
+ */
+#include <Arduino.h>
+#include <SdFatConfig.h>
+#include <SdInfo.h>
+#if HAS_SDIO_CLASS || defined(DOXYGEN)
+//==============================================================================
+/**
+ * \class SdioCard
+ * \brief Raw access to SD and SDHC cards on a 4-bit SDIO bus with DMA.
+ *
+ * The interface matches the SdSpiCard block functions used by FatVolume.
+ */
+class SdioCard {
+ public:
+  /** Construct an instance of SdioCard. */
+  SdioCard() : m_errorCode(SD_CARD_ERROR_INIT_NOT_CALLED), m_type(0) {}
+  /** Initialize the SD card.
+   * \param[in] kHzMax Maximum SDIO clock in kHz, 25000 for default speed.
+   * \return true for success else false.
+   */
+  bool begin(uint32_t kHzMax = 25000);
+  /**
+   * Determine the size of an SD flash memory card.
+   *
+   * \return The number of 512 byte data blocks in the card
+   *         or zero if an error occurs.
+   */
+  uint32_t cardSize();
+  /** Erase a range of blocks.
+   *
+   * \param[in] firstBlock The address of the first block in the range.
+   * \param[in] lastBlock The address of the last block in the range.
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool erase(uint32_t firstBlock, uint32_t lastBlock);
+  /** Erase the part of a range of blocks that the card can erase.
+   *
+   * \param[in] firstBlock The address of the first block in the range.
+   * \param[in] lastBlock The address of the last block in the range.
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool trim(uint32_t firstBlock, uint32_t lastBlock);
+  /**
+   * \return code for the last error. See SdInfo.h for a list of error codes.
+   */
+  int errorCode() const {
+    return m_errorCode;
+  }
+  /** \return SDHC interrupt status for the last error. */
+  uint32_t errorData() const {
+    return m_irqstat;
+  }
+  /** Check for busy with CMD13.
+   *
+   * \return true if busy else false.
+   */
+  bool isBusy();
+  /** \return The SDIO clock in kHz. */
+  uint32_t kHzSdClk() const {
+    return m_sdClkKhz;
+  }
+  /**
+   * Read a 512 byte block from an SD card.
+   *
+   * \param[in] block Logical block to be read.
+   * \param[out] dst Pointer to the location that will receive the data.
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool readBlock(uint32_t block, uint8_t* dst);
+  /**
+   * Read multiple 512 byte blocks from an SD card.
+   *
+   * \param[in] block Logical block to be read.
+   * \param[in] count Number of blocks to be read.
+   * \param[out] dst Pointer to the location that will receive the data.
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool readBlocks(uint32_t block, uint8_t* dst, size_t count);
+  /**
+   * Read a card's CID register.
+   *
+   * \param[out] cid pointer to area for returned data.
+   * \return true for success or false for failure.
+   */
+  bool readCID(cid_t* cid);
+  /**
+   * Read a card's CSD register.
+   *
+   * \param[out] csd pointer to area for returned data.
+   * \return true for success or false for failure.
+   */
+  bool readCSD(csd_t* csd);
+  /** Read OCR register.
+   *
+   * \param[out] ocr OCR from the last ACMD41 of begin().
+   * \return true.
+   */
+  bool readOCR(uint32_t* ocr) {
+    *ocr = m_ocr;
+    return true;
+  }
+  /** Read the SD Status register with ACMD13.
+   *
+   * \param[out] sds SD Status register.
+   * \return true for success else false.
+   */
+  bool readStatus(sds_t* sds);
+  /** Nothing is left open between calls.
+   * \return true.
+   */
+  bool syncBlocks() {
+    return true;
+  }
+  /** Return the card type: SD V1, SD V2 or SDHC
+   * \return 0 - SD V1, 1 - SD V2, or 3 - SDHC.
+   */
+  int type() const {
+    return m_type;
+  }
+  /**
+   * Writes a 512 byte block to an SD card.
+   *
+   * \param[in] block Logical block to be written.
+   * \param[in] src Pointer to the location of the data to be written.
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool writeBlock(uint32_t block, const uint8_t* src);
+  /**
+   * Write multiple 512 byte blocks to an SD card.
+   *
+   * \param[in] block Logical block to be written.
+   * \param[in] count Number of blocks to be written.
+   * \param[in] src Pointer to the location of the data to be written.
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool writeBlocks(uint32_t block, const uint8_t* src, size_t count);
+
+ private:
+  bool cardAcmd(uint32_t xfertyp, uint32_t arg);
+  bool cardCommand(uint32_t xfertyp, uint32_t arg);
+  bool error(uint8_t code) {
+    m_errorCode = code;
+    return false;
+  }
+  bool rdWrBlocks(uint32_t xfertyp, uint32_t block, uint8_t* buf, size_t n);
+  bool readReg16(uint32_t xfertyp, void* data);
+  void setSdClk(uint32_t kHzMax);
+  bool waitNotBusy();
+  bool waitTransfer();
+
+  csd_t m_csd;                   // CSD read during begin()
+  uint32_t m_irqstat;            // SDHC interrupt status for last command
+  uint32_t m_ocr;                // OCR from the last ACMD41
+  uint32_t m_rca;                // relative card address shifted 16 bits
+  uint32_t m_sdClkKhz;           // SDIO clock in kHz
+  uint8_t m_errorCode;
+  uint8_t m_type;
+};
+#endif  // HAS_SDIO_CLASS || defined(DOXYGEN)
+#endif  // SdioCard_h
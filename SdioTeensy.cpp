@@ -0,0 +1,421 @@
+/* Arduino SdFat Library
+ * Copyright (C) 2012 by William Greiman
+ *
+ * This file is part of the Arduino SdFat Library
+ *
+ * This Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Arduino SdFat Library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#include "SdioCard.h"
+#if HAS_SDIO_CLASS
+// Teensy 3.5/3.6 SDHC controller
+#include "kinetis.h"
+#ifndef SDHC_SYSCTL_RSTC
+#define SDHC_SYSCTL_RSTC ((uint32_t)0X02000000)
+#endif  // SDHC_SYSCTL_RSTC
+//------------------------------------------------------------------------------
+// Card status and OCR bits.
+const uint32_t CARD_STATUS_READY_FOR_DATA = 1 << 8;
+const uint32_t OCR_BUSY = 0X80000000;
+const uint32_t OCR_CCS = 0X40000000;
+// ACMD41 argument for 3.2-3.4 volts and high capacity.
+const uint32_t ACMD41_ARG = 0X40300000;
+// Ready and busy timeouts in millis.
+const uint16_t SDIO_INIT_TIMEOUT = 2000;
+const uint16_t SDIO_BUSY_TIMEOUT = SD_ERASE_TIMEOUT;
+//------------------------------------------------------------------------------
+// IRQSTAT bits for command and data errors.
+const uint32_t SDHC_IRQSTAT_CMD_ERROR = SDHC_IRQSTAT_CIE | SDHC_IRQSTAT_CEBE |
+                                        SDHC_IRQSTAT_CCE | SDHC_IRQSTAT_CTOE;
+const uint32_t SDHC_IRQSTAT_DATA_ERROR = SDHC_IRQSTAT_AC12E |
+    SDHC_IRQSTAT_DEBE | SDHC_IRQSTAT_DCE | SDHC_IRQSTAT_DTOE |
+    SDHC_IRQSTAT_DMAE;
+const uint32_t SDHC_IRQSTAT_ERROR = SDHC_IRQSTAT_CMD_ERROR |
+                                    SDHC_IRQSTAT_DATA_ERROR;
+// IRQSTATEN bits are at the same positions as the IRQSTAT bits.
+const uint32_t SDHC_IRQSTATEN_MASK = SDHC_IRQSTAT_ERROR | SDHC_IRQSTAT_CC |
+                                     SDHC_IRQSTAT_TC | SDHC_IRQSTAT_DINT;
+//------------------------------------------------------------------------------
+// XFERTYP response types.
+const uint32_t XFERTYP_RESP_NONE = SDHC_XFERTYP_RSPTYP(0);
+const uint32_t XFERTYP_RESP_R2 = SDHC_XFERTYP_RSPTYP(1) | SDHC_XFERTYP_CCCEN;
+const uint32_t XFERTYP_RESP_R3 = SDHC_XFERTYP_RSPTYP(2);
+const uint32_t XFERTYP_RESP_R1 = SDHC_XFERTYP_RSPTYP(2) |
+                                 SDHC_XFERTYP_CICEN | SDHC_XFERTYP_CCCEN;
+const uint32_t XFERTYP_RESP_R1b = SDHC_XFERTYP_RSPTYP(3) |
+                                  SDHC_XFERTYP_CICEN | SDHC_XFERTYP_CCCEN;
+// XFERTYP data transfers.
+const uint32_t XFERTYP_DATA_READ = SDHC_XFERTYP_DPSEL | SDHC_XFERTYP_DTDSEL |
+                                   SDHC_XFERTYP_DMAEN;
+const uint32_t XFERTYP_DATA_WRITE = SDHC_XFERTYP_DPSEL | SDHC_XFERTYP_DMAEN;
+const uint32_t XFERTYP_MULTI = SDHC_XFERTYP_MSBSEL | SDHC_XFERTYP_AC12EN |
+                               SDHC_XFERTYP_BCEN;
+//------------------------------------------------------------------------------
+// XFERTYP for each command.
+const uint32_t ACMD6_XFERTYP = SDHC_XFERTYP_CMDINX(ACMD6) | XFERTYP_RESP_R1;
+const uint32_t ACMD13_XFERTYP = SDHC_XFERTYP_CMDINX(ACMD13) | XFERTYP_RESP_R1 |
+                                XFERTYP_DATA_READ;
+const uint32_t ACMD41_XFERTYP = SDHC_XFERTYP_CMDINX(ACMD41) | XFERTYP_RESP_R3;
+const uint32_t CMD0_XFERTYP = SDHC_XFERTYP_CMDINX(CMD0) | XFERTYP_RESP_NONE;
+const uint32_t CMD2_XFERTYP = SDHC_XFERTYP_CMDINX(CMD2) | XFERTYP_RESP_R2;
+const uint32_t CMD3_XFERTYP = SDHC_XFERTYP_CMDINX(CMD3) | XFERTYP_RESP_R1;
+const uint32_t CMD7_XFERTYP = SDHC_XFERTYP_CMDINX(CMD7) | XFERTYP_RESP_R1b;
+const uint32_t CMD8_XFERTYP = SDHC_XFERTYP_CMDINX(CMD8) | XFERTYP_RESP_R1;
+const uint32_t CMD9_XFERTYP = SDHC_XFERTYP_CMDINX(CMD9) | XFERTYP_RESP_R2;
+const uint32_t CMD10_XFERTYP = SDHC_XFERTYP_CMDINX(CMD10) | XFERTYP_RESP_R2;
+const uint32_t CMD13_XFERTYP = SDHC_XFERTYP_CMDINX(CMD13) | XFERTYP_RESP_R1;
+const uint32_t CMD17_XFERTYP = SDHC_XFERTYP_CMDINX(CMD17) | XFERTYP_RESP_R1 |
+                               XFERTYP_DATA_READ;
+const uint32_t CMD18_XFERTYP = SDHC_XFERTYP_CMDINX(CMD18) | XFERTYP_RESP_R1 |
+                               XFERTYP_DATA_READ | XFERTYP_MULTI;
+const uint32_t CMD24_XFERTYP = SDHC_XFERTYP_CMDINX(CMD24) | XFERTYP_RESP_R1 |
+                               XFERTYP_DATA_WRITE;
+const uint32_t CMD25_XFERTYP = SDHC_XFERTYP_CMDINX(CMD25) | XFERTYP_RESP_R1 |
+                               XFERTYP_DATA_WRITE | XFERTYP_MULTI;
+const uint32_t CMD32_XFERTYP = SDHC_XFERTYP_CMDINX(CMD32) | XFERTYP_RESP_R1;
+const uint32_t CMD33_XFERTYP = SDHC_XFERTYP_CMDINX(CMD33) | XFERTYP_RESP_R1;
+const uint32_t CMD38_XFERTYP = SDHC_XFERTYP_CMDINX(CMD38) | XFERTYP_RESP_R1b;
+const uint32_t CMD55_XFERTYP = SDHC_XFERTYP_CMDINX(CMD55) | XFERTYP_RESP_R1;
+//------------------------------------------------------------------------------
+// Connect SDHC signals to the SD socket, PTE0-PTE5 alternative 4.
+static void enableGPIO() {
+  const uint32_t PORT_CLK = PORT_PCR_MUX(4) | PORT_PCR_DSE;
+  const uint32_t PORT_CMD_DATA = PORT_PCR_MUX(4) | PORT_PCR_PS |
+                                 PORT_PCR_PE | PORT_PCR_DSE;
+  PORTE_PCR0 = PORT_CMD_DATA;  // SDHC_D1
+  PORTE_PCR1 = PORT_CMD_DATA;  // SDHC_D0
+  PORTE_PCR2 = PORT_CLK;       // SDHC_CLK
+  PORTE_PCR3 = PORT_CMD_DATA;  // SDHC_CMD
+  PORTE_PCR4 = PORT_CMD_DATA;  // SDHC_D3
+  PORTE_PCR5 = PORT_CMD_DATA;  // SDHC_D2
+}
+//==============================================================================
+bool SdioCard::begin(uint32_t kHzMax) {
+  uint16_t t0;
+  m_type = 0;
+  m_rca = 0;
+  // Clock the SDHC and PORTE and use the core clock for SDCLK.
+  SIM_SCGC3 |= SIM_SCGC3_SDHC;
+  SIM_SCGC5 |= SIM_SCGC5_PORTE;
+  SIM_SOPT2 = (SIM_SOPT2 & ~SIM_SOPT2_SDHCSRC(3)) | SIM_SOPT2_SDHCSRC(0);
+
+  // Reset the controller and start at 400 kHz.
+  SDHC_SYSCTL = SDHC_SYSCTL_RSTA | SDHC_SYSCTL_SDCLKFS(0X80);
+  while (SDHC_SYSCTL & SDHC_SYSCTL_RSTA) {}
+  setSdClk(400);
+  enableGPIO();
+  SDHC_IRQSTATEN = SDHC_IRQSTATEN_MASK;
+
+  // Send 80 clocks to the card.
+  SDHC_SYSCTL |= SDHC_SYSCTL_INITA;
+  while (SDHC_SYSCTL & SDHC_SYSCTL_INITA) {}
+
+  if (!cardCommand(CMD0_XFERTYP, 0)) {
+    return error(SD_CARD_ERROR_CMD0);
+  }
+  // V1 cards do not respond to CMD8.
+  if (cardCommand(CMD8_XFERTYP, 0X1AA)) {
+    if (SDHC_CMDRSP0 != 0X1AA) {
+      return error(SD_CARD_ERROR_CMD8);
+    }
+    m_type = SD_CARD_TYPE_SD2;
+  } else {
+    // Reset the CMD line after the timeout.
+    SDHC_SYSCTL |= SDHC_SYSCTL_RSTC;
+    while (SDHC_SYSCTL & SDHC_SYSCTL_RSTC) {}
+    m_type = SD_CARD_TYPE_SD1;
+  }
+  t0 = millis();
+  do {
+    if (((uint16_t)millis() - t0) > SDIO_INIT_TIMEOUT ||
+        !cardAcmd(ACMD41_XFERTYP,
+                  m_type == SD_CARD_TYPE_SD2 ? ACMD41_ARG : 0X00300000)) {
+      return error(SD_CARD_ERROR_ACMD41);
+    }
+    m_ocr = SDHC_CMDRSP0;
+  } while (!(m_ocr & OCR_BUSY));
+  if (m_ocr & OCR_CCS) {
+    m_type = SD_CARD_TYPE_SDHC;
+  }
+  // Identify the card, get its address and select it.
+  if (!cardCommand(CMD2_XFERTYP, 0) || !cardCommand(CMD3_XFERTYP, 0)) {
+    return error(SD_CARD_ERROR_SDIO_SELECT);
+  }
+  m_rca = SDHC_CMDRSP0 & 0XFFFF0000;
+  if (!readReg16(CMD9_XFERTYP, &m_csd)) {
+    return error(SD_CARD_ERROR_READ_REG);
+  }
+  if (!cardCommand(CMD7_XFERTYP, m_rca)) {
+    return error(SD_CARD_ERROR_SDIO_SELECT);
+  }
+  // Four bit bus.
+  if (!cardAcmd(ACMD6_XFERTYP, 2)) {
+    return error(SD_CARD_ERROR_ACMD6);
+  }
+  SDHC_PROCTL &= ~SDHC_PROCTL_DTW_MASK;
+  SDHC_PROCTL |= SDHC_PROCTL_DTW(1);
+  setSdClk(kHzMax);
+  m_errorCode = 0;
+  return true;
+}
+//------------------------------------------------------------------------------
+bool SdioCard::cardAcmd(uint32_t xfertyp, uint32_t arg) {
+  return cardCommand(CMD55_XFERTYP, m_rca) && cardCommand(xfertyp, arg);
+}
+//------------------------------------------------------------------------------
+// Send a command and wait for the response.  True if no errors.
+bool SdioCard::cardCommand(uint32_t xfertyp, uint32_t arg) {
+  uint32_t inhibit = SDHC_PRSSTAT_CIHB;
+  if (xfertyp & (SDHC_XFERTYP_DPSEL | SDHC_XFERTYP_RSPTYP(3))) {
+    inhibit |= SDHC_PRSSTAT_CDIHB;
+  }
+  while (SDHC_PRSSTAT & inhibit) {}
+  SDHC_IRQSTAT = SDHC_IRQSTAT;
+  SDHC_CMDARG = arg;
+  SDHC_XFERTYP = xfertyp;
+  while (!(SDHC_IRQSTAT & (SDHC_IRQSTAT_CC | SDHC_IRQSTAT_CMD_ERROR))) {}
+  m_irqstat = SDHC_IRQSTAT;
+  SDHC_IRQSTAT = m_irqstat & (SDHC_IRQSTAT_CC | SDHC_IRQSTAT_CMD_ERROR);
+  return (m_irqstat & SDHC_IRQSTAT_CC) &&
+         !(m_irqstat & SDHC_IRQSTAT_CMD_ERROR);
+}
+//------------------------------------------------------------------------------
+uint32_t SdioCard::cardSize() {
+  if (m_csd.v1.csd_ver == 0) {
+    uint8_t read_bl_len = m_csd.v1.read_bl_len;
+    uint16_t c_size = (m_csd.v1.c_size_high << 10)
+                      | (m_csd.v1.c_size_mid << 2) | m_csd.v1.c_size_low;
+    uint8_t c_size_mult = (m_csd.v1.c_size_mult_high << 1)
+                          | m_csd.v1.c_size_mult_low;
+    return (uint32_t)(c_size + 1) << (c_size_mult + read_bl_len - 7);
+  } else if (m_csd.v2.csd_ver == 1) {
+    uint32_t c_size = 0X10000L * m_csd.v2.c_size_high + 0X100L
+                      * (uint32_t)m_csd.v2.c_size_mid + m_csd.v2.c_size_low;
+    return (c_size + 1) << 10;
+  }
+  error(SD_CARD_ERROR_BAD_CSD);
+  return 0;
+}
+//------------------------------------------------------------------------------
+bool SdioCard::erase(uint32_t firstBlock, uint32_t lastBlock) {
+  // check for single block erase
+  if (!m_csd.v1.erase_blk_en) {
+    // erase size mask
+    uint8_t m = (m_csd.v1.sector_size_high << 1) | m_csd.v1.sector_size_low;
+    if ((firstBlock & m) != 0 || ((lastBlock + 1) & m) != 0) {
+      // error card can't erase specified area
+      return error(SD_CARD_ERROR_ERASE_SINGLE_BLOCK);
+    }
+  }
+  if (m_type != SD_CARD_TYPE_SDHC) {
+    firstBlock <<= 9;
+    lastBlock <<= 9;
+  }
+  if (!cardCommand(CMD32_XFERTYP, firstBlock) ||
+      !cardCommand(CMD33_XFERTYP, lastBlock) ||
+      !cardCommand(CMD38_XFERTYP, 0)) {
+    return error(SD_CARD_ERROR_ERASE);
+  }
+  if (!waitNotBusy()) {
+    return error(SD_CARD_ERROR_ERASE_TIMEOUT);
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+bool SdioCard::trim(uint32_t firstBlock, uint32_t lastBlock) {
+  if (!m_csd.v1.erase_blk_en) {
+    // round to whole erase sectors
+    uint8_t m = (m_csd.v1.sector_size_high << 1) | m_csd.v1.sector_size_low;
+    firstBlock = (firstBlock + m) & ~(uint32_t)m;
+    lastBlock = ((lastBlock + 1) & ~(uint32_t)m) - 1;
+    if ((lastBlock + 1) <= firstBlock) {
+      return true;
+    }
+  }
+  return erase(firstBlock, lastBlock);
+}
+//------------------------------------------------------------------------------
+bool SdioCard::isBusy() {
+  return !cardCommand(CMD13_XFERTYP, m_rca) ||
+         !(SDHC_CMDRSP0 & CARD_STATUS_READY_FOR_DATA);
+}
+//------------------------------------------------------------------------------
+bool SdioCard::readBlock(uint32_t block, uint8_t* dst) {
+  // DMA needs a word aligned buffer.
+  uint32_t aligned[128];
+  uint8_t* ptr = (uint32_t)dst & 3 ? (uint8_t*)aligned : dst;
+  if (!rdWrBlocks(CMD17_XFERTYP, block, ptr, 1)) {
+    return error(SD_CARD_ERROR_CMD17);
+  }
+  if (ptr != dst) {
+    memcpy(dst, aligned, 512);
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+bool SdioCard::readBlocks(uint32_t block, uint8_t* dst, size_t count) {
+  if ((uint32_t)dst & 3) {
+    for (size_t i = 0; i < count; i++, dst += 512) {
+      if (!readBlock(block + i, dst)) {
+        return false;
+      }
+    }
+    return true;
+  }
+  if (!rdWrBlocks(CMD18_XFERTYP, block, dst, count)) {
+    return error(SD_CARD_ERROR_CMD18);
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+bool SdioCard::readCID(cid_t* cid) {
+  if (!readReg16(CMD10_XFERTYP, cid)) {
+    return error(SD_CARD_ERROR_READ_REG);
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+bool SdioCard::readCSD(csd_t* csd) {
+  memcpy(csd, &m_csd, sizeof(csd_t));
+  return true;
+}
+//------------------------------------------------------------------------------
+bool SdioCard::readStatus(sds_t* sds) {
+  // DMA needs a word aligned buffer.
+  uint32_t aligned[16];
+  if (!waitNotBusy()) {
+    return false;
+  }
+  SDHC_IRQSTAT = SDHC_IRQSTAT;
+  SDHC_DSADDR  = (uint32_t)aligned;
+  SDHC_BLKATTR = SDHC_BLKATTR_BLKCNT(1) | SDHC_BLKATTR_BLKSIZE(64);
+  if (!cardAcmd(ACMD13_XFERTYP, 0) || !waitTransfer()) {
+    return error(SD_CARD_ERROR_ACMD13);
+  }
+  memcpy(sds, aligned, sizeof(sds_t));
+  return true;
+}
+//------------------------------------------------------------------------------
+// Read a 136 bit response.  RSP0-RSP3 hold bits 127:8 of the register.
+bool SdioCard::readReg16(uint32_t xfertyp, void* data) {
+  uint8_t* d = reinterpret_cast<uint8_t*>(data);
+  if (!cardCommand(xfertyp, m_rca)) {
+    return false;
+  }
+  uint32_t sr[] = {SDHC_CMDRSP0, SDHC_CMDRSP1, SDHC_CMDRSP2, SDHC_CMDRSP3};
+  for (uint8_t i = 0; i < 15; i++) {
+    d[14 - i] = sr[i/4] >> 8*(i%4);
+  }
+  d[15] = 0;
+  return true;
+}
+//------------------------------------------------------------------------------
+// Transfer n blocks by DMA.  buf must be word aligned.
+bool SdioCard::rdWrBlocks(uint32_t xfertyp,
+                          uint32_t block, uint8_t* buf, size_t n) {
+  if (n == 0 || n > 0XFFFF) {
+    return false;
+  }
+  if (!waitNotBusy()) {
+    return false;
+  }
+  SDHC_IRQSTAT = SDHC_IRQSTAT;
+  SDHC_DSADDR  = (uint32_t)buf;
+  SDHC_BLKATTR = SDHC_BLKATTR_BLKCNT(n) | SDHC_BLKATTR_BLKSIZE(512);
+  if (!cardCommand(xfertyp, m_type == SD_CARD_TYPE_SDHC ? block : block << 9)) {
+    return false;
+  }
+  return waitTransfer();
+}
+//------------------------------------------------------------------------------
+void SdioCard::setSdClk(uint32_t kHzMax) {
+  const uint32_t DVS_LIMIT = 0X10;
+  const uint32_t SDCLKFS_LIMIT = 0X100;
+  uint32_t dvs = 1;
+  uint32_t sdclkfs = 1;
+  uint32_t maxSdclk = 1000*kHzMax;
+
+  while ((F_CPU/(sdclkfs*DVS_LIMIT) > maxSdclk) && (sdclkfs < SDCLKFS_LIMIT)) {
+    sdclkfs <<= 1;
+  }
+  while ((F_CPU/(sdclkfs*dvs) > maxSdclk) && (dvs < DVS_LIMIT)) {
+    dvs++;
+  }
+  m_sdClkKhz = F_CPU/(1000*sdclkfs*dvs);
+  sdclkfs >>= 1;
+  dvs--;
+
+  // Change dividers with SDCLK off.
+  SDHC_SYSCTL &= ~SDHC_SYSCTL_SDCLKEN;
+  uint32_t sysctl = SDHC_SYSCTL & ~(SDHC_SYSCTL_DTOCV_MASK |
+                    SDHC_SYSCTL_DVS_MASK | SDHC_SYSCTL_SDCLKFS_MASK);
+  SDHC_SYSCTL = sysctl | SDHC_SYSCTL_DTOCV(0X0E) | SDHC_SYSCTL_DVS(dvs) |
+                SDHC_SYSCTL_SDCLKFS(sdclkfs);
+  while (!(SDHC_PRSSTAT & SDHC_PRSSTAT_SDSTB)) {}
+  SDHC_SYSCTL |= SDHC_SYSCTL_SDCLKEN;
+}
+//------------------------------------------------------------------------------
+// Wait for the card to be ready for data after programming or erase.
+bool SdioCard::waitNotBusy() {
+  uint16_t t0 = millis();
+  while (isBusy()) {
+    if (((uint16_t)millis() - t0) > SDIO_BUSY_TIMEOUT) {
+      return error(SD_CARD_ERROR_CMD13);
+    }
+    yield();
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+// Wait for DMA transfer complete.  Auto CMD12 ends multiple block transfers.
+bool SdioCard::waitTransfer() {
+  while (!(SDHC_IRQSTAT & (SDHC_IRQSTAT_TC | SDHC_IRQSTAT_DATA_ERROR))) {
+    yield();
+  }
+  m_irqstat = SDHC_IRQSTAT;
+  SDHC_IRQSTAT = m_irqstat;
+  if (m_irqstat & SDHC_IRQSTAT_DATA_ERROR) {
+    return error(SD_CARD_ERROR_SDIO_DMA);
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+bool SdioCard::writeBlock(uint32_t block, const uint8_t* src) {
+  uint32_t aligned[128];
+  uint8_t* ptr = const_cast<uint8_t*>(src);
+  if ((uint32_t)src & 3) {
+    memcpy(aligned, src, 512);
+    ptr = reinterpret_cast<uint8_t*>(aligned);
+  }
+  if (!rdWrBlocks(CMD24_XFERTYP, block, ptr, 1)) {
+    return error(SD_CARD_ERROR_CMD24);
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+bool SdioCard::writeBlocks(uint32_t block, const uint8_t* src, size_t count) {
+  if ((uint32_t)src & 3) {
+    for (size_t i = 0; i < count; i++, src += 512) {
+      if (!writeBlock(block + i, src)) {
+        return false;
+      }
+    }
+    return true;
+  }
+  if (!rdWrBlocks(CMD25_XFERTYP, block, const_cast<uint8_t*>(src), count)) {
+    return error(SD_CARD_ERROR_CMD25);
+  }
+  return true;
+}
+#endif  // HAS_SDIO_CLASS
@@ -24,6 +24,7 @@
  * \brief SdFat class
  */
 #include "SdSpiCard.h"
+#include "SdioCard.h"
 #include "utility/FatLib.h"
 //------------------------------------------------------------------------------
 /** SdFat version YYYYMMDD */
@@ -80,8 +81,27 @@ class SdFatBase : public FatFileSystem {
    */
   bool begin(SdSpiCard::m_spi_t* spi, uint8_t csPin = SS, uint8_t divisor = 2) {
     return m_sdCard.begin(spi, csPin, divisor) &&
-           FatFileSystem::begin();
+           FatFileSystem::begin() && cardAllocUnit();
   }
+#if ENABLE_WARM_MOUNT
+  /** Initialize SD card and file system from saved parameters.  Falls
+   * back to a full begin() if the card or volume has changed.
+   * \param[in] spi SPI object for the card.
+   * \param[in] geo Volume parameters from saveGeometry().
+   * \param[in] cardType Card type from card()->type().
+   * \param[in] csPin SD card chip select pin.
+   * \param[in] divisor SPI divisor.
+   * \return true for success else false.
+   */
+  bool beginWarm(SdSpiCard::m_spi_t* spi, const FatGeometry_t* geo,
+                 uint8_t cardType, uint8_t csPin = SS, uint8_t divisor = 2) {
+    if (!m_sdCard.beginWarm(spi, csPin, divisor, cardType)) {
+      return false;
+    }
+    return (FatFileSystem::beginWarm(geo) || FatFileSystem::begin()) &&
+           cardAllocUnit();
+  }
+#endif  // ENABLE_WARM_MOUNT
   /** \return Pointer to SD card object */
   SdSpiCard *card() {
     return &m_sdCard;
@@ -232,6 +252,14 @@ class SdFatBase : public FatFileSystem {
   void initErrorPrint(Print* pr, const __FlashStringHelper* msg);
 
  private:
+  // Align allocation to the card's AU, no alignment if ACMD13 fails.
+  bool cardAllocUnit() {
+#if USE_AU_ALLOC
+    sds_t sds;
+    setAllocUnit(m_sdCard.readStatus(&sds) ? sdsAuBlocks(&sds) : 0);
+#endif  // USE_AU_ALLOC
+    return true;
+  }
   uint8_t cardErrorCode() {
     return m_sdCard.errorCode();
   }
@@ -250,6 +278,34 @@ class SdFatBase : public FatFileSystem {
   bool writeBlocks(uint32_t block, const uint8_t* src, size_t n) {
     return m_sdCard.writeBlocks(block, src, n);
   }
+#if ENABLE_ASYNC_READ
+  bool readBlocksAsync(uint32_t block, uint8_t* dst, size_t n,
+                       readDone_t callback, void* context) {
+    return m_sdCard.readBlocksAsync(block, dst, n, callback, context);
+  }
+  int8_t readAsyncStatus() {
+    return m_sdCard.readAsyncStatus();
+  }
+#endif  // ENABLE_ASYNC_READ
+#if SD_READ_SINK_SIZE
+  bool readBlockSink(uint32_t block, readSink_t sink, void* context) {
+    return m_sdCard.readBlock(block, sink, context);
+  }
+#endif  // SD_READ_SINK_SIZE
+  bool syncBlocks() {
+    return m_sdCard.syncBlocks();
+  }
+  bool isBusy() {
+    return m_sdCard.isBusy();
+  }
+#if ENABLE_ERASE_TRIM
+  bool eraseBlocks(uint32_t firstBlock, uint32_t lastBlock) {
+    return m_sdCard.trim(firstBlock, lastBlock);
+  }
+#endif  // ENABLE_ERASE_TRIM
+  bool writeStart(uint32_t block, uint32_t eraseCount) {
+    return m_sdCard.writeStart(block, eraseCount);
+  }
   SdSpiCard m_sdCard;
 };
 //==============================================================================
@@ -268,6 +324,24 @@ class SdFat : public SdFatBase {
   bool begin(uint8_t csPin = SS, uint8_t divisor = 2) {
     return SdFatBase::begin(&m_spi, csPin, divisor);
   }
+#if ENABLE_WARM_MOUNT
+  /** Initialize SD card and file system from saved parameters.
+   *
+   * Save \a geo with saveGeometry() and \a cardType with card()->type()
+   * after a begin().  Falls back to a full begin() if the card has been
+   * power cycled or the volume has changed.
+   *
+   * \param[in] geo Volume parameters from saveGeometry().
+   * \param[in] cardType Card type from card()->type().
+   * \param[in] csPin SD card chip select pin.
+   * \param[in] divisor SPI divisor.
+   * \return true for success else false.
+   */
+  bool beginWarm(const FatGeometry_t* geo, uint8_t cardType,
+                 uint8_t csPin = SS, uint8_t divisor = 2) {
+    return SdFatBase::beginWarm(&m_spi, geo, cardType, csPin, divisor);
+  }
+#endif  // ENABLE_WARM_MOUNT
   /** Diagnostic call to initialize SD card - use for diagnostic purposes only.
    * \param[in] csPin SD card chip select pin.
    * \param[in] divisor SPI divisor.
@@ -338,4 +412,57 @@ class SdFatSoftSpi : public SdFatBase {
   SdSpiSoft<MisoPin, MosiPin, SckPin> m_spi;
 };
 #endif  /// SD_SPI_CONFIGURATION >= 3 || defined(DOXYGEN)
+#if HAS_SDIO_CLASS || defined(DOXYGEN)
+//==============================================================================
+/**
+ * \class SdFatSdio
+ * \brief FatFileSystem on an SD card in the 4-bit SDIO socket.
+ */
+class SdFatSdio : public FatFileSystem {
+ public:
+  /** Initialize SD card and file system.
+   * \param[in] kHzMax Maximum SDIO clock in kHz.
+   * \return true for success else false.
+   */
+  bool begin(uint32_t kHzMax = 25000) {
+    return m_sdioCard.begin(kHzMax) && FatFileSystem::begin() &&
+           cardAllocUnit();
+  }
+  /** \return Pointer to SD card object */
+  SdioCard* card() {
+    return &m_sdioCard;
+  }
+
+ private:
+  // Align allocation to the card's AU, no alignment if ACMD13 fails.
+  bool cardAllocUnit() {
+#if USE_AU_ALLOC
+    sds_t sds;
+    setAllocUnit(m_sdioCard.readStatus(&sds) ? sdsAuBlocks(&sds) : 0);
+#endif  // USE_AU_ALLOC
+    return true;
+  }
+  bool readBlock(uint32_t block, uint8_t* dst) {
+    return m_sdioCard.readBlock(block, dst);
+  }
+  bool writeBlock(uint32_t block, const uint8_t* src) {
+    return m_sdioCard.writeBlock(block, src);
+  }
+  bool readBlocks(uint32_t block, uint8_t* dst, size_t n) {
+    return m_sdioCard.readBlocks(block, dst, n);
+  }
+  bool writeBlocks(uint32_t block, const uint8_t* src, size_t n) {
+    return m_sdioCard.writeBlocks(block, src, n);
+  }
+  bool isBusy() {
+    return m_sdioCard.isBusy();
+  }
+#if ENABLE_ERASE_TRIM
+  bool eraseBlocks(uint32_t firstBlock, uint32_t lastBlock) {
+    return m_sdioCard.trim(firstBlock, lastBlock);
+  }
+#endif  // ENABLE_ERASE_TRIM
+  SdioCard m_sdioCard;
+};
+#endif  // HAS_SDIO_CLASS || defined(DOXYGEN)
 #endif  // SdFat_h
@@ -0,0 +1,384 @@
+/*
+ * Benchmark raw card and file operations.
+ *
+ * Reports throughput and min/max/percentile latency for SdSpiCard
+ * readBlock/readBlocks/writeBlocks, FatFile::read/write at several
+ * buffer sizes, seekSet() on a fragmented file and open() in a large
+ * directory.
+ *
+ * Raw writes only use blocks of a contiguous file created by the
+ * benchmark so no other data on the card is changed.  All files are
+ * created in BENCH_DIR and removed at the end of each run.
+ */
+#include <SPI.h>
+#include <TFT_SdFat.h>
+
+// SD chip select pin.
+const uint8_t chipSelect = SS;
+
+// SCK divisor, SPI_AUTO_SPEED selects the fastest reliable rate.
+const uint8_t sckDivisor = SPI_FULL_SPEED;
+
+// Directory for benchmark files.
+#define BENCH_DIR "/BENCH"
+
+// Size of the contiguous file for raw and sequential tests.
+const uint32_t FILE_SIZE = 512UL*1024;
+
+// Blocks per readBlocks/writeBlocks call.
+const size_t MULTI_BLOCK_COUNT = 8;
+
+// Number of random seeks in the fragmented file.
+const uint16_t SEEK_COUNT = 200;
+
+// Number of files in the directory for open() tests.
+const uint16_t DIR_FILE_COUNT = 128;
+
+// Buffer sizes for FatFile::read/write.
+const size_t bufSizes[] = {32, 64, 128, 256, 512};
+
+SdFat sd;
+
+uint8_t buf[512];
+//------------------------------------------------------------------------------
+// Latency statistics with a log2 histogram of microseconds.
+const uint8_t HIST_DIM = 20;
+
+struct LatencyStats {
+  uint32_t count;
+  uint32_t minUs;
+  uint32_t maxUs;
+  uint32_t totalUs;
+  uint32_t bytes;
+  uint16_t hist[HIST_DIM];
+
+  void clear() {
+    memset(this, 0, sizeof(*this));
+    minUs = 0XFFFFFFFF;
+  }
+  void add(uint32_t us, uint32_t n) {
+    uint8_t b = 0;
+    while (b < (HIST_DIM - 1) && (1UL << b) <= us) {
+      b++;
+    }
+    if (hist[b] != 0XFFFF) {
+      hist[b]++;
+    }
+    count++;
+    bytes += n;
+    totalUs += us;
+    if (us < minUs) {
+      minUs = us;
+    }
+    if (us > maxUs) {
+      maxUs = us;
+    }
+  }
+  // Upper bound in microseconds for the percentile pct.
+  uint32_t percentile(uint8_t pct) {
+    uint32_t limit = (count*pct + 99)/100;
+    uint32_t sum = 0;
+    for (uint8_t b = 0; b < HIST_DIM; b++) {
+      sum += hist[b];
+      if (sum >= limit) {
+        return b < (HIST_DIM - 1) ? 1UL << b : maxUs;
+      }
+    }
+    return maxUs;
+  }
+};
+
+LatencyStats stats;
+//------------------------------------------------------------------------------
+void printStats(const __FlashStringHelper* name, size_t size) {
+  Serial.print(name);
+  if (size) {
+    Serial.print(' ');
+    Serial.print(size);
+  }
+  if (stats.count == 0) {
+    Serial.println(F(": no samples"));
+    return;
+  }
+  Serial.print(F(": n="));
+  Serial.print(stats.count);
+  if (stats.bytes && stats.totalUs) {
+    Serial.print(F(" KB/s="));
+    Serial.print(1000.0*stats.bytes/stats.totalUs, 1);
+  }
+  Serial.print(F(" min="));
+  Serial.print(stats.minUs);
+  Serial.print(F(" p50<="));
+  Serial.print(stats.percentile(50));
+  Serial.print(F(" p90<="));
+  Serial.print(stats.percentile(90));
+  Serial.print(F(" p99<="));
+  Serial.print(stats.percentile(99));
+  Serial.print(F(" max="));
+  Serial.print(stats.maxUs);
+  Serial.println(F(" us"));
+}
+//------------------------------------------------------------------------------
+// Print the histogram for the last test.
+void printHistogram() {
+  for (uint8_t b = 0; b < HIST_DIM; b++) {
+    if (stats.hist[b]) {
+      Serial.print(F("  <"));
+      Serial.print(1UL << b);
+      Serial.print(F(" us: "));
+      Serial.println(stats.hist[b]);
+    }
+  }
+}
+//------------------------------------------------------------------------------
+void error(const __FlashStringHelper* msg) {
+  Serial.print(F("error: "));
+  Serial.println(msg);
+  if (sd.card()->errorCode()) {
+    Serial.print(F("SD errorCode: 0X"));
+    Serial.println(sd.card()->errorCode(), HEX);
+  }
+  while (1) {}
+}
+//------------------------------------------------------------------------------
+void rawTests() {
+  FatFile file;
+  uint32_t bgnBlock, endBlock;
+
+  if (!file.createContiguous(sd.vwd(), "RAW.BIN", FILE_SIZE)) {
+    error(F("createContiguous"));
+  }
+  if (!file.contiguousRange(&bgnBlock, &endBlock)) {
+    error(F("contiguousRange"));
+  }
+  file.close();
+  uint32_t nb = endBlock - bgnBlock + 1;
+
+  memset(buf, 0XAA, sizeof(buf));
+  stats.clear();
+  for (uint32_t b = bgnBlock; b <= endBlock; b++) {
+    uint32_t m = micros();
+    if (!sd.card()->writeBlock(b, buf)) {
+      error(F("writeBlock"));
+    }
+    stats.add(micros() - m, 512);
+  }
+  printStats(F("writeBlock"), 0);
+  printHistogram();
+
+  stats.clear();
+  for (uint32_t b = bgnBlock; b <= endBlock; b++) {
+    uint32_t m = micros();
+    if (!sd.card()->readBlock(b, buf)) {
+      error(F("readBlock"));
+    }
+    stats.add(micros() - m, 512);
+  }
+  printStats(F("readBlock"), 0);
+  printHistogram();
+
+  // Multi-block transfers reuse the same buffer for each block.
+  stats.clear();
+  for (uint32_t b = bgnBlock; b + MULTI_BLOCK_COUNT <= bgnBlock + nb;
+       b += MULTI_BLOCK_COUNT) {
+    uint32_t m = micros();
+    if (!sd.card()->writeStart(b, MULTI_BLOCK_COUNT)) {
+      error(F("writeStart"));
+    }
+    for (size_t i = 0; i < MULTI_BLOCK_COUNT; i++) {
+      if (!sd.card()->writeData(buf)) {
+        error(F("writeData"));
+      }
+    }
+    if (!sd.card()->writeStop()) {
+      error(F("writeStop"));
+    }
+    stats.add(micros() - m, 512*MULTI_BLOCK_COUNT);
+  }
+  printStats(F("writeBlocks"), MULTI_BLOCK_COUNT);
+
+  stats.clear();
+  for (uint32_t b = bgnBlock; b + MULTI_BLOCK_COUNT <= bgnBlock + nb;
+       b += MULTI_BLOCK_COUNT) {
+    uint32_t m = micros();
+    if (!sd.card()->readStart(b)) {
+      error(F("readStart"));
+    }
+    for (size_t i = 0; i < MULTI_BLOCK_COUNT; i++) {
+      if (!sd.card()->readData(buf)) {
+        error(F("readData"));
+      }
+    }
+    if (!sd.card()->readStop()) {
+      error(F("readStop"));
+    }
+    stats.add(micros() - m, 512*MULTI_BLOCK_COUNT);
+  }
+  printStats(F("readBlocks"), MULTI_BLOCK_COUNT);
+
+  if (!sd.remove("RAW.BIN")) {
+    error(F("remove RAW.BIN"));
+  }
+}
+//------------------------------------------------------------------------------
+void fileTests() {
+  FatFile file;
+  for (uint8_t k = 0; k < sizeof(bufSizes)/sizeof(bufSizes[0]); k++) {
+    size_t n = bufSizes[k];
+    uint32_t count = FILE_SIZE/n;
+
+    if (!file.open(sd.vwd(), "SEQ.BIN", O_CREAT | O_TRUNC | O_RDWR)) {
+      error(F("open SEQ.BIN"));
+    }
+    stats.clear();
+    for (uint32_t i = 0; i < count; i++) {
+      uint32_t m = micros();
+      if (file.write(buf, n) != (int)n) {
+        error(F("write"));
+      }
+      stats.add(micros() - m, n);
+    }
+    uint32_t m = micros();
+    if (!file.sync()) {
+      error(F("sync"));
+    }
+    stats.add(micros() - m, 0);
+    printStats(F("write"), n);
+
+    file.rewind();
+    stats.clear();
+    for (uint32_t i = 0; i < count; i++) {
+      uint32_t m = micros();
+      if (file.read(buf, n) != (int)n) {
+        error(F("read"));
+      }
+      stats.add(micros() - m, n);
+    }
+    printStats(F("read"), n);
+    file.close();
+  }
+  if (!sd.remove("SEQ.BIN")) {
+    error(F("remove SEQ.BIN"));
+  }
+}
+//------------------------------------------------------------------------------
+void seekTests() {
+  FatFile f1;
+  FatFile f2;
+  uint32_t csize = 512UL*sd.vol()->blocksPerCluster();
+
+  // Alternate cluster allocation between two files to fragment them.
+  if (!f1.open(sd.vwd(), "FRAG1.BIN", O_CREAT | O_TRUNC | O_RDWR) ||
+      !f2.open(sd.vwd(), "FRAG2.BIN", O_CREAT | O_TRUNC | O_RDWR)) {
+    error(F("open FRAG"));
+  }
+  uint32_t size = 0;
+  while (size < FILE_SIZE/2) {
+    for (uint32_t i = 0; i < csize; i += sizeof(buf)) {
+      if (f1.write(buf, sizeof(buf)) != (int)sizeof(buf) ||
+          f2.write(buf, sizeof(buf)) != (int)sizeof(buf)) {
+        error(F("write FRAG"));
+      }
+      if (!f1.sync() || !f2.sync()) {
+        error(F("sync FRAG"));
+      }
+    }
+    size += csize;
+  }
+  f2.close();
+  randomSeed(1);
+  stats.clear();
+  for (uint16_t i = 0; i < SEEK_COUNT; i++) {
+    uint32_t pos = random(size/512)*512;
+    uint32_t m = micros();
+    if (!f1.seekSet(pos) || f1.read(buf, 1) != 1) {
+      error(F("seekSet"));
+    }
+    stats.add(micros() - m, 0);
+  }
+  printStats(F("seekSet+read"), 0);
+  printHistogram();
+  f1.close();
+  if (!sd.remove("FRAG1.BIN") || !sd.remove("FRAG2.BIN")) {
+    error(F("remove FRAG"));
+  }
+}
+//------------------------------------------------------------------------------
+void openTests() {
+  FatFile dir;
+  FatFile file;
+  char name[13];
+
+  if (!sd.mkdir("DIR") || !dir.open(sd.vwd(), "DIR", O_READ)) {
+    error(F("mkdir DIR"));
+  }
+  stats.clear();
+  for (uint16_t i = 0; i < DIR_FILE_COUNT; i++) {
+    sprintf(name, "F%04u.TXT", i);
+    uint32_t m = micros();
+    if (!file.open(&dir, name, O_CREAT | O_EXCL | O_WRITE)) {
+      error(F("create"));
+    }
+    file.close();
+    stats.add(micros() - m, 0);
+  }
+  printStats(F("create"), DIR_FILE_COUNT);
+
+  stats.clear();
+  for (uint16_t i = 0; i < DIR_FILE_COUNT; i++) {
+    sprintf(name, "F%04u.TXT", (i*37) % DIR_FILE_COUNT);
+    uint32_t m = micros();
+    if (!file.open(&dir, name, O_READ)) {
+      error(F("open"));
+    }
+    stats.add(micros() - m, 0);
+    file.close();
+  }
+  printStats(F("open"), DIR_FILE_COUNT);
+  printHistogram();
+
+  stats.clear();
+  uint32_t m = micros();
+  if (!file.open(&dir, "MISSING.TXT", O_READ)) {
+    stats.add(micros() - m, 0);
+  }
+  printStats(F("open miss"), DIR_FILE_COUNT);
+
+  if (!dir.rmRfStar()) {
+    error(F("rmRfStar"));
+  }
+}
+//------------------------------------------------------------------------------
+void setup() {
+  Serial.begin(9600);
+  while (!Serial) {}  // wait for Leonardo
+}
+//------------------------------------------------------------------------------
+void loop() {
+  while (Serial.read() >= 0) {}
+  Serial.println(F("\nType any character to start"));
+  while (Serial.read() < 0) {}
+
+  if (!sd.begin(chipSelect, sckDivisor)) {
+    sd.initErrorHalt();
+  }
+  Serial.print(F("Card size: "));
+  Serial.print(0.000512*sd.card()->cardSize(), 0);
+  Serial.println(F(" MB"));
+  Serial.print(F("Cluster size: "));
+  Serial.print(512UL*sd.vol()->blocksPerCluster());
+  Serial.println(F(" bytes"));
+
+  if (!sd.exists(BENCH_DIR) && !sd.mkdir(BENCH_DIR)) {
+    error(F("mkdir " BENCH_DIR));
+  }
+  if (!sd.chdir(BENCH_DIR)) {
+    error(F("chdir " BENCH_DIR));
+  }
+  rawTests();
+  fileTests();
+  seekTests();
+  openTests();
+  sd.chdir();
+  Serial.println(F("Done"));
+}
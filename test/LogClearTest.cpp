@@ -0,0 +1,87 @@
+/* FatLib Library
+ * Copyright (C) 2015 by William Greiman
+ *
+ * This file is part of the FatLib Library
+ *
+ * This Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the FatLib Library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+/*
+ * Host test for FatLog::clear() followed by open().
+ *
+ * Build and run on a scratch FAT image, for example:
+ *   mkfs.fat -C /tmp/test.img 32768
+ *   g++ -I. -Iutility test/LogClearTest.cpp utility/Fat*.cpp \
+ *     utility/FmtNumber.cpp
+ *   ./a.out /tmp/test.img
+ */
+#include "FatDisk.h"
+#include "FatLog.h"
+#define CHECK(x) do {\
+  if (!(x)) {\
+    printf("FAIL line %d: %s\n", __LINE__, #x);\
+    return 1;\
+  }\
+} while (0)
+//------------------------------------------------------------------------------
+int main(int argc, char** argv) {
+  FatFileDisk disk;
+  FatFile file;
+  FatLog log;
+  uint8_t buf[512];
+  char data[FAT_LOG_DATA_SIZE];
+  char rec[40];
+  uint32_t epoch;
+  CHECK(argc == 2 && disk.begin(argv[1]));
+  disk.remove("LOGCLEAR.BIN");
+  CHECK(file.createContiguous(disk.vwd(), "LOGCLEAR.BIN", 64*512UL));
+  CHECK(log.open(&file, buf));
+  for (int i = 0; i < 20; i++) {
+    int n = sprintf(rec, "record %d with some padding text\n", i);
+    CHECK(log.write(rec, n) == n);
+  }
+  CHECK(log.sync() && log.blockCount() > 1);
+  epoch = log.epoch();
+
+  CHECK(log.clear() && log.blockCount() == 0);
+  CHECK(log.open(&file, buf));
+  CHECK(log.blockCount() == 0 && log.epoch() == epoch + 1);
+
+  CHECK(log.write("new", 3) == 3 && log.sync());
+  CHECK(log.open(&file, buf));
+  CHECK(log.blockCount() == 1 && log.epoch() == epoch + 1);
+  CHECK(log.read(0, data) == 3 && memcmp(data, "new", 3) == 0);
+
+  // Fill several blocks, then clear with a torn rewrite of block zero.
+  for (int i = 0; i < 20; i++) {
+    int n = sprintf(rec, "record %d with some padding text\n", i);
+    CHECK(log.write(rec, n) == n);
+  }
+  CHECK(log.sync() && log.blockCount() > 1);
+  epoch = log.epoch();
+  CHECK(log.clear());
+  memset(buf, 0, sizeof(buf));
+  CHECK(file.seekSet(0) && file.write(buf, 512) == 512 && file.sync());
+
+  // The old blocks must not come back after block zero is written again.
+  CHECK(log.open(&file, buf));
+  CHECK(log.blockCount() == 0 && log.epoch() > epoch + 1);
+  CHECK(log.write("torn", 4) == 4 && log.sync());
+  CHECK(log.open(&file, buf));
+  CHECK(log.blockCount() == 1 && log.epoch() > epoch + 1);
+  CHECK(log.read(0, data) == 4 && memcmp(data, "torn", 4) == 0);
+  CHECK(file.close() && disk.close());
+  printf("OK\n");
+  return 0;
+}
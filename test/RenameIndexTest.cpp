@@ -0,0 +1,66 @@
+/* FatLib Library
+ * Copyright (C) 2015 by William Greiman
+ *
+ * This file is part of the FatLib Library
+ *
+ * This Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the FatLib Library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+/*
+ * Host test for FatFile::rename() of a file opened by directory index.
+ *
+ * Build and run on a scratch FAT image, for example:
+ *   mkfs.fat -C /tmp/test.img 32768
+ *   g++ -I. -Iutility test/RenameIndexTest.cpp utility/Fat*.cpp \
+ *     utility/FmtNumber.cpp
+ *   ./a.out /tmp/test.img
+ */
+#include "FatDisk.h"
+#define CHECK(x) do {\
+  if (!(x)) {\
+    printf("FAIL line %d: %s\n", __LINE__, #x);\
+    return 1;\
+  }\
+} while (0)
+//------------------------------------------------------------------------------
+int main(int argc, char** argv) {
+  FatFileDisk disk;
+  FatFile dir;
+  FatFile file;
+  char name[40];
+  uint16_t index;
+  CHECK(argc == 2 && disk.begin(argv[1]));
+  CHECK(disk.mkdir("RENIDX") && dir.open("RENIDX", O_READ));
+  for (int i = 0; i < 3; i++) {
+    sprintf(name, "Long file name number %d.text", i);
+    CHECK(file.open(&dir, name, O_WRITE | O_CREAT) && file.close());
+  }
+  CHECK(file.open(&dir, "Long file name number 2.text", O_READ));
+  index = file.dirIndex();
+  CHECK(file.close());
+
+  // open() by index guesses the number of LFN entries
+  CHECK(file.open(&dir, index, O_RDWR));
+  CHECK(file.rename(&dir, "short.txt") && file.close());
+
+  for (int i = 0; i < 2; i++) {
+    sprintf(name, "Long file name number %d.text", i);
+    CHECK(file.open(&dir, name, O_READ) && file.close());
+  }
+  CHECK(file.open(&dir, "short.txt", O_READ) && file.close());
+  CHECK(!file.open(&dir, "Long file name number 2.text", O_READ));
+  CHECK(disk.close());
+  printf("OK\n");
+  return 0;
+}
@@ -0,0 +1,114 @@
+/* FatLib Library
+ * Copyright (C) 2015 by William Greiman
+ *
+ * This file is part of the FatLib Library
+ *
+ * This Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the FatLib Library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#include <string.h>
+#include "FatDisk.h"
+//------------------------------------------------------------------------------
+bool FatDisk::modelTransfer(uint32_t block, size_t nb, bool write) {
+  if (block >= m_blockCount || nb > m_blockCount - block) {
+    DBG_FAIL_MACRO;
+    return false;
+  }
+  if (block != m_nextBlock || write != m_write) {
+    m_commandCount++;
+    m_modelMicros += m_latency.commandMicros;
+  }
+  if (write) {
+    m_writeCount += nb;
+    m_modelMicros += nb*m_latency.writeMicros;
+  } else {
+    m_readCount += nb;
+    m_modelMicros += nb*m_latency.readMicros;
+  }
+  m_nextBlock = block + nb;
+  m_write = write;
+  return true;
+}
+//==============================================================================
+bool FatRamDisk::deviceRead(uint32_t block, uint8_t* dst, size_t nb) {
+  memcpy(dst, m_image + 512*block, 512*nb);
+  return true;
+}
+//------------------------------------------------------------------------------
+bool FatRamDisk::deviceWrite(uint32_t block, const uint8_t* src, size_t nb) {
+  memcpy(m_image + 512*block, src, 512*nb);
+  return true;
+}
+#if ENABLE_ERASE_TRIM
+//------------------------------------------------------------------------------
+// Erased blocks read as all ones like most SD cards.
+bool FatRamDisk::eraseBlocks(uint32_t firstBlock, uint32_t lastBlock) {
+  if (lastBlock < firstBlock || lastBlock >= m_blockCount) {
+    return false;
+  }
+  memset(m_image + 512*firstBlock, 0XFF, 512*(lastBlock - firstBlock + 1));
+  return true;
+}
+#endif  // ENABLE_ERASE_TRIM
+#if FAT_FILE_DISK
+//==============================================================================
+bool FatFileDisk::begin(const char* path, bool readOnly, uint8_t part) {
+  long size;
+  if (!close()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_file = fopen(path, readOnly ? "rb" : "r+b");
+  if (!m_file) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (fseek(m_file, 0, SEEK_END) || (size = ftell(m_file)) < 512) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_blockCount = size/512;
+  return FatFileSystem::begin(part);
+
+fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+bool FatFileDisk::close() {
+  bool rtn = true;
+  if (m_file) {
+    if (fatType()) {
+#if ENABLE_LAZY_SYNC
+      rtn = commit();
+#else  // ENABLE_LAZY_SYNC
+      rtn = cacheClear() != 0;
+#endif  // ENABLE_LAZY_SYNC
+    }
+    rtn = fclose(m_file) == 0 && rtn;
+    m_file = 0;
+    m_blockCount = 0;
+  }
+  return rtn;
+}
+//------------------------------------------------------------------------------
+bool FatFileDisk::deviceRead(uint32_t block, uint8_t* dst, size_t nb) {
+  return fseek(m_file, 512L*block, SEEK_SET) == 0 &&
+         fread(dst, 512, nb, m_file) == nb;
+}
+//------------------------------------------------------------------------------
+bool FatFileDisk::deviceWrite(uint32_t block, const uint8_t* src, size_t nb) {
+  return fseek(m_file, 512L*block, SEEK_SET) == 0 &&
+         fwrite(src, 512, nb, m_file) == nb;
+}
+#endif  // FAT_FILE_DISK
@@ -0,0 +1,209 @@
+/* FatLib Library
+ * Copyright (C) 2015 by William Greiman
+ *
+ * This file is part of the FatLib Library
+ *
+ * This Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the FatLib Library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#ifndef FatDisk_h
+#define FatDisk_h
+/**
+ * \file
+ * \brief FatDisk, FatRamDisk and FatFileDisk classes
+ */
+#include "FatFileSystem.h"
+#if defined(__unix__) || defined(__APPLE__) || defined(_WIN32)
+#include <stdio.h>
+/** Set nonzero if the host image file backend FatFileDisk is available. */
+#define FAT_FILE_DISK 1
+#else  // defined(__unix__) || defined(__APPLE__) || defined(_WIN32)
+#define FAT_FILE_DISK 0
+#endif  // defined(__unix__) || defined(__APPLE__) || defined(_WIN32)
+//------------------------------------------------------------------------------
+/**
+ * \struct FatDiskLatency_t
+ * \brief Latency model for a FatDisk.  Times are in microseconds.
+ */
+struct FatDiskLatency_t {
+  /** Time to start a transfer that does not continue the last transfer. */
+  uint32_t commandMicros;
+  /** Time to read one block. */
+  uint32_t readMicros;
+  /** Time to write one block. */
+  uint32_t writeMicros;
+};
+//==============================================================================
+/**
+ * \class FatDisk
+ * \brief Virtual base class for FatFileSystem block devices without SPI.
+ *
+ * A FatDisk counts block transfers and accumulates the time given by an
+ * optional latency model.  The time is modelled, not waited, so runs are
+ * repeatable and go at full speed.
+ */
+class FatDisk : public FatFileSystem {
+ public:
+  /** Create an instance of FatDisk. */
+  FatDisk() : m_blockCount(0) {
+    resetCounts();
+    setLatency(0, 0, 0);
+  }
+  /** \return The number of blocks in the device. */
+  uint32_t blockCount() const {
+    return m_blockCount;
+  }
+  /** \return The number of commands, transfers that started a new run. */
+  uint32_t commandCount() const {
+    return m_commandCount;
+  }
+  /** \return The number of blocks read. */
+  uint32_t readCount() const {
+    return m_readCount;
+  }
+  /** \return The number of blocks written. */
+  uint32_t writeCount() const {
+    return m_writeCount;
+  }
+  /** \return Modelled device time in microseconds. */
+  uint32_t modelMicros() const {
+    return m_modelMicros;
+  }
+  /** Set the counts and modelled time to zero. */
+  void resetCounts() {
+    m_commandCount = m_readCount = m_writeCount = m_modelMicros = 0;
+    m_nextBlock = 0XFFFFFFFF;
+  }
+  /** Set the latency model.
+   *
+   * \param[in] commandMicros Time to start a transfer that does not
+   * continue the last transfer in the same direction.
+   * \param[in] readMicros Time to read one block.
+   * \param[in] writeMicros Time to write one block.
+   */
+  void setLatency(uint32_t commandMicros,
+                  uint32_t readMicros, uint32_t writeMicros) {
+    m_latency.commandMicros = commandMicros;
+    m_latency.readMicros = readMicros;
+    m_latency.writeMicros = writeMicros;
+  }
+
+ protected:
+  /** Read blocks from the device.
+   * \param[in] block First block.
+   * \param[out] dst Destination.
+   * \param[in] nb Number of blocks.
+   * \return true for success else false.
+   */
+  virtual bool deviceRead(uint32_t block, uint8_t* dst, size_t nb) = 0;
+  /** Write blocks to the device.
+   * \param[in] block First block.
+   * \param[in] src Source.
+   * \param[in] nb Number of blocks.
+   * \return true for success else false.
+   */
+  virtual bool deviceWrite(uint32_t block, const uint8_t* src, size_t nb) = 0;
+  /** Number of blocks in the device. */
+  uint32_t m_blockCount;
+
+ private:
+  bool modelTransfer(uint32_t block, size_t nb, bool write);
+  bool readBlock(uint32_t block, uint8_t* dst) {
+    return modelTransfer(block, 1, false) && deviceRead(block, dst, 1);
+  }
+  bool writeBlock(uint32_t block, const uint8_t* src) {
+    return modelTransfer(block, 1, true) && deviceWrite(block, src, 1);
+  }
+  bool readBlocks(uint32_t block, uint8_t* dst, size_t nb) {
+    return modelTransfer(block, nb, false) && deviceRead(block, dst, nb);
+  }
+  bool writeBlocks(uint32_t block, const uint8_t* src, size_t nb) {
+    return modelTransfer(block, nb, true) && deviceWrite(block, src, nb);
+  }
+  bool syncBlocks() {
+    m_nextBlock = 0XFFFFFFFF;
+    return true;
+  }
+  FatDiskLatency_t m_latency;      // Latency model.
+  uint32_t m_commandCount;         // Transfers that started a new run.
+  uint32_t m_readCount;            // Blocks read.
+  uint32_t m_writeCount;           // Blocks written.
+  uint32_t m_modelMicros;          // Modelled device time.
+  uint32_t m_nextBlock;            // Block that continues the last run.
+  bool     m_write;                // Direction of the last run.
+};
+//==============================================================================
+/**
+ * \class FatRamDisk
+ * \brief FatFileSystem on a volume image in RAM.
+ */
+class FatRamDisk : public FatDisk {
+ public:
+  /** Create an instance of FatRamDisk. */
+  FatRamDisk() : m_image(0) {}
+  /** Initialize the file system on a RAM volume image.
+   *
+   * \param[in] image Volume image with a MBR or a FAT volume at block zero.
+   * \param[in] blockCount Number of 512 byte blocks in \a image.
+   * \param[in] part Partition to initialize, zero for the first one found.
+   * \return true for success else false.
+   */
+  bool begin(uint8_t* image, uint32_t blockCount, uint8_t part = 0) {
+    m_image = image;
+    m_blockCount = blockCount;
+    return FatFileSystem::begin(part);
+  }
+
+ private:
+  bool deviceRead(uint32_t block, uint8_t* dst, size_t nb);
+  bool deviceWrite(uint32_t block, const uint8_t* src, size_t nb);
+#if ENABLE_ERASE_TRIM
+  bool eraseBlocks(uint32_t firstBlock, uint32_t lastBlock);
+#endif  // ENABLE_ERASE_TRIM
+  uint8_t* m_image;                // Volume image.
+};
+#if FAT_FILE_DISK || defined(DOXYGEN)
+//==============================================================================
+/**
+ * \class FatFileDisk
+ * \brief FatFileSystem on a volume image file.  Host builds only.
+ */
+class FatFileDisk : public FatDisk {
+ public:
+  /** Create an instance of FatFileDisk. */
+  FatFileDisk() : m_file(0) {}
+  /** Close the image file. */
+  ~FatFileDisk() {
+    close();
+  }
+  /** Open an image file and initialize the file system.
+   *
+   * \param[in] path Image file path.
+   * \param[in] readOnly Open the image read only if true.
+   * \param[in] part Partition to initialize, zero for the first one found.
+   * \return true for success else false.
+   */
+  bool begin(const char* path, bool readOnly = false, uint8_t part = 0);
+  /** Flush the file system and close the image file.
+   * \return true for success else false.
+   */
+  bool close();
+
+ private:
+  bool deviceRead(uint32_t block, uint8_t* dst, size_t nb);
+  bool deviceWrite(uint32_t block, const uint8_t* src, size_t nb);
+  FILE* m_file;                    // Image file.
+};
+#endif  // FAT_FILE_DISK || defined(DOXYGEN)
+#endif  // FatDisk_h
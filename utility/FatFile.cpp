@@ -28,6 +28,13 @@ void (*FatFile::m_dateTime)(uint16_t* date, uint16_t* time) = 0;
 // Add a cluster to a file.
 bool FatFile::addCluster() {
   m_flags |= F_FILE_DIR_DIRTY;
+#if USE_AU_ALLOC
+  // A file larger than an AU grows in whole AUs.
+  uint32_t au = m_vol->allocUnit();
+  if (au && isFile() && m_curPosition >= 512*au) {
+    return m_vol->allocateCluster(m_curCluster, &m_curCluster, true);
+  }
+#endif  // USE_AU_ALLOC
   return m_vol->allocateCluster(m_curCluster, &m_curCluster);
 }
 //------------------------------------------------------------------------------
@@ -58,6 +65,7 @@ bool FatFile::addDirCluster() {
   }
   memset(pc, 0, 512);
   // zero rest of clusters
+  m_vol->cacheInvalidate(block + 1, m_vol->blocksPerCluster() - 1);
   for (uint8_t i = 1; i < m_vol->blocksPerCluster(); i++) {
     if (!m_vol->writeBlock(block + i, pc->data)) {
       DBG_FAIL_MACRO;
@@ -88,14 +96,24 @@ fail:
 }
 //------------------------------------------------------------------------------
 bool FatFile::close() {
+  FAT_FILE_LOCK(this);
+#if ENABLE_LAZY_SYNC
+  bool rtn = commit();
+#else  // ENABLE_LAZY_SYNC
   bool rtn = sync();
+#endif  // ENABLE_LAZY_SYNC
+  // end any read sequence the device left open for this file
+  if (isOpen() && !m_vol->syncBlocks()) {
+    rtn = false;
+  }
   m_attr = FILE_ATTR_CLOSED;
   return rtn;
 }
 //------------------------------------------------------------------------------
 bool FatFile::contiguousRange(uint32_t* bgnBlock, uint32_t* endBlock) {
+  FAT_FILE_LOCK(this);
   // error if no blocks
-  if (m_firstCluster == 0) {
+  if (!writeBufferFlush() || m_firstCluster == 0) {
     DBG_FAIL_MACRO;
     goto fail;
   }
@@ -116,6 +134,10 @@ bool FatFile::contiguousRange(uint32_t* bgnBlock, uint32_t* endBlock) {
       *bgnBlock = m_vol->clusterStartBlock(m_firstCluster);
       *endBlock = m_vol->clusterStartBlock(c)
                   + m_vol->blocksPerCluster() - 1;
+      if (isFile()) {
+        // use fast path for future cluster lookups
+        m_flags |= F_CONTIGUOUS;
+      }
       return true;
     }
   }
@@ -124,8 +146,14 @@ fail:
   return false;
 }
 //------------------------------------------------------------------------------
+#if ENABLE_ERASE_TRIM
+bool FatFile::createContiguous(FatFile* dirFile, const char* path,
+                               uint32_t size, bool erase) {
+#else  // ENABLE_ERASE_TRIM
 bool FatFile::createContiguous(FatFile* dirFile,
                                const char* path, uint32_t size) {
+#endif  // ENABLE_ERASE_TRIM
+  FAT_FILE_LOCK(dirFile);
   uint32_t count;
   // don't allow zero length file
   if (size == 0) {
@@ -145,10 +173,17 @@ bool FatFile::createContiguous(FatFile* dirFile,
     DBG_FAIL_MACRO;
     goto fail;
   }
+#if ENABLE_ERASE_TRIM
+  if (erase && !m_vol->eraseClusters(m_firstCluster, count)) {
+    remove();
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+#endif  // ENABLE_ERASE_TRIM
   m_fileSize = size;
 
   // insure sync() will update dir entry
-  m_flags |= F_FILE_DIR_DIRTY;
+  m_flags |= F_FILE_DIR_DIRTY | F_CONTIGUOUS;
 
   return sync();
 
@@ -157,6 +192,7 @@ fail:
 }
 //------------------------------------------------------------------------------
 bool FatFile::dirEntry(dir_t* dst) {
+  FAT_FILE_LOCK(this);
   dir_t* dir;
   // Make sure fields on device are correct.
   if (!sync()) {
@@ -198,9 +234,23 @@ uint8_t FatFile::dirName(const dir_t* dir, char* name) {
   name[j] = 0;
   return j;
 }
+//------------------------------------------------------------------------------
+void FatFile::dirInfoCopy(const dir_t* dir, uint16_t index,
+                          FatDirInfo_t* info) {
+  info->fileSize = dir->fileSize;
+  info->firstCluster = ((uint32_t)dir->firstClusterHigh << 16)
+                       | dir->firstClusterLow;
+  info->index = index;
+  info->creationDate = dir->creationDate;
+  info->creationTime = dir->creationTime;
+  info->lastWriteDate = dir->lastWriteDate;
+  info->lastWriteTime = dir->lastWriteTime;
+  info->attributes = dir->attributes;
+}
 
 //------------------------------------------------------------------------------
 uint32_t FatFile::dirSize() {
+  FAT_FILE_LOCK(this);
   int8_t fg;
   if (!isDir()) {
     return 0;
@@ -220,6 +270,25 @@ uint32_t FatFile::dirSize() {
   return 512UL*n;
 }
 //------------------------------------------------------------------------------
+#if USE_EXTENT_MAP
+// Set m_curCluster to the cluster with index in the file or to the
+// closest mapped cluster before it.  Return the FAT links left to follow.
+uint32_t FatFile::extentSeek(uint32_t index) {
+  uint32_t links = index;
+  m_curCluster = m_firstCluster;
+  for (uint8_t i = 0; i < m_extentCount; i++) {
+    if (index < m_extent[i].count) {
+      m_curCluster = m_extent[i].cluster + index;
+      return 0;
+    }
+    index -= m_extent[i].count;
+    m_curCluster = m_extent[i].cluster + m_extent[i].count - 1;
+    links = index + 1;
+  }
+  return links;
+}
+#endif  // USE_EXTENT_MAP
+//------------------------------------------------------------------------------
 int16_t FatFile::fgets(char* str, int16_t num, char* delim) {
   char ch;
   int16_t n = 0;
@@ -249,11 +318,13 @@ int16_t FatFile::fgets(char* str, int16_t num, char* delim) {
 }
 //------------------------------------------------------------------------------
 void FatFile::getpos(FatPos_t* pos) {
+  writeBufferFlush();
   pos->position = m_curPosition;
   pos->cluster = m_curCluster;
 }
 //------------------------------------------------------------------------------
 bool FatFile::mkdir(FatFile* parent, const char* path, bool pFlag) {
+  FAT_FILE_LOCK(parent);
   fname_t fname;
   FatFile tmpDir;
 
@@ -305,6 +376,7 @@ bool FatFile::mkdir(FatFile* parent, fname_t* fname) {
     DBG_FAIL_MACRO;
     goto fail;
   }
+  parent->m_vol->pathCacheInvalidate();
   // create a normal file
   if (!open(parent, fname, O_CREAT | O_EXCL | O_RDWR)) {
     DBG_FAIL_MACRO;
@@ -365,13 +437,46 @@ fail:
   return false;
 }
 //------------------------------------------------------------------------------
+// Advance m_curCluster to the next cluster in the file's chain.
+int8_t FatFile::nextCluster() {
+  if (isContiguous() && m_curPosition < m_fileSize) {
+    // cluster holds file data so it follows the current cluster
+    m_curCluster++;
+    return 1;
+  }
+#if USE_EXTENT_MAP
+  for (uint8_t i = 0; i < m_extentCount; i++) {
+    uint32_t n = m_curCluster - m_extent[i].cluster;
+    if (n < m_extent[i].count) {
+      if ((n + 1) < m_extent[i].count) {
+        m_curCluster++;
+        return 1;
+      }
+      if ((i + 1) < m_extentCount) {
+        m_curCluster = m_extent[i + 1].cluster;
+        return 1;
+      }
+      break;
+    }
+  }
+#endif  // USE_EXTENT_MAP
+  return m_vol->fatGet(m_curCluster, &m_curCluster);
+}
+//------------------------------------------------------------------------------
 bool FatFile::open(FatFileSystem* fs, const char* path, uint8_t oflag) {
   return open(fs->vwd(), path, oflag);
 }
 //------------------------------------------------------------------------------
 bool FatFile::open(FatFile* dirFile, const char* path, uint8_t oflag) {
+  FAT_FILE_LOCK(dirFile);
   FatFile tmpDir;
   fname_t fname;
+#if PATH_CACHE_SIZE
+  const char* prefix;
+  const char* ptr;
+  size_t len;
+  uint32_t start;
+#endif  // PATH_CACHE_SIZE
 
   // error if already open
   if (isOpen() || !dirFile->isDir()) {
@@ -391,6 +496,22 @@ bool FatFile::open(FatFile* dirFile, const char* path, uint8_t oflag) {
     }
     dirFile = &tmpDir;
   }
+#if PATH_CACHE_SIZE
+  // Find length of directory prefix before last component.
+  prefix = path;
+  ptr = path;
+  do {
+    len = ptr - path;
+    if (!parsePathName(ptr, &fname, &ptr)) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+  } while (*ptr);
+  start = dirFile->m_firstCluster;
+  if (len && tmpDir.pathCacheOpen(dirFile->m_vol, start, prefix, len)) {
+    return open(&tmpDir, &fname, oflag);
+  }
+#endif  // PATH_CACHE_SIZE
   while (1) {
     if (!parsePathName(path, &fname, &path)) {
       DBG_FAIL_MACRO;
@@ -407,13 +528,61 @@ bool FatFile::open(FatFile* dirFile, const char* path, uint8_t oflag) {
     dirFile = &tmpDir;
     close();
   }
+#if PATH_CACHE_SIZE
+  if (len) {
+    tmpDir.pathCacheAdd(start, prefix, len);
+  }
+#endif  // PATH_CACHE_SIZE
   return open(dirFile, &fname, oflag);
 
 fail:
   return false;
 }
 //------------------------------------------------------------------------------
+#if PATH_CACHE_SIZE
+void FatFile::pathCacheAdd(uint32_t start, const char* path, size_t len) {
+  if (len > PATH_CACHE_PATH_DIM || !isSubDir()) {
+    return;
+  }
+  path_cache_t* pc = &m_vol->m_pathCache[m_vol->m_pathCacheNext];
+  if (++m_vol->m_pathCacheNext >= PATH_CACHE_SIZE) {
+    m_vol->m_pathCacheNext = 0;
+  }
+  pc->startCluster = start;
+  pc->firstCluster = m_firstCluster;
+  pc->dirCluster = m_dirCluster;
+  pc->dirBlock = m_dirBlock;
+  pc->dirIndex = m_dirIndex;
+  pc->attr = m_attr;
+  pc->lfnOrd = m_lfnOrd;
+  pc->len = len;
+  memcpy(pc->path, path, len);
+}
+//------------------------------------------------------------------------------
+bool FatFile::pathCacheOpen(FatVolume* vol, uint32_t start,
+                            const char* path, size_t len) {
+  for (uint8_t i = 0; i < PATH_CACHE_SIZE; i++) {
+    path_cache_t* pc = &vol->m_pathCache[i];
+    if (pc->len == len && pc->startCluster == start &&
+        !memcmp(pc->path, path, len)) {
+      resetState();
+      m_vol = vol;
+      m_attr = pc->attr;
+      m_flags = O_READ;
+      m_lfnOrd = pc->lfnOrd;
+      m_dirIndex = pc->dirIndex;
+      m_dirCluster = pc->dirCluster;
+      m_dirBlock = pc->dirBlock;
+      m_firstCluster = pc->firstCluster;
+      return true;
+    }
+  }
+  return false;
+}
+#endif  // PATH_CACHE_SIZE
+//------------------------------------------------------------------------------
 bool FatFile::open(FatFile* dirFile, uint16_t index, uint8_t oflag) {
+  FAT_FILE_LOCK(dirFile);
   uint8_t chksum = 0;
   uint8_t lfnOrd = 0;
   dir_t* dir;
@@ -483,7 +652,7 @@ fail:
 bool FatFile::openCachedEntry(FatFile* dirFile, uint16_t dirIndex,
                               uint8_t oflag, uint8_t lfnOrd) {
   uint32_t firstCluster;
-  memset(this, 0, sizeof(FatFile));
+  resetState();
   // location of entry in cache
   m_vol = dirFile->m_vol;
   m_dirIndex = dirIndex;
@@ -500,6 +669,12 @@ bool FatFile::openCachedEntry(FatFile* dirFile, uint16_t dirIndex,
     m_attr |= FILE_ATTR_FILE;
   }
   m_lfnOrd = lfnOrd;
+#if FAT_READ_ONLY
+  if (oflag & (O_WRITE | O_TRUNC)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+#endif  // FAT_READ_ONLY
   // Write, truncate, or at end is an error for a directory or read-only file.
   if (oflag & (O_WRITE | O_TRUNC | O_AT_END)) {
     if (isSubDir() || isReadOnly()) {
@@ -539,6 +714,7 @@ fail:
 }
 //------------------------------------------------------------------------------
 bool FatFile::openNext(FatFile* dirFile, uint8_t oflag) {
+  FAT_FILE_LOCK(dirFile);
   uint8_t chksum = 0;
   ldir_t* ldir;
   uint8_t lfnOrd = 0;
@@ -600,6 +776,7 @@ fail:
  * the value false is returned for failure.
  */
 bool FatFile::openParent(FatFile* dirFile) {
+  FAT_FILE_LOCK(dirFile);
   FatFile dotdot;
   uint32_t lbn;
   dir_t* dir;
@@ -651,12 +828,13 @@ fail:
 #endif  // DOXYGEN_SHOULD_SKIP_THIS
 //------------------------------------------------------------------------------
 bool FatFile::openRoot(FatVolume* vol) {
+  FAT_FILE_LOCK(this);
   // error if file is already open
   if (isOpen()) {
     DBG_FAIL_MACRO;
     goto fail;
   }
-  memset(this, 0, sizeof(FatFile));
+  resetState();
 
   m_vol = vol;
   switch (vol->fatType()) {
@@ -684,6 +862,7 @@ fail:
 }
 //------------------------------------------------------------------------------
 int FatFile::peek() {
+  FAT_FILE_LOCK(this);
   FatPos_t pos;
   getpos(&pos);
   int c = read();
@@ -693,10 +872,128 @@ int FatFile::peek() {
   return c;
 }
 //------------------------------------------------------------------------------
-int FatFile::read(void* buf, size_t nbyte) {
+#if USE_FILE_PIN
+bool FatFile::prefetch(uint32_t pos, size_t len, void* buf) {
+  FAT_FILE_LOCK(this);
+  FatPos_t save;
+  int n;
+  m_pinSize = 0;
+  if (!buf || len == 0) {
+    return true;
+  }
+  if (!isFile() || len > INT_MAX || !writeBufferFlush() ||
+      pos > m_fileSize || len > m_fileSize - pos) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  getpos(&save);
+  n = seekSet(pos) ? read(buf, len) : -1;
+  setpos(&save);
+  if (n != static_cast<int>(len)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_pinBuf = reinterpret_cast<uint8_t*>(buf);
+  m_pinPos = pos;
+  m_pinSize = len;
+  return true;
+
+fail:
+  return false;
+}
+#endif  // USE_FILE_PIN
+//------------------------------------------------------------------------------
+#if ENABLE_ASYNC_READ
+int FatFile::readAsync(void* buf, size_t nbyte,
+                       readDone_t callback, void* context) {
+  FAT_FILE_LOCK(this);
+  uint8_t blockOfCluster;
+  uint32_t block;
+  uint32_t n;
+  size_t nb;
+
+  // error if not a file open for read
+  if (!isFile() || !(m_flags & O_READ)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (!writeBufferFlush()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  // position must be at the start of a block and buf must hold a block
+  if ((m_curPosition & 0X1FF) || nbyte < 512) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  n = m_fileSize - m_curPosition;
+  if (n == 0) {
+    return 0;
+  }
+  nb = nbyte >> 9;
+  if (nb > ((n + 511) >> 9)) {
+    nb = (n + 511) >> 9;
+  }
+  blockOfCluster = m_vol->blockOfCluster(m_curPosition);
+  if (blockOfCluster == 0) {
+    // start of new cluster
+    if (m_curPosition == 0) {
+      m_curCluster = m_firstCluster;
+    } else if (nextCluster() <= 0) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+  }
+  if (!isContiguous()) {
+    uint8_t mb = m_vol->blocksPerCluster() - blockOfCluster;
+    if (mb < nb) {
+      nb = mb;
+    }
+  }
+  if (n > 512*nb) {
+    n = 512*nb;
+  }
+  block = m_vol->clusterStartBlock(m_curCluster) + blockOfCluster;
+#if !FAT_READ_ONLY
+  if (m_vol->cacheInRange(block, nb)) {
+    // write cached data before it is read from the device
+    if (!m_vol->cacheSync()) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+  }
+#endif  // !FAT_READ_ONLY
+  if (!m_vol->readBlocksAsync(block, reinterpret_cast<uint8_t*>(buf), nb,
+                              callback, context)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (isContiguous()) {
+    // transfer may end in a later cluster
+    m_curCluster += (blockOfCluster + nb - 1) >> m_vol->clusterSizeShift();
+  }
+  m_curPosition += n;
+  return n;
+
+fail:
+  m_error |= READ_ERROR;
+  return -1;
+}
+//------------------------------------------------------------------------------
+int8_t FatFile::readAsyncStatus() {
+  int8_t rtn = isOpen() ? m_vol->readAsyncStatus() : -1;
+  if (rtn < 0) {
+    m_error |= READ_ERROR;
+  }
+  return rtn;
+}
+#endif  // ENABLE_ASYNC_READ
+//------------------------------------------------------------------------------
+int FatFile::readData(uint8_t* dst, readSink_t sink, void* context,
+                      size_t nbyte) {
+  FAT_FILE_LOCK(this);
   int8_t fg;
   uint8_t blockOfCluster = 0;
-  uint8_t* dst = reinterpret_cast<uint8_t*>(buf);
   uint16_t offset;
   size_t toRead;
   uint32_t block;  // raw device block number
@@ -707,6 +1004,10 @@ int FatFile::read(void* buf, size_t nbyte) {
     DBG_FAIL_MACRO;
     goto fail;
   }
+  if (!writeBufferFlush()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
 
   if (isFile()) {
     uint32_t tmp32 = m_fileSize - m_curPosition;
@@ -722,6 +1023,28 @@ int FatFile::read(void* buf, size_t nbyte) {
   toRead = nbyte;
   while (toRead) {
     size_t n;
+#if USE_FILE_PIN
+    if (m_curPosition - m_pinPos < m_pinSize) {
+      // copy pinned data and find the cluster for the new position
+      uint8_t* src = m_pinBuf + (m_curPosition - m_pinPos);
+      n = m_pinSize - (m_curPosition - m_pinPos);
+      if (n > toRead) {
+        n = toRead;
+      }
+      if (sink) {
+        sink(src, n, context);
+      } else {
+        memcpy(dst, src, n);
+        dst += n;
+      }
+      if (!seekSet(m_curPosition + n)) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      toRead -= n;
+      continue;
+    }
+#endif  // USE_FILE_PIN
     offset = m_curPosition & 0X1FF;  // offset in block
     if (isRootFixed()) {
       block = m_vol->rootDirStart() + (m_curPosition >> 9);
@@ -733,8 +1056,8 @@ int FatFile::read(void* buf, size_t nbyte) {
           // use first cluster in file
           m_curCluster = isRoot32() ? m_vol->rootDirStart() : m_firstCluster;
         } else {
-          // get next cluster from FAT
-          fg = m_vol->fatGet(m_curCluster, &m_curCluster);
+          // get next cluster from extent map or FAT
+          fg = nextCluster();
           if (fg < 0) {
             DBG_FAIL_MACRO;
             goto fail;
@@ -750,7 +1073,7 @@ int FatFile::read(void* buf, size_t nbyte) {
       }
       block = m_vol->clusterStartBlock(m_curCluster) + blockOfCluster;
     }
-    if (offset != 0 || toRead < 512 || block == m_vol->cacheBlockNumber()) {
+    if (offset != 0 || toRead < 512 || m_vol->cacheInRange(block, 1)) {
       // amount to be read from current block
       n = 512 - offset;
       if (n > toRead) {
@@ -763,29 +1086,45 @@ int FatFile::read(void* buf, size_t nbyte) {
         goto fail;
       }
       uint8_t* src = pc->data + offset;
-      memcpy(dst, src, n);
+      if (sink) {
+        sink(src, n, context);
+      } else {
+        memcpy(dst, src, n);
+      }
+    } else if (sink) {
+      // pass block to sink as it is read from the device
+      n = 512;
+      if (!m_vol->readBlockSink(block, sink, context)) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
 #if USE_MULTI_BLOCK_IO
     } else if (toRead >= 1024) {
-      uint8_t nb = toRead >> 9;
-      if (!isRootFixed()) {
+      size_t nb = toRead >> 9;
+      if (!isRootFixed() && !isContiguous()) {
         uint8_t mb = m_vol->blocksPerCluster() - blockOfCluster;
         if (mb < nb) {
           nb = mb;
         }
       }
       n = 512*nb;
-      if (m_vol->cacheBlockNumber() <= block
-          && block < (m_vol->cacheBlockNumber() + nb)) {
+#if !FAT_READ_ONLY
+      if (m_vol->cacheInRange(block, nb)) {
         // flush cache if a block is in the cache
         if (!m_vol->cacheSync()) {
           DBG_FAIL_MACRO;
           goto fail;
         }
       }
+#endif  // !FAT_READ_ONLY
       if (!m_vol->readBlocks(block, dst, nb)) {
         DBG_FAIL_MACRO;
         goto fail;
       }
+      if (isContiguous()) {
+        // transfer may end in a later cluster
+        m_curCluster += (blockOfCluster + nb - 1) >> m_vol->clusterSizeShift();
+      }
 #endif  // USE_MULTI_BLOCK_IO
     } else {
       // read single block
@@ -795,7 +1134,9 @@ int FatFile::read(void* buf, size_t nbyte) {
         goto fail;
       }
     }
-    dst += n;
+    if (!sink) {
+      dst += n;
+    }
     m_curPosition += n;
     toRead -= n;
   }
@@ -806,6 +1147,54 @@ fail:
   return -1;
 }
 //------------------------------------------------------------------------------
+static void skipSink(const uint8_t* data, size_t n, void* context) {
+  (void)data;
+  (void)n;
+  (void)context;
+}
+//------------------------------------------------------------------------------
+bool FatFile::readRows(uint32_t pos, size_t len, uint32_t stride,
+                       uint16_t count, readSink_t sink, void* context,
+                       uint8_t gap) {
+  FAT_FILE_LOCK(this);
+  // device block after the last block read, zero if none
+  uint32_t next = 0;
+  if (!isFile() || len > INT_MAX) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  for (uint16_t i = 0; i < count; i++, pos += stride) {
+    if (!seekSet(pos)) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    // m_curCluster is for pos - 1 at the start of a cluster
+    if (next && (pos & ((512UL << m_vol->clusterSizeShift()) - 1))) {
+      uint32_t block = m_vol->clusterStartBlock(m_curCluster)
+                       + m_vol->blockOfCluster(pos);
+      if (block > next && (block - next) <= gap) {
+        // read through a short gap so a multi-block read continues
+        for (; next < block; next++) {
+          if (!m_vol->readBlockSink(next, skipSink, 0)) {
+            DBG_FAIL_MACRO;
+            goto fail;
+          }
+        }
+      }
+    }
+    if (readData(0, sink, context, len) != static_cast<int>(len)) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    next = len == 0 ? 0 : m_vol->clusterStartBlock(m_curCluster)
+           + m_vol->blockOfCluster(m_curPosition - 1) + 1;
+  }
+  return true;
+
+fail:
+  return false;
+}
+//------------------------------------------------------------------------------
 int8_t FatFile::readDir(dir_t* dir) {
   int16_t n;
   // if not a directory file or miss-positioned return an error
@@ -875,6 +1264,7 @@ fail:
 }
 //------------------------------------------------------------------------------
 bool FatFile::rename(FatFile* dirFile, const char* newPath) {
+  FAT_FILE_LOCK(this);
   dir_t entry;
   uint32_t dirCluster = 0;
   FatFile file;
@@ -897,8 +1287,19 @@ bool FatFile::rename(FatFile* dirFile, const char* newPath) {
     DBG_FAIL_MACRO;
     goto fail;
   }
+  m_vol->pathCacheInvalidate();
   // sync() and cache directory entry
   sync();
+#if USE_LONG_FILE_NAMES && !FAT_READ_ONLY
+  // Reuse the entries of the old name if possible.
+  switch (lfnRename(dirFile, newPath)) {
+    case 1:
+      return true;
+    case -1:
+      DBG_FAIL_MACRO;
+      goto fail;
+  }
+#endif  // USE_LONG_FILE_NAMES && !FAT_READ_ONLY
   oldFile = *this;
   dir = cacheDirEntry(FatCache::CACHE_FOR_READ);
   if (!dir) {
@@ -982,6 +1383,7 @@ fail:
 }
 //------------------------------------------------------------------------------
 bool FatFile::rmdir() {
+  FAT_FILE_LOCK(this);
   // must be open subdirectory
   if (!isSubDir() || (!USE_LONG_FILE_NAMES && isLFN())) {
     DBG_FAIL_MACRO;
@@ -1014,6 +1416,7 @@ bool FatFile::rmdir() {
       goto fail;
     }
   }
+  m_vol->pathCacheInvalidate();
   // convert empty directory to normal file for remove
   m_attr = FILE_ATTR_FILE;
   m_flags |= O_WRITE;
@@ -1024,72 +1427,111 @@ fail:
 }
 //------------------------------------------------------------------------------
 bool FatFile::rmRfStar() {
-  uint16_t index;
-  FatFile f;
-  if (!isDir()) {
+  FAT_FILE_LOCK(this);
+  bool rtn;
+#if ENABLE_LAZY_SYNC
+  bool lazy;
+#endif  // ENABLE_LAZY_SYNC
+  if (!isDir() || (!isRoot() && !USE_LONG_FILE_NAMES && isLFN())) {
     DBG_FAIL_MACRO;
-    goto fail;
+    return false;
+  }
+  m_vol->hashIndexInvalidate();
+  m_vol->pathCacheInvalidate();
+#if ENABLE_LAZY_SYNC
+  // Defer the second FAT so each FAT block is mirrored once by commit().
+  lazy = m_vol->lazySync();
+  m_vol->setLazySync(true);
+#endif  // ENABLE_LAZY_SYNC
+  rtn = rmRfTree();
+  if (rtn && !isRoot()) {
+    // remove the empty directory as a file
+    m_attr = FILE_ATTR_FILE;
+    m_flags |= O_WRITE;
+    rtn = remove();
+  }
+#if ENABLE_LAZY_SYNC
+  m_vol->setLazySync(lazy);
+  if (!lazy && !m_vol->commit()) {
+    rtn = false;
+  }
+#endif  // ENABLE_LAZY_SYNC
+  if (!m_vol->cacheSync()) {
+    rtn = false;
   }
+  return rtn;
+}
+//------------------------------------------------------------------------------
+// Remove the contents of a directory one directory block at a time.  The
+// entries in a block are marked deleted with one cache write, then their
+// chains are freed in cluster order so files that were allocated in order
+// touch each FAT block once.  Bit 31 of a saved cluster marks a directory.
+bool FatFile::rmRfTree() {
+  uint32_t first[16];
+  uint8_t count;
+  bool done = false;
+  dir_t* dir;
+  FatFile f;
   rewind();
-  while (1) {
-    // remember position
-    index = m_curPosition/32;
-
-    dir_t* dir = readDirCache();
-    if (!dir) {
-      // At EOF if no error.
-      if (!getError()) {
+  while (!done) {
+    count = 0;
+    do {
+      dir = readDirCache();
+      if (!dir) {
+        // At EOF if no error.
+        if (getError()) {
+          DBG_FAIL_MACRO;
+          goto fail;
+        }
+        done = true;
         break;
       }
-      DBG_FAIL_MACRO;
-      goto fail;
-    }
-    // done if past last entry
-    if (dir->name[0] == DIR_NAME_FREE) {
-      break;
-    }
-
-    // skip empty slot or '.' or '..'
-    if (dir->name[0] == DIR_NAME_DELETED || dir->name[0] == '.') {
-      continue;
-    }
-
-    // skip if part of long file name or volume label in root
-    if (!DIR_IS_FILE_OR_SUBDIR(dir)) {
-      continue;
-    }
-
-    if (!f.open(this, index, O_READ)) {
-      DBG_FAIL_MACRO;
-      goto fail;
-    }
-    if (f.isSubDir()) {
-      // recursively delete
-      if (!f.rmRfStar()) {
-        DBG_FAIL_MACRO;
-        goto fail;
+      // done if past last entry
+      if (dir->name[0] == DIR_NAME_FREE) {
+        done = true;
+        break;
       }
-    } else {
-      // ignore read-only
-      f.m_flags |= O_WRITE;
-      if (!f.remove()) {
-        DBG_FAIL_MACRO;
-        goto fail;
+      // skip empty slot, '.', '..' and the volume label in root
+      if (dir->name[0] == DIR_NAME_DELETED || dir->name[0] == '.' ||
+          (!DIR_IS_LONG_NAME(dir) && !DIR_IS_FILE_OR_SUBDIR(dir))) {
+        continue;
       }
-    }
-    // position to next entry if required
-    if (m_curPosition != (32UL*(index + 1))) {
-      if (!seekSet(32UL*(index + 1))) {
+      if (!DIR_IS_LONG_NAME(dir)) {
+        first[count] = (uint32_t)dir->firstClusterHigh << 16
+                       | dir->firstClusterLow;
+        if (first[count] && DIR_IS_SUBDIR(dir)) {
+          first[count] |= 0X80000000;
+        }
+        count++;
+      }
+      dir->name[0] = DIR_NAME_DELETED;
+      m_vol->cacheDirty();
+    } while (m_curPosition & 0X1FF);
+
+    while (count) {
+      uint8_t k = 0;
+      for (uint8_t i = 1; i < count; i++) {
+        if (first[i] < first[k]) {
+          k = i;
+        }
+      }
+      uint32_t cluster = first[k] & 0X7FFFFFFF;
+      if (first[k] & 0X80000000) {
+        f.resetState();
+        f.m_attr = FILE_ATTR_SUBDIR;
+        f.m_flags = O_READ;
+        f.m_vol = m_vol;
+        f.m_firstCluster = cluster;
+        if (!f.rmRfTree()) {
+          DBG_FAIL_MACRO;
+          goto fail;
+        }
+      }
+      if (cluster && !m_vol->freeChain(cluster)) {
         DBG_FAIL_MACRO;
         goto fail;
       }
-    }
-  }
-  // don't try to delete root
-  if (!isRoot()) {
-    if (!rmdir()) {
-      DBG_FAIL_MACRO;
-      goto fail;
+      first[k] = first[--count];
     }
   }
   return true;
@@ -1099,14 +1541,20 @@ fail:
 }
 //------------------------------------------------------------------------------
 bool FatFile::seekSet(uint32_t pos) {
+  FAT_FILE_LOCK(this);
   uint32_t nCur;
   uint32_t nNew;
-  uint32_t tmp = m_curCluster;
+  uint32_t tmp;
   // error if file not open
   if (!isOpen()) {
     DBG_FAIL_MACRO;
     goto fail;
   }
+  if (!writeBufferFlush()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  tmp = m_curCluster;
   if (pos == 0) {
     // set position to start of file
     m_curCluster = 0;
@@ -1128,6 +1576,11 @@ bool FatFile::seekSet(uint32_t pos) {
   nCur = (m_curPosition - 1) >> (m_vol->clusterSizeShift() + 9);
   nNew = (pos - 1) >> (m_vol->clusterSizeShift() + 9);
 
+  if (isContiguous()) {
+    // no need to follow the chain
+    m_curCluster = m_firstCluster + nNew;
+    goto done;
+  }
   if (nNew < nCur || m_curPosition == 0) {
     // must follow chain from first cluster
     m_curCluster = isRoot32() ? m_vol->rootDirStart() : m_firstCluster;
@@ -1135,6 +1588,18 @@ bool FatFile::seekSet(uint32_t pos) {
     // advance from curPosition
     nNew -= nCur;
   }
+#if USE_EXTENT_MAP
+  if (m_extentCount) {
+    // start from the extent map if it is closer
+    uint32_t cluster = m_curCluster;
+    uint32_t links = extentSeek((pos - 1) >> (m_vol->clusterSizeShift() + 9));
+    if (links > nNew) {
+      m_curCluster = cluster;
+    } else {
+      nNew = links;
+    }
+  }
+#endif  // USE_EXTENT_MAP
   while (nNew--) {
     if (m_vol->fatGet(m_curCluster, &m_curCluster) <= 0) {
       DBG_FAIL_MACRO;
@@ -1151,17 +1616,98 @@ fail:
   return false;
 }
 //------------------------------------------------------------------------------
+#if USE_EXTENT_MAP
+bool FatFile::setExtentMap(FatExtent_t* extent, uint8_t count) {
+  FAT_FILE_LOCK(this);
+  uint32_t cluster;
+  uint32_t next;
+  uint8_t n = 0;
+  m_extentCount = 0;
+  if (!extent || !count) {
+    return true;
+  }
+  if (!isFile()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_extent = extent;
+  cluster = m_firstCluster;
+  if (cluster == 0) {
+    // empty file
+    return true;
+  }
+  extent[0].cluster = cluster;
+  extent[0].count = 1;
+  while (1) {
+    int8_t fg = m_vol->fatGet(cluster, &next);
+    if (fg < 0) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    if (fg == 0) {
+      break;
+    }
+    if (next == (cluster + 1)) {
+      extent[n].count++;
+    } else {
+      // stop with complete runs if the table is full
+      if (++n == count) {
+        break;
+      }
+      extent[n].cluster = next;
+      extent[n].count = 1;
+    }
+    cluster = next;
+  }
+  m_extentCount = n < count ? n + 1 : count;
+  return true;
+
+fail:
+  return false;
+}
+#endif  // USE_EXTENT_MAP
+//------------------------------------------------------------------------------
 void FatFile::setpos(FatPos_t* pos) {
+  writeBufferFlush();
   m_curPosition = pos->position;
   m_curCluster = pos->cluster;
 }
 //------------------------------------------------------------------------------
 bool FatFile::sync() {
+  FAT_FILE_LOCK(this);
+#if ENABLE_LAZY_SYNC
+  // Directory entry is written by commit() in lazy sync mode.
+  return syncFile(!isOpen() || !m_vol->lazySync());
+#else  // ENABLE_LAZY_SYNC
+  return syncFile(true);
+#endif  // ENABLE_LAZY_SYNC
+}
+//------------------------------------------------------------------------------
+#if ENABLE_LAZY_SYNC
+bool FatFile::commit() {
+  FAT_FILE_LOCK(this);
   if (!isOpen()) {
     return true;
   }
+  if (syncFile(true) && m_vol->commit()) {
+    return true;
+  }
+  DBG_FAIL_MACRO;
+  m_error |= WRITE_ERROR;
+  return false;
+}
+#endif  // ENABLE_LAZY_SYNC
+//------------------------------------------------------------------------------
+bool FatFile::syncFile(bool dirEntry) {
+  if (!isOpen()) {
+    return true;
+  }
+  if (!writeBufferFlush()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
 
-  if (m_flags & F_FILE_DIR_DIRTY) {
+  if (dirEntry && (m_flags & F_FILE_DIR_DIRTY)) {
     dir_t* dir = cacheDirEntry(FatCache::CACHE_FOR_WRITE);
     // check for deleted by another open file object
     if (!dir || dir->name[0] == DIR_NAME_DELETED) {
@@ -1196,6 +1742,7 @@ fail:
 }
 //------------------------------------------------------------------------------
 bool FatFile::timestamp(FatFile* file) {
+  FAT_FILE_LOCK(this);
   dir_t* dir;
   dir_t srcDir;
 
@@ -1231,6 +1778,7 @@ fail:
 //------------------------------------------------------------------------------
 bool FatFile::timestamp(uint8_t flags, uint16_t year, uint8_t month,
                    uint8_t day, uint8_t hour, uint8_t minute, uint8_t second) {
+  FAT_FILE_LOCK(this);
   uint16_t dirDate;
   uint16_t dirTime;
   dir_t* dir;
@@ -1280,12 +1828,16 @@ fail:
 }
 //------------------------------------------------------------------------------
 bool FatFile::truncate(uint32_t length) {
+  FAT_FILE_LOCK(this);
   uint32_t newPos;
   // error if not a normal file or read-only
-  if (!isFile() || !(m_flags & O_WRITE)) {
+  if (!isFile() || !(m_flags & O_WRITE) || !writeBufferFlush()) {
     DBG_FAIL_MACRO;
     goto fail;
   }
+#if USE_FILE_PIN
+  m_pinSize = 0;
+#endif  // USE_FILE_PIN
   // error if length is greater than current size
   if (length > m_fileSize) {
     DBG_FAIL_MACRO;
@@ -1304,6 +1856,10 @@ bool FatFile::truncate(uint32_t length) {
     DBG_FAIL_MACRO;
     goto fail;
   }
+#if USE_EXTENT_MAP
+  // freed clusters may be in the extent map
+  m_extentCount = 0;
+#endif  // USE_EXTENT_MAP
   if (length == 0) {
     // free all clusters
     if (!m_vol->freeChain(m_firstCluster)) {
@@ -1348,6 +1904,7 @@ fail:
 }
 //------------------------------------------------------------------------------
 int FatFile::write(const void* buf, size_t nbyte) {
+  FAT_FILE_LOCK(this);
   // convert void* to uint8_t*  -  must be before goto statements
   const uint8_t* src = reinterpret_cast<const uint8_t*>(buf);
   cache_t* pc;
@@ -1355,11 +1912,37 @@ int FatFile::write(const void* buf, size_t nbyte) {
   // number of bytes left to write  -  must be before goto statements
   size_t nToWrite = nbyte;
   size_t n;
-  // error if not a normal file or is read-only
-  if (!isFile() || !(m_flags & O_WRITE)) {
+  // error if not a normal file or is read-only, the rest of write() is
+  // removed from FAT_READ_ONLY builds
+  if (FAT_READ_ONLY || !isFile() || !(m_flags & O_WRITE)) {
     DBG_FAIL_MACRO;
     goto fail;
   }
+#if USE_FILE_PIN
+  // pinned data is not updated by writes
+  m_pinSize = 0;
+#endif  // USE_FILE_PIN
+#if USE_WRITE_BUFFER
+  if (m_writeBufSize && !(m_flags & O_SYNC)) {
+    // Buffered data starts at m_curPosition and ends on a block boundary.
+    if (m_writeBufCount == 0 && (m_flags & O_APPEND)) {
+      if (!seekSet(m_fileSize)) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+    }
+    n = m_writeBufSize - (m_curPosition & 0X1FF) - m_writeBufCount;
+    if (nbyte <= n && nbyte <= (0XFFFFFFFF - curPosition())) {
+      memcpy(m_writeBuf + m_writeBufCount, src, nbyte);
+      m_writeBufCount += nbyte;
+      return nbyte;
+    }
+    if (!writeBufferFlush()) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+  }
+#endif  // USE_WRITE_BUFFER
   // seek to end of file if append flag
   if ((m_flags & O_APPEND)) {
     if (!seekSet(m_fileSize)) {
@@ -1378,7 +1961,8 @@ int FatFile::write(const void* buf, size_t nbyte) {
     if (blockOfCluster == 0 && blockOffset == 0) {
       // start of new cluster
       if (m_curCluster != 0) {
-        int8_t fg = m_vol->fatGet(m_curCluster, &m_curCluster);
+        uint32_t cluster = m_curCluster;
+        int8_t fg = nextCluster();
         if (fg < 0) {
           DBG_FAIL_MACRO;
           goto fail;
@@ -1390,6 +1974,10 @@ int FatFile::write(const void* buf, size_t nbyte) {
             goto fail;
           }
         }
+        if (m_curCluster != (cluster + 1)) {
+          // file is no longer contiguous
+          m_flags &= ~F_CONTIGUOUS;
+        }
       } else {
         if (m_firstCluster == 0) {
           // allocate first cluster of file
@@ -1431,7 +2019,7 @@ int FatFile::write(const void* buf, size_t nbyte) {
       memcpy(dst, src, n);
       if (512 == (n + blockOffset)) {
         // Force write if block is full - improves large writes.
-        if (!m_vol->cacheSyncData()) {
+        if (!writeStreamStart(block, 1) || !m_vol->cacheSyncData()) {
           DBG_FAIL_MACRO;
           goto fail;
         }
@@ -1439,29 +2027,36 @@ int FatFile::write(const void* buf, size_t nbyte) {
 #if USE_MULTI_BLOCK_IO
     } else if (nToWrite >= 1024) {
       // use multiple block write command
-      uint8_t maxBlocks = m_vol->blocksPerCluster() - blockOfCluster;
-      uint8_t nBlock = nToWrite >> 9;
+      size_t maxBlocks = m_vol->blocksPerCluster() - blockOfCluster;
+      size_t nBlock = nToWrite >> 9;
+      if (isContiguous() && m_curPosition < m_fileSize) {
+        // blocks to the end of the clusters allocated to the file
+        uint8_t shift = m_vol->clusterSizeShift();
+        maxBlocks = ((((m_fileSize - 1) >> (shift + 9)) + 1) << shift)
+                    - (m_curPosition >> 9);
+      }
       if (nBlock > maxBlocks) {
         nBlock = maxBlocks;
       }
       n = 512*nBlock;
-      if (m_vol->cacheBlockNumber() <= block
-          && block < (m_vol->cacheBlockNumber() + nBlock)) {
-        // invalidate cache if block is in cache
-        m_vol->cacheInvalidate();
-      }
-      if (!m_vol->writeBlocks(block, src, nBlock)) {
+      // invalidate cache if a block is in cache
+      m_vol->cacheInvalidate(block, nBlock);
+      if (!writeStreamStart(block, nBlock) ||
+          !m_vol->writeBlocks(block, src, nBlock)) {
         DBG_FAIL_MACRO;
         goto fail;
       }
+      if (isContiguous()) {
+        // transfer may end in a later cluster
+        m_curCluster += (blockOfCluster + nBlock - 1)
+                        >> m_vol->clusterSizeShift();
+      }
 #endif  // USE_MULTI_BLOCK_IO
     } else {
       // use single block write command
       n = 512;
-      if (m_vol->cacheBlockNumber() == block) {
-        m_vol->cacheInvalidate();
-      }
-      if (!m_vol->writeBlock(block, src)) {
+      m_vol->cacheInvalidate(block, 1);
+      if (!writeStreamStart(block, 1) || !m_vol->writeBlock(block, src)) {
         DBG_FAIL_MACRO;
         goto fail;
       }
@@ -1492,3 +2087,73 @@ fail:
   m_error |= WRITE_ERROR;
   return -1;
 }
+//------------------------------------------------------------------------------
+#if USE_WRITE_BUFFER
+bool FatFile::setWriteBuffer(void* buf, size_t size) {
+  FAT_FILE_LOCK(this);
+  if (!isFile() || !(m_flags & O_WRITE) || !writeBufferFlush()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (size > 0XFE00) {
+    size = 0XFE00;
+  }
+  m_writeBuf = reinterpret_cast<uint8_t*>(buf);
+  m_writeBufSize = buf ? size & ~0X1FF : 0;
+  return true;
+
+fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+bool FatFile::writeBufferFlush() {
+  uint16_t size = m_writeBufSize;
+  size_t n = m_writeBufCount;
+  if (n == 0) {
+    return true;
+  }
+  // Write the buffered data with the buffer disabled.
+  m_writeBufCount = 0;
+  m_writeBufSize = 0;
+  int rtn = write(m_writeBuf, n);
+  m_writeBufSize = size;
+  return rtn == static_cast<int>(n);
+}
+#endif  // USE_WRITE_BUFFER
+//------------------------------------------------------------------------------
+bool FatFile::writeStreamBegin() {
+  FAT_FILE_LOCK(this);
+  if (!writeBufferFlush()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  // error if not a normal file open for write or not at a block boundary
+  if (!isFile() || !(m_flags & O_WRITE) || (m_curPosition & 0X1FF)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_flags |= F_WRITE_STREAM;
+  return true;
+
+fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+bool FatFile::writeStreamEnd() {
+  FAT_FILE_LOCK(this);
+  if (!(m_flags & F_WRITE_STREAM)) {
+    return true;
+  }
+  m_flags &= ~F_WRITE_STREAM;
+  return m_vol->syncBlocks();
+}
+//------------------------------------------------------------------------------
+// Open or continue a write sequence at block if streaming.  Only the count
+// blocks about to be written are pre-erased, a restart must not erase data
+// of the file past them.
+bool FatFile::writeStreamStart(uint32_t block, uint32_t count) {
+  if (!(m_flags & F_WRITE_STREAM)) {
+    return true;
+  }
+  return m_vol->writeStart(block, count);
+}
@@ -71,8 +71,52 @@ struct FatPos_t {
   FatPos_t() : position(0), cluster(0) {}
 };
 //------------------------------------------------------------------------------
+/**
+ * \struct FatDirInfo_t
+ * \brief Directory entry summary returned by FatFile::readDirInfo().
+ */
+struct FatDirInfo_t {
+  /** File size in bytes, zero for a directory. */
+  uint32_t fileSize;
+  /** First cluster of the file, zero if the file is empty. */
+  uint32_t firstCluster;
+  /** Index of the entry to open with FatFile::open(dirFile, index, oflag). */
+  uint16_t index;
+  /** Creation date in FAT format. */
+  uint16_t creationDate;
+  /** Creation time in FAT format. */
+  uint16_t creationTime;
+  /** Last write date in FAT format. */
+  uint16_t lastWriteDate;
+  /** Last write time in FAT format. */
+  uint16_t lastWriteTime;
+  /** Entry attributes, see DIR_ATT_READ_ONLY and friends. */
+  uint8_t attributes;
+  /** Long name if present else 8.3 name, zero terminated. */
+  char name[DIR_INFO_NAME_DIM];
+};
+//------------------------------------------------------------------------------
+/**
+ * \struct FatExtent_t
+ * \brief A run of contiguous clusters in a file's cluster chain.
+ */
+struct FatExtent_t {
+  /** first cluster of the run */
+  uint32_t cluster;
+  /** number of clusters in the run */
+  uint32_t count;
+};
+//------------------------------------------------------------------------------
 /** Expression for path name separator. */
 #define isDirSeparator(c) ((c) == '/')
+#if ENABLE_LOCK_HOOKS
+/** Internal - hold the lock of this file and the volume of \a file. */
+#define FAT_FILE_LOCK(file)\
+  FatLockGuard fileLock_(m_lockHook, m_lockContext);\
+  FAT_VOLUME_LOCK((file)->isOpen() ? (file)->m_vol : 0)
+#else  // ENABLE_LOCK_HOOKS
+#define FAT_FILE_LOCK(file)
+#endif  // ENABLE_LOCK_HOOKS
 //------------------------------------------------------------------------------
 /**
  * \struct fname_t
@@ -109,7 +153,11 @@ const uint8_t FNAME_FLAG_LC_EXT = DIR_NT_LC_EXT;
 class FatFile {
  public:
   /** Create an instance. */
-  FatFile() : m_attr(FILE_ATTR_CLOSED), m_error(0) {}
+  FatFile() : m_attr(FILE_ATTR_CLOSED), m_error(0) {
+#if ENABLE_LOCK_HOOKS
+    m_lockHook = 0;
+#endif  // ENABLE_LOCK_HOOKS
+  }
   /**  Create a file object and open it in the current working directory.
    *
    * \param[in] path A path with a valid 8.3 DOS name for a file to be opened.
@@ -120,6 +168,9 @@ class FatFile {
   FatFile(const char* path, uint8_t oflag) {
     m_attr = FILE_ATTR_CLOSED;
     m_error = 0;
+#if ENABLE_LOCK_HOOKS
+    m_lockHook = 0;
+#endif  // ENABLE_LOCK_HOOKS
     open(path, oflag);
   }
 #if DESTRUCTOR_CLOSES_FILE
@@ -202,6 +253,15 @@ class FatFile {
   uint32_t available() {
     return isFile() ? fileSize() - curPosition() : 0;
   }
+#if ENABLE_LAZY_SYNC
+  /** Write all modified data, the directory entry and the FAT and
+   * FSINFO updates deferred by FatVolume::setLazySync().
+   *
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool commit();
+#endif  // ENABLE_LAZY_SYNC
   /** Close a file and force cached data and directory information
    *  to be written to the storage device.
    *
@@ -210,6 +270,9 @@ class FatFile {
    */
   bool close();
   /** Check for contiguous file and return its raw block range.
+   *
+   * If the file is contiguous, seekSet(), read() and write() compute file
+   * blocks from the first cluster and do not access the FAT.
    *
    * \param[out] bgnBlock the first block address for the file.
    * \param[out] endBlock the last  block address for the file.
@@ -226,19 +289,30 @@ class FatFile {
    * \param[in] dirFile The directory where the file will be created.
    * \param[in] path A path with a valid DOS 8.3 file name.
    * \param[in] size The desired file size.
+   * \param[in] erase Set true to erase the allocated clusters so the
+   * first writes to the file are fast.  Requires ENABLE_ERASE_TRIM.
    *
    * \return The value true is returned for success and
    * the value false, is returned for failure.
    */
+#if ENABLE_ERASE_TRIM
+  bool createContiguous(FatFile* dirFile, const char* path,
+                        uint32_t size, bool erase = false);
+#else  // ENABLE_ERASE_TRIM
   bool createContiguous(FatFile* dirFile,
                         const char* path, uint32_t size);
+#endif  // ENABLE_ERASE_TRIM
   /** \return The current cluster number for a file or directory. */
   uint32_t curCluster() const {
     return m_curCluster;
   }
   /** \return The current position for a file or directory. */
   uint32_t curPosition() const {
+#if USE_WRITE_BUFFER
+    return m_curPosition + m_writeBufCount;
+#else  // USE_WRITE_BUFFER
     return m_curPosition;
+#endif  // USE_WRITE_BUFFER
   }
   /** \return Current working directory */
   static FatFile* cwd() {
@@ -349,7 +423,11 @@ class FatFile {
   int16_t fgets(char* str, int16_t num, char* delim = 0);
   /** \return The total number of bytes in a file. */
   uint32_t fileSize() const {
+#if USE_WRITE_BUFFER
+    return curPosition() > m_fileSize ? curPosition() : m_fileSize;
+#else  // USE_WRITE_BUFFER
     return m_fileSize;
+#endif  // USE_WRITE_BUFFER
   }
   /** \return The first cluster number for a file or directory. */
   uint32_t firstCluster() const {
@@ -375,6 +453,21 @@ class FatFile {
    * the value false, is returned for failure.
    */  
   bool getSFN(char* name);
+  /** Check if the device is programming data from a previous write.
+   * A logger can do other work until this returns false so the next
+   * write() does not wait for the device.
+   *
+   * \return true if the device is busy else false.
+   */
+  bool isBusy() {
+    return isOpen() && m_vol->isBusy();
+  }
+  /** \return True if the file is known to be contiguous. See
+   * contiguousRange() and createContiguous().
+   */
+  bool isContiguous() const {
+    return m_flags & F_CONTIGUOUS;
+  }
   /** \return True if this is a directory else false. */
   bool isDir() const {
     return m_attr & FILE_ATTR_DIR;
@@ -581,6 +674,29 @@ class FatFile {
    * \return The byte if no error and not at eof else -1;
    */
   int peek();
+#if USE_FILE_PIN
+  /** Load a region of a file into a user supplied buffer and pin it.
+   *
+   * The region is read once with multiple block reads.  read() and
+   * fgets() then copy data in the region from the buffer instead of
+   * the device, so fonts and icons that are read many times stay in RAM.
+   * readAsync() always reads the device.
+   *
+   * The pin is removed by write(), truncate(), a call with a null
+   * \a buf and by open().  Other FatFile objects for the same file do
+   * not see the pin and must not write the file while it is pinned.
+   *
+   * \param[in] pos Position of the region in the file.
+   * \param[in] len Number of bytes in the region.
+   * \param[in] buf Buffer of \a len bytes or null to remove the pin.
+   * Must remain valid until the pin is removed.
+   *
+   * \return The value true is returned for success and
+   * the value false is returned for failure.  The current position
+   * is not changed.
+   */
+  bool prefetch(uint32_t pos, size_t len, void* buf);
+#endif  // USE_FILE_PIN
   /** Print a file's creation date and time
    *
    * \param[in] pr Print stream for output.
@@ -636,6 +752,31 @@ class FatFile {
    * \return The number of bytes written or -1 if an error occurs.
    */
   int printField(uint32_t value, char term);
+  /** Print a fixed point number followed by a field terminator.
+   *
+   * Uses integer math only, which is much faster than printField() for
+   * float on boards without floating point hardware.
+   *
+   * \param[in] value The number times 10^places, 12345 with two places
+   * prints as 123.45.
+   * \param[in] term The field terminator.  Use '\n' for CR LF.
+   * \param[in] places Number of digits after decimal point.
+   * \return The number of bytes written or -1 if an error occurs.
+   */
+  int printFieldFixed(int32_t value, char term, uint8_t places);
+  /** Print a row of fixed point numbers with one write().
+   *
+   * Fields are separated by \a sep and the row ends with CR LF.
+   *
+   * \param[in] value Array of numbers, each times 10^places.
+   * \param[in] count Number of elements in \a value.
+   * \param[in] places Number of digits after decimal point, zero for
+   * integers.
+   * \param[in] sep The field separator.
+   * \return The number of bytes written or -1 if an error occurs.
+   */
+  int printRow(const int32_t* value, uint8_t count,
+               uint8_t places = 0, char sep = ',');
   /** Print a file's modify date and time
    *
    * \param[in] pr Print stream for output.
@@ -690,7 +831,137 @@ class FatFile {
    * read() called before a file has been opened, corrupt file system
    * or an I/O error occurred.
    */
-  int read(void* buf, size_t nbyte);
+  int read(void* buf, size_t nbyte) {
+    return readData(reinterpret_cast<uint8_t*>(buf), 0, 0, nbyte);
+  }
+  /** Read data from a file starting at the current position and pass it
+   * to a sink function instead of copying it to a buffer.
+   *
+   * Data in the cache is passed directly from the cache.  Whole blocks
+   * are passed as runs of bytes received from the device if the device
+   * supports it, otherwise they are read into the cache and passed as
+   * one run.  The sink must not access files in the volume.
+   *
+   * \param[in] sink Function called with each run of data.
+   *
+   * \param[in] context Pointer passed to \a sink.
+   *
+   * \param[in] nbyte Maximum number of bytes to read.
+   *
+   * \return For success read() returns the number of bytes read.
+   * A value less than \a nbyte, including zero, will be returned
+   * if end of file is reached.
+   * If an error occurs, read() returns -1.
+   */
+  int read(readSink_t sink, void* context, size_t nbyte) {
+    return readData(0, sink, context, nbyte);
+  }
+  /** Pass equally spaced ranges of a file to a sink, rows of a tile in
+   * a raw image for example.
+   *
+   * Ranges are read in file order with one seek each.  The seek is fast
+   * for contiguous files or with an extent map, see setExtentMap().
+   * Blocks shared by two ranges come from the cache and whole blocks are
+   * passed from the device as in read() with a sink.  Gaps of up to
+   * \a gap blocks between ranges are read and discarded so an open
+   * multi-block read, ENABLE_READ_STREAMING, does not need a new command.
+   *
+   * \param[in] pos Position of the first range.
+   * \param[in] len Length of each range in bytes.
+   * \param[in] stride Distance in bytes between the start of ranges.
+   * \param[in] count Number of ranges.
+   * \param[in] sink Function called with each run of data.
+   * \param[in] context Pointer passed to \a sink.
+   * \param[in] gap Largest gap in blocks to read through.
+   *
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool readRows(uint32_t pos, size_t len, uint32_t stride, uint16_t count,
+                readSink_t sink, void* context, uint8_t gap = 0);
+  /** Read decimal integers starting at the current position.
+   *
+   * Numbers are parsed in blocks of text read into \a buf, not a character
+   * at a time.  Any characters other than digits and signs separate
+   * numbers.  Reading stops after \a count numbers, at end of file, or at
+   * a field that is not a number.  The file is positioned after the last
+   * number read.
+   *
+   * \param[out] value Array that will receive the numbers.
+   * \param[in] count Maximum number of values to read.
+   * \param[in] buf Scratch buffer.  Use 512 bytes or more for speed.
+   * \param[in] size Size of \a buf.  Must be longer than any number.
+   *
+   * \return The number of values read or -1 if an error occurs.
+   */
+  int readNumbers(int32_t* value, size_t count, char* buf, size_t size);
+  /** Read decimal integers using a small buffer on the stack.
+   *
+   * \param[out] value Array that will receive the numbers.
+   * \param[in] count Maximum number of values to read.
+   *
+   * \return The number of values read or -1 if an error occurs.
+   */
+  int readNumbers(int32_t* value, size_t count) {
+    char buf[64];
+    return readNumbers(value, count, buf, sizeof(buf));
+  }
+  /** Read floating point numbers starting at the current position.
+   *
+   * Like readNumbers() for integers except a decimal point and exponent
+   * are also allowed.  Numbers are converted by scanFloat().
+   *
+   * \param[out] value Array that will receive the numbers.
+   * \param[in] count Maximum number of values to read.
+   * \param[in] buf Scratch buffer.  Use 512 bytes or more for speed.
+   * \param[in] size Size of \a buf.  Must be longer than any number.
+   *
+   * \return The number of values read or -1 if an error occurs.
+   */
+  int readNumbers(float* value, size_t count, char* buf, size_t size);
+  /** Read floating point numbers using a small buffer on the stack.
+   *
+   * \param[out] value Array that will receive the numbers.
+   * \param[in] count Maximum number of values to read.
+   *
+   * \return The number of values read or -1 if an error occurs.
+   */
+  int readNumbers(float* value, size_t count) {
+    char buf[64];
+    return readNumbers(value, count, buf, sizeof(buf));
+  }
+#if ENABLE_ASYNC_READ
+  /** Start reading whole blocks from a file and return while the device
+   * receives the data.
+   *
+   * The current position must be a multiple of 512.  The read stops at
+   * the end of the current cluster unless the file is contiguous.  The
+   * last block of the file is transferred in full so \a buf must hold
+   * a whole number of blocks.  Use readAsyncStatus() or \a callback
+   * to find when the data is in \a buf.  Other access to the volume
+   * waits for the read to finish.
+   *
+   * \param[out] buf Pointer to the location that will receive the data.
+   *
+   * \param[in] nbyte Size of \a buf, at least 512 bytes.
+   *
+   * \param[in] callback Optional function called when the read is done.
+   *
+   * \param[in] context Pointer passed to \a callback.
+   *
+   * \return The number of file bytes that will be read, zero at end of
+   * file, or -1 if an error occurs.  The file position is advanced
+   * before the data arrives.
+   */
+  int readAsync(void* buf, size_t nbyte,
+                readDone_t callback = 0, void* context = 0);
+  /** Check for completion of readAsync().
+   *
+   * \return One if the read is done, zero if the read is in progress
+   * or minus one if the read failed.
+   */
+  int8_t readAsyncStatus();
+#endif  // ENABLE_ASYNC_READ
   /** Read the next directory entry from a directory file.
    *
    * \param[out] dir The dir_t struct that will receive the data.
@@ -702,6 +973,19 @@ class FatFile {
    * a directory file or an I/O error occurred.
    */
   int8_t readDir(dir_t* dir);
+  /** Read a batch of directory entries from a directory file.
+   *
+   * Entries are summarized from the cached directory blocks without
+   * opening each file.  Deleted entries, volume labels, '.' and '..'
+   * are skipped.  Call rewind() to start at the first entry.
+   *
+   * \param[out] info Array that will receive the entries.
+   * \param[in] count Number of elements in \a info.
+   *
+   * \return The number of entries read, zero at the end of the directory
+   * or -1 if an error occurs.
+   */
+  int readDirInfo(FatDirInfo_t* info, size_t count);
   /** Remove a file.
    *
    * The directory entry and all data for the file are deleted.
@@ -734,6 +1018,9 @@ class FatFile {
     seekSet(0);
   }
   /** Rename a file or subdirectory.
+   *
+   * The old directory entries are reused if \a newPath is a name in the
+   * same directory that needs no more entries than the old name.
    *
    * \param[in] dirFile Directory for the new path.
    * \param[in] newPath New path name for the file/directory.
@@ -765,6 +1052,9 @@ class FatFile {
    * subdirectories.  The directory will then be removed if it is not root.
    * The read-only attribute for files will be ignored.
    *
+   * Entries are marked deleted and cluster chains are freed in the cache
+   * with one sync at the end, so each directory block is written once.
+   *
    * \note This function should not be used to delete the 8.3 version of
    * a directory that has a long name.  See remove() and rmdir().
    *
@@ -777,7 +1067,7 @@ class FatFile {
    * \return true for success or false for failure.
    */
   bool seekCur(int32_t offset) {
-    return seekSet(m_curPosition + offset);
+    return seekSet(curPosition() + offset);
   }
   /** Set the files position to end-of-file + \a offset. See seekSet().
    * Can't be used for directory files since file size is not defined.
@@ -785,7 +1075,7 @@ class FatFile {
    * \return true for success or false for failure.
    */
   bool seekEnd(int32_t offset = 0) {
-    return isFile() ? seekSet(m_fileSize + offset) : false;
+    return isFile() ? seekSet(fileSize() + offset) : false;
   }
   /** Sets a file's position.
    *
@@ -811,10 +1101,69 @@ class FatFile {
   /** The sync() call causes all modified data and directory fields
    * to be written to the storage device.
    *
+   * If lazy sync is enabled by FatVolume::setLazySync(), the directory
+   * entry is not written.  Use commit() to write it.
+   *
    * \return The value true is returned for success and
    * the value false is returned for failure.
    */
   bool sync();
+#if USE_EXTENT_MAP
+  /** Map a file's cluster chain into a user supplied extent table.
+   *
+   * The chain is read once and stored as runs of contiguous clusters.
+   * seekSet(), read() and write() then find clusters in the table instead
+   * of following the chain in the FAT.  If the chain has more runs than
+   * the table holds, the FAT is used past the last run in the table.
+   *
+   * The table must remain valid until the file is closed or
+   * setExtentMap() is called again.  The map is removed by truncate().
+   *
+   * \param[in] extent Table for the map or null to remove the map.
+   * \param[in] count Number of entries in \a extent.
+   *
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool setExtentMap(FatExtent_t* extent, uint8_t count);
+#endif  // USE_EXTENT_MAP
+#if USE_WRITE_BUFFER
+  /** Combine small writes in a user supplied buffer.
+   *
+   * write() copies data to the buffer and the buffer is written when it
+   * is full, so whole blocks are written with one multiple block write.
+   * The buffer is also written by sync(), close(), seekSet(), read(),
+   * truncate() and a write() that does not fit.  Data in the buffer is
+   * lost if power fails before it has been written.
+   *
+   * Not used for files opened with O_SYNC.
+   *
+   * \param[in] buf Buffer or null to stop use of a buffer.  Must remain
+   * valid until the file is closed or setWriteBuffer() is called again.
+   * \param[in] size Size of \a buf in bytes.  Rounded down to a multiple
+   * of 512.  The maximum is 65024.
+   *
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool setWriteBuffer(void* buf, size_t size);
+#endif  // USE_WRITE_BUFFER
+#if ENABLE_LOCK_HOOKS
+  /** Set a lock for this file object.
+   *
+   * The lock is held by FatFile functions called for this object so
+   * several tasks may share one open file.  The volume lock set by
+   * FatVolume::setLock() is taken after this lock.  The lock stays
+   * set when the file is closed or opened again.
+   *
+   * \param[in] hook Lock hook or zero for none.
+   * \param[in] context Pointer passed to \a hook.
+   */
+  void setLock(lockHook_t hook, void* context = 0) {
+    m_lockHook = hook;
+    m_lockContext = context;
+  }
+#endif  // ENABLE_LOCK_HOOKS
   /** Copy a file's timestamps
    *
    * \param[in] file File to copy timestamps from.
@@ -915,6 +1264,30 @@ class FatFile {
    *
    */
   int write(const void* buf, size_t nbyte);
+  /** Start a write streaming session.
+   *
+   * Blocks written by write() are sent in a multiple block write
+   * sequence that stays open between calls.  The sequence is restarted
+   * if another block is accessed or the file leaves the current run of
+   * blocks.  Each sequence pre-erases only the blocks of the write that
+   * starts it, so existing data past the end of the session is kept.
+   * A file preallocated with createContiguous() is written with a
+   * single sequence.
+   *
+   * \note The current position must be a multiple of 512.  A partial
+   * block inside the file is read before it is written.
+   *
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool writeStreamBegin();
+  /** End a write streaming session.  The last partial block stays in
+   * the cache until sync() or close() is called.
+   *
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool writeStreamEnd();
 //------------------------------------------------------------------------------
  private:
   /** This file has not been opened. */
@@ -949,21 +1322,63 @@ class FatFile {
   bool addCluster();
   bool addDirCluster();
   dir_t* cacheDirEntry(uint8_t action);
+#if USE_EXTENT_MAP
+  uint32_t extentSeek(uint32_t index);
+#endif  // USE_EXTENT_MAP
+#if USE_DIR_HASH_INDEX
+  bool hashIndexBuild();
+#endif  // USE_DIR_HASH_INDEX
+  static void dirInfoCopy(const dir_t* dir, uint16_t index,
+                          FatDirInfo_t* info);
   static uint8_t lfnChecksum(uint8_t* name);
-  bool lfnUniqueSfn(fname_t* fname);
+  int8_t lfnRename(FatFile* dirFile, const char* newPath);
+  bool lfnUniqueSfn(fname_t* fname, bool tilde1);
+  int8_t nextCluster();
   bool openCluster(FatFile* file);
   static bool parsePathName(const char* str, fname_t* fname, const char** ptr);
+#if PATH_CACHE_SIZE
+  void pathCacheAdd(uint32_t start, const char* path, size_t len);
+  bool pathCacheOpen(FatVolume* vol, uint32_t start,
+                     const char* path, size_t len);
+#endif  // PATH_CACHE_SIZE
   bool mkdir(FatFile* parent, fname_t* fname);
   bool open(FatFile* dirFile, fname_t* fname, uint8_t oflag);
   bool openCachedEntry(FatFile* dirFile, uint16_t cacheIndex, uint8_t oflag,
                        uint8_t lfnOrd);
+  int readData(uint8_t* dst, readSink_t sink, void* context, size_t nbyte);
   bool readLBN(uint32_t* lbn);
   dir_t* readDirCache(bool skipReadOk = false);
+  bool rmRfTree();
+  // Clear the object for open() but keep the lock hook.
+  void resetState() {
+#if ENABLE_LOCK_HOOKS
+    lockHook_t hook = m_lockHook;
+    void* context = m_lockContext;
+    memset(this, 0, sizeof(FatFile));
+    m_lockHook = hook;
+    m_lockContext = context;
+#else  // ENABLE_LOCK_HOOKS
+    memset(this, 0, sizeof(FatFile));
+#endif  // ENABLE_LOCK_HOOKS
+  }
   bool setDirSize();
+  bool syncFile(bool dirEntry);
+#if USE_WRITE_BUFFER
+  bool writeBufferFlush();
+#else  // USE_WRITE_BUFFER
+  bool writeBufferFlush() {
+    return true;
+  }
+#endif  // USE_WRITE_BUFFER
+  bool writeStreamStart(uint32_t block, uint32_t count);
 
   // bits defined in m_flags
   // should be 0X0F
   static uint8_t const F_OFLAG = (O_ACCMODE | O_APPEND | O_SYNC);
+  // blocks are written in an open multiple block sequence
+  static uint8_t const F_WRITE_STREAM = 0X10;
+  // file clusters are contiguous
+  static uint8_t const F_CONTIGUOUS = 0X40;
   // sync of directory entry required
   static uint8_t const F_FILE_DIR_DIRTY = 0X80;
 
@@ -974,17 +1389,44 @@ class FatFile {
   // private data
   static const uint8_t WRITE_ERROR = 0X1;
   static const uint8_t READ_ERROR  = 0X2;
+  // Small members come first so FatFile has no tail padding.  open()
+  // clears the object with resetState() and a derived class may place its
+  // members in the tail padding of FatFile.
   uint8_t    m_attr;             // File attributes
   uint8_t    m_error;            // Error bits.
   uint8_t    m_flags;            // See above for definition of m_flags bits
   uint8_t    m_lfnOrd;
   uint16_t   m_dirIndex;         // index of directory entry in dir file
+#if USE_EXTENT_MAP
+  uint8_t    m_extentCount;      // number of extents in map
+#endif  // USE_EXTENT_MAP
+#if USE_WRITE_BUFFER
+  uint16_t   m_writeBufSize;     // size of write buffer, multiple of 512
+  uint16_t   m_writeBufCount;    // bytes in buffer to write at m_curPosition
+#endif  // USE_WRITE_BUFFER
   FatVolume* m_vol;              // volume where file is located
+#if USE_EXTENT_MAP
+  FatExtent_t* m_extent;         // user supplied cluster extent map
+#endif  // USE_EXTENT_MAP
+#if USE_WRITE_BUFFER
+  uint8_t*   m_writeBuf;         // user supplied write buffer
+#endif  // USE_WRITE_BUFFER
+#if USE_FILE_PIN
+  uint8_t*   m_pinBuf;           // user supplied buffer for pinned data
+#endif  // USE_FILE_PIN
+#if ENABLE_LOCK_HOOKS
+  lockHook_t m_lockHook;         // lock for this object
+  void*      m_lockContext;      // argument for m_lockHook
+#endif  // ENABLE_LOCK_HOOKS
   uint32_t   m_dirCluster;
   uint32_t   m_curCluster;       // cluster for current file position
   uint32_t   m_curPosition;      // current file position
   uint32_t   m_dirBlock;         // block for this files directory entry
   uint32_t   m_fileSize;         // file size in bytes
   uint32_t   m_firstCluster;     // first cluster of file
+#if USE_FILE_PIN
+  uint32_t   m_pinPos;           // file position of m_pinBuf
+  uint32_t   m_pinSize;          // bytes in m_pinBuf, zero if no pin
+#endif  // USE_FILE_PIN
 };
 #endif  // FatFile_h
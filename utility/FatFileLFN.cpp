@@ -115,6 +115,7 @@ static void lfnPutName(ldir_t *ldir, const char* name, size_t n) {
 }
 //==============================================================================
 bool FatFile::getName(char* name, size_t size) {
+  FAT_FILE_LOCK(this);
   FatFile dirFile;
   ldir_t* ldir;
   if (!isOpen() || size < 13) {
@@ -166,7 +167,7 @@ bool FatFile::openCluster(FatFile* file) {
   if (file->m_dirCluster == 0) {
     return openRoot(file->m_vol);
   }
-  memset(this, 0, sizeof(FatFile));
+  resetState();
   m_attr = FILE_ATTR_SUBDIR;
   m_flags = O_READ;
   m_vol = file->m_vol;
@@ -285,7 +286,111 @@ bool FatFile::parsePathName(const char* path,
   return true;
 }
 //------------------------------------------------------------------------------
+#if USE_DIR_HASH_INDEX
+// Hash of lower case name with the 13 character pieces in the order of
+// the long name directory entries, last piece first.
+static uint16_t lfnHash(fname_t* fname) {
+  uint16_t hash = 0;
+  size_t k = 13*((fname->len - 1)/13);
+  while (1) {
+    for (size_t i = k; i < (k + 13) && i < fname->len; i++) {
+      char c = lfnToLower(fname->lfn[i]);
+      hash = Bernstein(hash, &c, 1);
+    }
+    if (k == 0) {
+      return hash;
+    }
+    k -= 13;
+  }
+}
+//------------------------------------------------------------------------------
+static uint16_t sfnHash(uint8_t* sfn) {
+  return Bernstein(0, reinterpret_cast<char*>(sfn), 11);
+}
+//------------------------------------------------------------------------------
+bool FatFile::hashIndexBuild() {
+  FAT_FILE_LOCK(this);
+  uint8_t lfnOrd = 0;
+  uint8_t ord = 0;
+  uint8_t chksum = 0;
+  uint16_t hash = 0;
+  uint16_t lfnIndex = 0;
+  uint16_t curIndex;
+  dir_t* dir;
+  FatVolume* vol = m_vol;
+
+  memset(vol->m_hashIndex, 0XFF, 4UL*vol->m_hashIndexSize);
+  vol->m_hashIndexCount = 0;
+  vol->m_hashIndexCluster = m_firstCluster;
+  rewind();
+  while (1) {
+    curIndex = m_curPosition/32;
+    dir = readDirCache(true);
+    if (!dir) {
+      if (getError()) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      break;
+    }
+    if (dir->name[0] == DIR_NAME_FREE) {
+      break;
+    }
+    // skip empty slot or '.' or '..'
+    if (dir->name[0] == DIR_NAME_DELETED || dir->name[0] == '.') {
+      lfnOrd = 0;
+    } else if (DIR_IS_LONG_NAME(dir)) {
+      ldir_t *ldir = reinterpret_cast<ldir_t*>(dir);
+      if (!lfnOrd) {
+        if ((ldir->ord & LDIR_ORD_LAST_LONG_ENTRY) == 0) {
+          continue;
+        }
+        lfnOrd = ord = ldir->ord & 0X1F;
+        chksum = ldir->chksum;
+        lfnIndex = curIndex;
+        hash = 0;
+      } else if (ldir->ord != --ord || chksum != ldir->chksum) {
+        lfnOrd = 0;
+        continue;
+      }
+      for (uint8_t i = 0; i < 13; i++) {
+        uint16_t u = lfnGetChar(ldir, i);
+        if (u == 0) {
+          break;
+        }
+        if (u > 255) {
+          // open() can't match this name.
+          lfnOrd = 0;
+          break;
+        }
+        char c = lfnToLower(u);
+        hash = Bernstein(hash, &c, 1);
+      }
+    } else if (DIR_IS_FILE_OR_SUBDIR(dir)) {
+      if (lfnOrd && 1 == ord && lfnChecksum(dir->name) == chksum) {
+        if (!vol->hashIndexAdd(hash, lfnIndex)) {
+          break;
+        }
+      }
+      lfnOrd = 0;
+      if (!vol->hashIndexAdd(sfnHash(dir->name), curIndex)) {
+        break;
+      }
+    } else {
+      lfnOrd = 0;
+    }
+  }
+  vol->m_hashIndexValid = true;
+  return true;
+
+fail:
+  vol->m_hashIndexValid = false;
+  return false;
+}
+#endif  // USE_DIR_HASH_INDEX
+//------------------------------------------------------------------------------
 bool FatFile::open(FatFile* dirFile, fname_t* fname, uint8_t oflag) {
+  FAT_FILE_LOCK(dirFile);
   bool fnameFound = false;
   uint8_t lfnOrd = 0;
   uint8_t freeNeed;
@@ -297,6 +402,13 @@ bool FatFile::open(FatFile* dirFile, fname_t* fname, uint8_t oflag) {
   dir_t* dir;
   ldir_t* ldir;
   size_t len = fname->len;
+#if USE_DIR_HASH_INDEX
+  FatVolume* vol = dirFile->m_vol;
+  bool probe = false;
+  uint8_t hashPass = 0;
+  uint16_t hashKey[2];
+  uint16_t hashSlot = 0;
+#endif  // USE_DIR_HASH_INDEX
 
   if (!dirFile->isDir() || isOpen()) {
     DBG_FAIL_MACRO;
@@ -305,10 +417,63 @@ bool FatFile::open(FatFile* dirFile, fname_t* fname, uint8_t oflag) {
   // Number of directory entries needed.
   freeNeed = fname->flags & FNAME_FLAG_NEED_LFN ? 1 + (len + 12)/13 : 1;
 
+#if USE_DIR_HASH_INDEX
+  if (vol->m_hashIndexSize) {
+    if (!vol->m_hashIndexValid ||
+        vol->m_hashIndexCluster != dirFile->m_firstCluster) {
+      if (!dirFile->hashIndexBuild()) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+    }
+    // Table is not used if the directory has too many entries.
+    if (vol->m_hashIndexCount < vol->m_hashIndexSize) {
+      probe = true;
+      hashKey[0] = lfnHash(fname);
+      hashKey[1] = sfnHash(fname->sfn);
+      hashSlot = hashKey[0] % vol->m_hashIndexSize;
+    }
+  }
+#endif  // USE_DIR_HASH_INDEX
   dirFile->rewind();
   while (1) {
+#if USE_DIR_HASH_INDEX
+    if (probe && !lfnOrd) {
+      // Only read entries with a long or short name hash match.
+      uint16_t index;
+      while (hashPass < 2 &&
+             !vol->hashIndexFind(hashKey[hashPass], &hashSlot, &index)) {
+        if (++hashPass < 2) {
+          hashSlot = hashKey[1] % vol->m_hashIndexSize;
+        }
+      }
+      if (hashPass < 2) {
+        if (!dirFile->seekSet(32UL*index)) {
+          DBG_FAIL_MACRO;
+          goto fail;
+        }
+      } else if (!(oflag & O_CREAT) || !(oflag & O_WRITE)) {
+        // Not found.
+        DBG_FAIL_MACRO;
+        goto fail;
+      } else {
+rescan:
+        // Search all entries for free entries and an unique short name.
+        probe = false;
+        fnameFound = false;
+        freeFound = 0;
+        lfnOrd = 0;
+        dirFile->rewind();
+      }
+    }
+#endif  // USE_DIR_HASH_INDEX
     curIndex = dirFile->m_curPosition/32;
+#if USE_DIR_HASH_INDEX
+    // Cache may not hold the block after a seek.
+    dir = dirFile->readDirCache(!probe);
+#else  // USE_DIR_HASH_INDEX
     dir = dirFile->readDirCache(true);
+#endif  // USE_DIR_HASH_INDEX
     if (!dir) {
       if (dirFile->getError()) {
         DBG_FAIL_MACRO;
@@ -318,6 +483,13 @@ bool FatFile::open(FatFile* dirFile, fname_t* fname, uint8_t oflag) {
       goto create;
     }
     if (dir->name[0] == DIR_NAME_DELETED || dir->name[0] == DIR_NAME_FREE) {
+#if USE_DIR_HASH_INDEX
+      if (probe) {
+        // Table does not match the directory.
+        vol->hashIndexInvalidate();
+        goto rescan;
+      }
+#endif  // USE_DIR_HASH_INDEX
       if (freeFound == 0) {
         freeIndex = curIndex;
       }
@@ -396,6 +568,11 @@ found:
   goto open;
 
 create:
+#if FAT_READ_ONLY
+  // Create is removed from read-only builds.
+  DBG_FAIL_MACRO;
+  goto fail;
+#else  // FAT_READ_ONLY
   // don't create unless O_CREAT and O_WRITE
   if (!(oflag & O_CREAT) || !(oflag & O_WRITE)) {
     DBG_FAIL_MACRO;
@@ -431,10 +608,12 @@ create:
     freeFound += 16;
   }
   if (fnameFound) {
-    if (!dirFile->lfnUniqueSfn(fname)) {
+    if (!dirFile->lfnUniqueSfn(fname, false)) {
       goto fail;
     }
   }
+  // Table may be used by lfnUniqueSfn() until the new entry is written.
+  dirFile->m_vol->hashIndexInvalidate();
   if (!dirFile->seekSet(32UL*freeIndex)) {
     DBG_FAIL_MACRO;
     goto fail;
@@ -482,6 +661,7 @@ create:
 
   // Force write of entry to device.
   dirFile->m_vol->cacheDirty();
+#endif  // FAT_READ_ONLY
 
 open:
   // open entry in cache.
@@ -495,7 +675,66 @@ fail:
   return false;
 }
 //------------------------------------------------------------------------------
+int FatFile::readDirInfo(FatDirInfo_t* info, size_t count) {
+  FAT_FILE_LOCK(this);
+  uint8_t chksum = 0;
+  uint8_t lfnOrd = 0;
+  uint8_t ord = 0;
+  size_t n = 0;
+  // Cache may have changed since the last call.
+  bool cached = false;
+
+  if (!isDir() || (m_curPosition & 0X1F)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  while (n < count) {
+    uint16_t index = m_curPosition/32;
+    dir_t* dir = readDirCache(cached);
+    cached = true;
+    if (!dir) {
+      if (getError()) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      break;
+    }
+    // done if last entry
+    if (dir->name[0] == DIR_NAME_FREE) {
+      break;
+    }
+    // skip empty slot or '.' or '..'
+    if (dir->name[0] == DIR_NAME_DELETED || dir->name[0] == '.') {
+      lfnOrd = 0;
+    } else if (DIR_IS_LONG_NAME(dir)) {
+      ldir_t* ldir = reinterpret_cast<ldir_t*>(dir);
+      if (ldir->ord & LDIR_ORD_LAST_LONG_ENTRY) {
+        lfnOrd = ord = ldir->ord & 0X1F;
+        chksum = ldir->chksum;
+      } else if (!lfnOrd || ldir->ord != --ord || chksum != ldir->chksum) {
+        lfnOrd = 0;
+        continue;
+      }
+      // Pieces are stored last first so the name is complete at ord one.
+      lfnGetName(ldir, info[n].name, DIR_INFO_NAME_DIM);
+    } else if (DIR_IS_FILE_OR_SUBDIR(dir)) {
+      if (!lfnOrd || ord != 1 || chksum != lfnChecksum(dir->name)) {
+        dirName(dir, info[n].name);
+      }
+      dirInfoCopy(dir, index, &info[n++]);
+      lfnOrd = 0;
+    } else {
+      lfnOrd = 0;
+    }
+  }
+  return n;
+
+fail:
+  return -1;
+}
+//------------------------------------------------------------------------------
 size_t FatFile::printName(print_t* pr) {
+  FAT_FILE_LOCK(this);
   FatFile dirFile;
   uint16_t u;
   size_t n = 0;
@@ -547,6 +786,7 @@ fail:
 }
 //------------------------------------------------------------------------------
 bool FatFile::remove() {
+  FAT_FILE_LOCK(this);
   bool last;
   uint8_t chksum;
   uint8_t ord;
@@ -564,6 +804,7 @@ bool FatFile::remove() {
     DBG_FAIL_MACRO;
     goto fail;
   }
+  m_vol->hashIndexInvalidate();
   // Cache directory entry.
   dir = cacheDirEntry(FatCache::CACHE_FOR_WRITE);
   if (!dir) {
@@ -624,60 +865,285 @@ bool FatFile::remove() {
 fail:
   return false;
 }
+#if !FAT_READ_ONLY
+//------------------------------------------------------------------------------
+// Rename in place if newPath is a name in the directory of this file and
+// it needs no more entries than the old name.  Returns one if renamed, zero
+// if rename() must make a new entry and minus one for failure.
+int8_t FatFile::lfnRename(FatFile* dirFile, const char* newPath) {
+  fname_t fname;
+  const char* ptr;
+  uint8_t chksum;
+  uint8_t need;
+  uint16_t start = m_dirIndex - m_lfnOrd;
+  uint16_t sfnIndex;
+  FatFile dirTmp;
+  FatFile file;
+  dir_t entry;
+  dir_t* dir;
+  ldir_t* ldir;
+
+  if (!dirFile->isDir() || dirFile->m_firstCluster != m_dirCluster ||
+      isDirSeparator(*newPath) ||
+      !parsePathName(newPath, &fname, &ptr) || *ptr) {
+    return 0;
+  }
+  need = fname.flags & FNAME_FLAG_NEED_LFN ? 1 + (fname.len + 12)/13 : 1;
+  if (need > m_lfnOrd + 1) {
+    return 0;
+  }
+  // Fail if the new name exists.
+  if (file.open(dirFile, &fname, O_READ)) {
+    file.close();
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (!dirTmp.openCluster(this)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if ((fname.flags & FNAME_FLAG_LOST_CHARS) &&
+      !dirTmp.lfnUniqueSfn(&fname, true)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  dir = cacheDirEntry(FatCache::CACHE_FOR_READ);
+  if (!dir) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  memcpy(&entry, dir, sizeof(entry));
+
+  // m_lfnOrd is a guess if the file was opened by index so check the
+  // old entries, rename() makes a new entry if they don't match.
+  chksum = lfnChecksum(entry.name);
+  for (uint8_t ord = 1; ord <= m_lfnOrd; ord++) {
+    if (!dirTmp.seekSet(32UL*(m_dirIndex - ord))) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    ldir = reinterpret_cast<ldir_t*>(dirTmp.readDirCache());
+    if (!ldir) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    if (ldir->attr != DIR_ATT_LONG_NAME ||
+        ord != (ldir->ord & 0X1F) ||
+        chksum != ldir->chksum ||
+        (ord == m_lfnOrd) !=
+        ((ldir->ord & LDIR_ORD_LAST_LONG_ENTRY) != 0)) {
+      return 0;
+    }
+  }
+  // Write the new name over the first entries of the old name.
+  if (!dirTmp.seekSet(32UL*start)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  for (uint8_t ord = need - 1; ord; ord--) {
+    ldir = reinterpret_cast<ldir_t*>(dirTmp.readDirCache());
+    if (!ldir) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    m_vol->cacheDirty();
+    ldir->ord = ord == need - 1 ? LDIR_ORD_LAST_LONG_ENTRY | ord : ord;
+    ldir->attr = DIR_ATT_LONG_NAME;
+    ldir->type = 0;
+    ldir->chksum = lfnChecksum(fname.sfn);
+    ldir->mustBeZero = 0;
+    lfnPutName(ldir, fname.lfn, fname.len);
+  }
+  sfnIndex = dirTmp.m_curPosition/32;
+  dir = dirTmp.readDirCache();
+  if (!dir) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  memcpy(dir, &entry, sizeof(entry));
+  memcpy(dir->name, fname.sfn, 11);
+  dir->reservedNT &= ~(DIR_NT_LC_BASE | DIR_NT_LC_EXT);
+  dir->reservedNT |= (DIR_NT_LC_BASE | DIR_NT_LC_EXT) & fname.flags;
+  m_vol->cacheDirty();
+  m_dirBlock = m_vol->cacheBlockNumber();
+
+  // Delete entries of the old name that are not used.
+  while (dirTmp.m_curPosition/32 <= m_dirIndex) {
+    dir = dirTmp.readDirCache();
+    if (!dir) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    dir->name[0] = DIR_NAME_DELETED;
+    m_vol->cacheDirty();
+  }
+#if USE_DIR_HASH_INDEX
+  if (m_vol->m_hashIndexValid && m_vol->m_hashIndexCluster == m_dirCluster) {
+    // Keys of the old name point to the new short name entry so open()
+    // rejects them, then add keys for the new name.
+    for (uint16_t i = 0; i < m_vol->m_hashIndexSize; i++) {
+      uint16_t* p = m_vol->m_hashIndex + 2*i;
+      if (p[1] != 0XFFFF && start <= p[1] && p[1] <= m_dirIndex) {
+        p[1] = sfnIndex;
+      }
+    }
+    if (need > 1) {
+      m_vol->hashIndexAdd(lfnHash(&fname), start);
+    }
+    m_vol->hashIndexAdd(sfnHash(fname.sfn), sfnIndex);
+  }
+#endif  // USE_DIR_HASH_INDEX
+  m_dirIndex = sfnIndex;
+  m_lfnOrd = need - 1;
+  if (!m_vol->cacheSync()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  return 1;
+
+fail:
+  return -1;
+}
+#endif  // !FAT_READ_ONLY
+//------------------------------------------------------------------------------
+// Short name candidates tested in one directory pass.
+const uint8_t SFN_SEQ_BATCH = 16;
+//------------------------------------------------------------------------------
+static void sfnPutHex(uint8_t* str, uint16_t hex) {
+  for (uint8_t i = 4; i > 0; i--) {
+    uint8_t h = hex & 0XF;
+    str[i - 1] = h < 10 ? h + '0' : h + 'A' - 10;
+    hex >>= 4;
+  }
+}
 //------------------------------------------------------------------------------
-bool FatFile::lfnUniqueSfn(fname_t* fname) {
-  const uint8_t FIRST_HASH_SEQ = 2;  // min value is 2
-  uint8_t pos = fname->seqPos;;
+// Return a bit for each hash in the ~HHHH part of name that matches.
+static uint16_t sfnSeqMask(const uint8_t* name, const uint8_t* sfn,
+                           uint8_t pos, const uint16_t* hash, uint8_t n) {
+  uint16_t hex = 0;
+  uint16_t mask = 0;
+  if (memcmp(name, sfn, pos + 1) ||
+      memcmp(name + pos + 5, sfn + pos + 5, 6 - pos)) {
+    return 0;
+  }
+  for (uint8_t i = pos + 1; i < pos + 5; i++) {
+    uint8_t c = name[i];
+    if ('0' <= c && c <= '9') {
+      c -= '0';
+    } else if ('A' <= c && c <= 'F') {
+      c -= 'A' - 10;
+    } else {
+      return 0;
+    }
+    hex = hex << 4 | c;
+  }
+  for (uint8_t i = 0; i < n; i++) {
+    if (hash[i] == hex) {
+      mask |= 1U << i;
+    }
+  }
+  return mask;
+}
+//------------------------------------------------------------------------------
+bool FatFile::lfnUniqueSfn(fname_t* fname, bool tilde1) {
+  uint8_t pos = fname->seqPos;
+  uint8_t tilde[11];
+  uint16_t hash[SFN_SEQ_BATCH];
+  uint16_t used;
   dir_t *dir;
-  uint16_t hex;
+#if USE_DIR_HASH_INDEX
+  FatVolume* vol = m_vol;
+  uint16_t index;
+  // Use the table if it is valid for this directory.
+  bool probe = vol->m_hashIndexSize && vol->m_hashIndexValid &&
+               vol->m_hashIndexCluster == m_firstCluster &&
+               vol->m_hashIndexCount < vol->m_hashIndexSize;
+#endif  // USE_DIR_HASH_INDEX
 
   DBG_HALT_IF(!(fname->flags & FNAME_FLAG_LOST_CHARS));
   DBG_HALT_IF(fname->sfn[pos] != '~' && fname->sfn[pos + 1] != '1');
 
-  for (uint8_t seq = 2; seq < 100; seq++) {
-    if (seq < FIRST_HASH_SEQ) {
-      fname->sfn[pos + 1] = '0' + seq;
-    } else {
-      DBG_PRINT_IF(seq > FIRST_HASH_SEQ);
-      hex = Bernstein(seq + fname->len, fname->lfn, fname->len);
-      if (pos > 3) {
-        // Make space in name for ~HHHH.
-        pos = 3;
-      }
-      for (uint8_t i = pos + 4 ; i > pos; i--) {
-        uint8_t h = hex & 0XF;
-        fname->sfn[i] = h < 10 ? h + '0' : h + 'A' - 10;
-        hex >>= 4;
-      }
-    }
-    fname->sfn[pos] = '~';
-    rewind();
-    while (1) {
-      dir = readDirCache(true);
-      if (!dir) {
-        if (!getError()) {
-          // At EOF and name not found if no error.
-          goto done;
+  memcpy(tilde, fname->sfn, 11);
+  if (pos > 3) {
+    // Make space in name for ~HHHH.
+    pos = 3;
+  }
+  fname->sfn[pos] = '~';
+  for (uint8_t seq = 2; seq < 100; seq += SFN_SEQ_BATCH) {
+    uint8_t n = 100 - seq < SFN_SEQ_BATCH ? 100 - seq : SFN_SEQ_BATCH;
+    for (uint8_t i = 0; i < n; i++) {
+      hash[i] = Bernstein(seq + i + fname->len, fname->lfn, fname->len);
+    }
+    used = 0;
+#if USE_DIR_HASH_INDEX
+    if (probe) {
+      // Only read entries with a short name hash match.
+      for (uint8_t i = 0; i <= n; i++) {
+        uint16_t key;
+        if (i < n) {
+          sfnPutHex(fname->sfn + pos + 1, hash[i]);
+          key = sfnHash(fname->sfn);
+        } else if (tilde1) {
+          key = sfnHash(tilde);
+        } else {
+          break;
+        }
+        uint16_t slot = key % vol->m_hashIndexSize;
+        while (vol->hashIndexFind(key, &slot, &index)) {
+          if (!seekSet(32UL*index) || !(dir = readDirCache())) {
+            DBG_FAIL_MACRO;
+            goto fail;
+          }
+          if (DIR_IS_FILE_OR_SUBDIR(dir)) {
+            used |= sfnSeqMask(dir->name, fname->sfn, pos, hash, n);
+            if (!memcmp(dir->name, tilde, 11)) {
+              tilde1 = false;
+            }
+          }
         }
-        DBG_FAIL_MACRO;
-        goto fail;
       }
-      if (dir->name[0] == DIR_NAME_FREE) {
-        goto done;
+    } else {
+#endif  // USE_DIR_HASH_INDEX
+      rewind();
+      while (1) {
+        dir = readDirCache(true);
+        if (!dir) {
+          if (getError()) {
+            DBG_FAIL_MACRO;
+            goto fail;
+          }
+          // At EOF.
+          break;
+        }
+        if (dir->name[0] == DIR_NAME_FREE) {
+          break;
+        }
+        if (DIR_IS_FILE_OR_SUBDIR(dir)) {
+          used |= sfnSeqMask(dir->name, fname->sfn, pos, hash, n);
+          if (!memcmp(dir->name, tilde, 11)) {
+            tilde1 = false;
+          }
+        }
       }
-      if (DIR_IS_FILE_OR_SUBDIR(dir) && !memcmp(fname->sfn, dir->name, 11)) {
-        // Name found - try another.
-        break;
+#if USE_DIR_HASH_INDEX
+    }
+#endif  // USE_DIR_HASH_INDEX
+    if (tilde1) {
+      memcpy(fname->sfn, tilde, 11);
+      return true;
+    }
+    // Lowest free sequence number, same name as a search for each name.
+    for (uint8_t i = 0; i < n; i++) {
+      if (!(used & (1U << i))) {
+        sfnPutHex(fname->sfn + pos + 1, hash[i]);
+        return true;
       }
     }
   }
-  // fall inti fail - too many tries.
+  // fall into fail - too many tries.
   DBG_FAIL_MACRO;
 
 fail:
   return false;
-
-done:
-  return true;
 }
 #endif  // #if USE_LONG_FILE_NAMES
@@ -220,6 +220,61 @@ int FatFile::printField(int32_t value, char term) {
   return printFieldT(this, sign, (uint32_t)value, term);
 }
 //------------------------------------------------------------------------------
+int FatFile::printFieldFixed(int32_t value, char term, uint8_t places) {
+  char buf[24];
+  char* str = &buf[sizeof(buf)];
+  if (places > 9) {
+    places = 9;
+  }
+  if (term) {
+    *--str = term;
+    if (term == '\n') {
+      *--str = '\r';
+    }
+  }
+  str = fmtFixed(value, str, places);
+  return write(str, buf + sizeof(buf) - str);
+}
+//------------------------------------------------------------------------------
+int FatFile::printRow(const int32_t* value, uint8_t count,
+                      uint8_t places, char sep) {
+  char buf[64];
+  char* dst = buf;
+  int rtn = 0;
+  if (places > 9) {
+    places = 9;
+  }
+  for (uint8_t i = 0; i < count; i++) {
+    char tmp[16];
+    char* str = &tmp[sizeof(tmp)];
+    if ((i + 1) == count) {
+      *--str = '\n';
+      *--str = '\r';
+    } else {
+      *--str = sep;
+    }
+    str = fmtFixed(value[i], str, places);
+    uint8_t n = tmp + sizeof(tmp) - str;
+    // write the row buffer if the field does not fit
+    if ((buf + sizeof(buf) - dst) < n) {
+      if (write(buf, dst - buf) != (dst - buf)) {
+        return -1;
+      }
+      rtn += dst - buf;
+      dst = buf;
+    }
+    memcpy(dst, str, n);
+    dst += n;
+  }
+  if (dst > buf) {
+    if (write(buf, dst - buf) != (dst - buf)) {
+      return -1;
+    }
+    rtn += dst - buf;
+  }
+  return rtn;
+}
+//------------------------------------------------------------------------------
 bool FatFile::printModifyDateTime(print_t* pr) {
   dir_t dir;
   if (!dirEntry(&dir)) {
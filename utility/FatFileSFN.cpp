@@ -21,6 +21,7 @@
 #include "FatFileSystem.h"
 //------------------------------------------------------------------------------
 bool FatFile::getSFN(char* name) {
+  FAT_FILE_LOCK(this);
   dir_t* dir;
   if (!isOpen()) {
     DBG_FAIL_MACRO;
@@ -119,6 +120,7 @@ fail:
 // open with filename in fname
 #define SFN_OPEN_USES_CHKSUM 0
 bool FatFile::open(FatFile* dirFile, fname_t* fname, uint8_t oflag) {
+  FAT_FILE_LOCK(dirFile);
   bool emptyFound = false;
 #if SFN_OPEN_USES_CHKSUM
   uint8_t chksum;
@@ -184,6 +186,11 @@ bool FatFile::open(FatFile* dirFile, fname_t* fname, uint8_t oflag) {
     }
     index++;
   }
+#if FAT_READ_ONLY
+  // Create is removed from read-only builds.
+  DBG_FAIL_MACRO;
+  goto fail;
+#else  // FAT_READ_ONLY
   // don't create unless O_CREAT and O_WRITE
   if (!(oflag & O_CREAT) || !(oflag & O_WRITE)) {
     DBG_FAIL_MACRO;
@@ -228,6 +235,7 @@ bool FatFile::open(FatFile* dirFile, fname_t* fname, uint8_t oflag) {
 
   // Force write of entry to device.
   dirFile->m_vol->cacheDirty();
+#endif  // FAT_READ_ONLY
 
   // open entry in cache.
   return openCachedEntry(dirFile, index, oflag, 0);
@@ -236,11 +244,52 @@ fail:
   return false;
 }
 //------------------------------------------------------------------------------
+int FatFile::readDirInfo(FatDirInfo_t* info, size_t count) {
+  FAT_FILE_LOCK(this);
+  size_t n = 0;
+  // Cache may have changed since the last call.
+  bool cached = false;
+
+  if (!isDir() || (m_curPosition & 0X1F)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  while (n < count) {
+    uint16_t index = m_curPosition/32;
+    dir_t* dir = readDirCache(cached);
+    cached = true;
+    if (!dir) {
+      if (getError()) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      break;
+    }
+    // done if last entry
+    if (dir->name[0] == DIR_NAME_FREE) {
+      break;
+    }
+    // skip empty slot or '.' or '..'
+    if (dir->name[0] == DIR_NAME_DELETED || dir->name[0] == '.') {
+      continue;
+    }
+    if (DIR_IS_FILE_OR_SUBDIR(dir)) {
+      dirName(dir, info[n].name);
+      dirInfoCopy(dir, index, &info[n++]);
+    }
+  }
+  return n;
+
+fail:
+  return -1;
+}
+//------------------------------------------------------------------------------
 size_t FatFile::printName(print_t* pr) {
   return printSFN(pr);
 }
 //------------------------------------------------------------------------------
 bool FatFile::remove() {
+  FAT_FILE_LOCK(this);
   dir_t* dir;
   // Can't remove if LFN or not open for write.
   if (!isFile() || isLFN() || !(m_flags & O_WRITE)) {
@@ -0,0 +1,118 @@
+/* FatLib Library
+ * Copyright (C) 2015 by William Greiman
+ *
+ * This file is part of the FatLib Library
+ *
+ * This Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the FatLib Library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#include "FatFile.h"
+#include "FmtNumber.h"
+//------------------------------------------------------------------------------
+// Characters that may be part of a number.
+static bool isNumChar(char c, bool flt) {
+  return isDigit(c) || c == '-' || c == '+' ||
+         (flt && (c == '.' || c == 'e' || c == 'E'));
+}
+//------------------------------------------------------------------------------
+static void scanNum(const char* str, char** ptr, int32_t* value) {
+  *value = scanDec(str, ptr);
+}
+//------------------------------------------------------------------------------
+static void scanNum(const char* str, char** ptr, float* value) {
+  *value = scanFloat(str, ptr);
+}
+//------------------------------------------------------------------------------
+// Parse numbers from buf.  Only the partial number at the end of
+// buf is moved when buf is refilled so numbers are parsed in place.
+// The file is left positioned after the last number.
+template <typename T>
+static int readNumbersT(FatFile* file, T* value, size_t count,
+                        char* buf, size_t size, bool flt) {
+  size_t n = 0;
+  size_t len = 0;
+  char* p = buf;
+  char* end = buf;
+  bool eof = false;
+  // file position after the last number
+  uint32_t pos = file->curPosition();
+  if (size < 2) {
+    DBG_FAIL_MACRO;
+    return -1;
+  }
+  while (n < count) {
+    if (!eof) {
+      len = end - p;
+      memmove(buf, p, len);
+      size_t want = size - 1 - len;
+      int nr = file->read(buf + len, want);
+      if (nr < 0) {
+        DBG_FAIL_MACRO;
+        return -1;
+      }
+      eof = (size_t)nr < want;
+      len += nr;
+      // Terminate the data so scan stops at the end of buf.
+      buf[len] = '\0';
+      p = buf;
+      end = buf + len;
+    }
+    while (n < count) {
+      while (p < end && !isNumChar(*p, flt)) {
+        p++;
+      }
+      if (p == end) {
+        break;
+      }
+      char* q = p;
+      while (q < end && isNumChar(*q, flt)) {
+        q++;
+      }
+      if (q == end && !eof) {
+        if (p == buf) {
+          // Number does not fit in buf.
+          goto done;
+        }
+        break;
+      }
+      scanNum(p, &q, &value[n]);
+      if (q == p) {
+        goto done;
+      }
+      n++;
+      p = q;
+      pos = file->curPosition() - (end - p);
+    }
+    if (eof) {
+      break;
+    }
+  }
+
+done:
+  if (pos != file->curPosition() && !file->seekSet(pos)) {
+    DBG_FAIL_MACRO;
+    return -1;
+  }
+  return n;
+}
+//------------------------------------------------------------------------------
+int FatFile::readNumbers(int32_t* value, size_t count,
+                         char* buf, size_t size) {
+  return readNumbersT(this, value, count, buf, size, false);
+}
+//------------------------------------------------------------------------------
+int FatFile::readNumbers(float* value, size_t count,
+                         char* buf, size_t size) {
+  return readNumbersT(this, value, count, buf, size, true);
+}
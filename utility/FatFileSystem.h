@@ -44,6 +44,18 @@ class FatFileSystem : public  FatVolume {
     return (part ? init(part) : init(1) || init(0))
             && vwd()->openRoot(this) && FatFile::setCwd(vwd());
   }
+#if ENABLE_WARM_MOUNT
+  /**
+   * Initialize an FatFileSystem object from saved volume parameters.
+   * \param[in] geo Parameters from FatVolume::saveGeometry().
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool beginWarm(const FatGeometry_t* geo) {
+    vwd()->close();
+    return initWarm(geo) && vwd()->openRoot(this) && FatFile::setCwd(vwd());
+  }
+#endif  // ENABLE_WARM_MOUNT
 #if ENABLE_ARDUINO_FEATURES
    /** List the directory contents of the volume working directory to Serial.
    *
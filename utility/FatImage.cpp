@@ -0,0 +1,296 @@
+/* FatLib Library
+ * Copyright (C) 2015 by William Greiman
+ *
+ * This file is part of the FatLib Library
+ *
+ * This Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the FatLib Library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#include "FatImage.h"
+//------------------------------------------------------------------------------
+// Largest sink read, a multiple of 512 that fits in an AVR int.
+const size_t IMAGE_READ_MAX = 0X4000;
+//------------------------------------------------------------------------------
+static uint16_t le16(const uint8_t* p) {
+  return p[0] | (uint16_t)p[1] << 8;
+}
+//------------------------------------------------------------------------------
+static uint32_t le32(const uint8_t* p) {
+  return le16(p) | (uint32_t)le16(p + 2) << 16;
+}
+//------------------------------------------------------------------------------
+// Byte operations keep the AVR from doing 16-bit shifts.
+static inline uint16_t rgb888(const uint8_t* p) {
+  uint8_t hi = (p[2] & 0XF8) | (p[1] >> 5);
+  uint8_t lo = ((p[1] << 3) & 0XE0) | (p[0] >> 3);
+  return (uint16_t)hi << 8 | lo;
+}
+//------------------------------------------------------------------------------
+static inline uint16_t rgb555(const uint8_t* p) {
+  uint16_t v = le16(p);
+  return ((v & 0X7FE0) << 1) | ((v >> 4) & 0X20) | (v & 0X1F);
+}
+//------------------------------------------------------------------------------
+// Pass pixels in the buffer to the sink.
+void FatImage::flush() {
+  if (m_count) {
+    m_sink(m_x, m_y, m_buf, m_count, m_context);
+    m_x += m_count;
+    m_count = 0;
+  }
+}
+//------------------------------------------------------------------------------
+bool FatImage::openBmp(FatFile* file) {
+  // file header, BITMAPINFOHEADER and RGB bit masks
+  uint8_t hdr[66];
+  int n;
+  uint32_t comp;
+  int32_t w;
+  int32_t h;
+  uint16_t bits;
+
+  m_file = 0;
+  if (!file->seekSet(0)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  n = file->read(hdr, sizeof(hdr));
+  if (n < 54 || hdr[0] != 'B' || hdr[1] != 'M' || le32(hdr + 14) < 40 ||
+      le16(hdr + 26) != 1) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_offset = le32(hdr + 10);
+  w = le32(hdr + 18);
+  h = le32(hdr + 22);
+  bits = le16(hdr + 28);
+  comp = le32(hdr + 30);
+  m_bottomUp = h > 0;
+  if (h < 0) {
+    h = -h;
+  }
+  if (w <= 0 || w > 0XFFFF || h == 0 || h > 0XFFFF) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (bits == 24 && comp == 0) {
+    m_format = FMT_888;
+  } else if (bits == 16 && comp == 0) {
+    m_format = FMT_555;
+  } else if (bits == 16 && comp == 3 && n == 66) {
+    // BI_BITFIELDS, masks follow a BITMAPINFOHEADER or are in a V4/V5 header
+    uint32_t r = le32(hdr + 54);
+    uint32_t g = le32(hdr + 58);
+    uint32_t b = le32(hdr + 62);
+    if (r == 0XF800 && g == 0X7E0 && b == 0X1F) {
+      m_format = FMT_565;
+    } else if (r == 0X7C00 && g == 0X3E0 && b == 0X1F) {
+      m_format = FMT_555;
+    } else {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+  } else {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_width = w;
+  m_height = h;
+  m_bpp = bits/8;
+  // rows are padded to a multiple of four bytes
+  m_rowSize = ((uint32_t)m_width*m_bpp + 3) & ~3UL;
+  if (m_offset > file->fileSize() ||
+      (file->fileSize() - m_offset)/m_rowSize < m_height) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_file = file;
+  return true;
+
+fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+bool FatImage::openRaw(FatFile* file, uint16_t width, uint16_t height,
+                       uint32_t offset) {
+  m_file = 0;
+  if (width == 0 || height == 0 || offset > file->fileSize() ||
+      (file->fileSize() - offset)/(2UL*width) < height) {
+    DBG_FAIL_MACRO;
+    return false;
+  }
+  m_offset = offset;
+  m_width = width;
+  m_height = height;
+  m_format = FMT_565;
+  m_bpp = 2;
+  m_rowSize = 2UL*width;
+  m_bottomUp = false;
+  m_file = file;
+  return true;
+}
+//------------------------------------------------------------------------------
+// Convert a run of file data.  Runs may split pixels and rows anywhere.
+void FatImage::put(const uint8_t* data, size_t n) {
+  while (n) {
+    size_t k;
+    if (m_col < m_begin) {
+      // skip pixels left of the rectangle
+      k = m_begin - m_col;
+      if (k > n) {
+        k = n;
+      }
+    } else if (m_col < m_end) {
+      k = m_end - m_col;
+      if (k > n) {
+        k = n;
+      }
+      const uint8_t* src = data;
+      size_t m = k;
+      if (m_nCarry) {
+        // finish a pixel split by the last run
+        while (m && m_nCarry < m_bpp) {
+          m_carry[m_nCarry++] = *src++;
+          m--;
+        }
+        if (m_nCarry == m_bpp) {
+          m_buf[m_count++] = m_format == FMT_888 ? rgb888(m_carry) :
+                             m_format == FMT_555 ? rgb555(m_carry) :
+                             le16(m_carry);
+          m_nCarry = 0;
+          if (m_count == m_size) {
+            flush();
+          }
+        }
+      }
+      while (m >= m_bpp) {
+        uint16_t np = m_size - m_count;
+        if (np > m/m_bpp) {
+          np = m/m_bpp;
+        }
+        uint16_t* dst = m_buf + m_count;
+        uint16_t* end = dst + np;
+        if (m_format == FMT_888) {
+          for (; dst < end; src += 3) {
+            *dst++ = rgb888(src);
+          }
+        } else if (m_format == FMT_555) {
+          for (; dst < end; src += 2) {
+            *dst++ = rgb555(src);
+          }
+        } else {
+          for (; dst < end; src += 2) {
+            *dst++ = le16(src);
+          }
+        }
+        m -= (size_t)np*m_bpp;
+        m_count += np;
+        if (m_count == m_size) {
+          flush();
+        }
+      }
+      while (m) {
+        m_carry[m_nCarry++] = *src++;
+        m--;
+      }
+    } else {
+      // skip pixels right of the rectangle and padding
+      k = m_span - m_col;
+      if (k > n) {
+        k = n;
+      }
+    }
+    data += k;
+    n -= k;
+    m_col += k;
+    if (m_col == m_end) {
+      flush();
+    }
+    if (m_col == m_span) {
+      // next stored row
+      m_col = 0;
+      m_x = m_left;
+      m_y += m_bottomUp ? -1 : 1;
+    }
+  }
+}
+//------------------------------------------------------------------------------
+void FatImage::putSink(const uint8_t* data, size_t n, void* context) {
+  reinterpret_cast<FatImage*>(context)->put(data, n);
+}
+//------------------------------------------------------------------------------
+bool FatImage::readRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h,
+                        uint16_t* buf, uint16_t size, pixelSink_t sink,
+                        void* context) {
+  uint32_t pos;
+  uint32_t todo;
+  uint16_t first;
+  if (!m_file || !buf || size == 0 || w == 0 || h == 0 ||
+      x >= m_width || w > (m_width - x) ||
+      y >= m_height || h > (m_height - y)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_begin = (uint32_t)x*m_bpp;
+  m_end = m_begin + (uint32_t)w*m_bpp;
+  m_buf = buf;
+  m_size = size;
+  m_count = 0;
+  m_nCarry = 0;
+  m_col = 0;
+  m_left = x;
+  m_x = x;
+  m_sink = sink;
+  m_context = context;
+  // stored rows first to last
+  if (m_bottomUp) {
+    first = m_height - y - h;
+    m_y = y + h - 1;
+  } else {
+    first = y;
+    m_y = y;
+  }
+  pos = m_offset + first*m_rowSize;
+  if ((m_end - m_begin) < m_rowSize && h > 1) {
+    // read only the rectangle part of each row
+    m_span = m_end - m_begin;
+    pos += m_begin;
+    m_end -= m_begin;
+    m_begin = 0;
+    if (!m_file->readRows(pos, m_span, m_rowSize, h,
+                          putSink, this, m_gap)) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    return true;
+  }
+  m_span = m_rowSize;
+  if (!m_file->seekSet(pos)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  todo = h*m_rowSize;
+  while (todo) {
+    size_t n = todo < IMAGE_READ_MAX ? todo : IMAGE_READ_MAX;
+    if (m_file->read(putSink, this, n) != static_cast<int>(n)) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    todo -= n;
+  }
+  return true;
+
+fail:
+  return false;
+}
@@ -0,0 +1,168 @@
+/* FatLib Library
+ * Copyright (C) 2015 by William Greiman
+ *
+ * This file is part of the FatLib Library
+ *
+ * This Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the FatLib Library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#ifndef FatImage_h
+#define FatImage_h
+/**
+ * \file
+ * \brief FatImage class
+ */
+#include "FatFile.h"
+//------------------------------------------------------------------------------
+/** Type for a function that accepts RGB565 pixels from FatImage.
+ * The function is called with the column and row of the first pixel,
+ * a pointer to \a n pixels in one row and the context pointer supplied
+ * by the caller.
+ */
+typedef void (*pixelSink_t)(uint16_t x, uint16_t y,
+                            const uint16_t* pixel, uint16_t n, void* context);
+//------------------------------------------------------------------------------
+/**
+ * \class FatImage
+ * \brief Stream BMP or raw RGB565 image files as 16-bit pixels.
+ *
+ * The header is checked once by openBmp() or openRaw().  readRect()
+ * reads the stored rows that hold the rectangle with sink reads, so
+ * whole blocks come straight from the device.  Rows are
+ * passed in file order, bottom row first for a bottom-up BMP, and the
+ * row number is passed to the sink instead of seeking for each row.
+ *
+ * Pixels are native uint16_t RGB565 values.  24-bit BMP pixels are
+ * converted and 16-bit BMP pixels may be 565 or 555.  Raw files hold
+ * little-endian RGB565 pixels, top row first, without row padding.
+ */
+class FatImage {
+ public:
+  FatImage() : m_file(0), m_gap(0) {}
+  /** \return The image height in pixels. */
+  uint16_t height() const {
+    return m_height;
+  }
+  /** \return true if the bottom row is stored first. */
+  bool isBottomUp() const {
+    return m_bottomUp;
+  }
+  /** Check the header of a BMP file.
+   *
+   * Uncompressed 24-bit and 16-bit BMP files are supported.
+   *
+   * \param[in] file A file open for read.  The file must stay open while
+   * the image is used.
+   *
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool openBmp(FatFile* file);
+  /** Use a file of raw RGB565 pixels.
+   *
+   * \param[in] file A file open for read.
+   * \param[in] width Image width in pixels.
+   * \param[in] height Image height in pixels.
+   * \param[in] offset Position of the first pixel in the file.
+   *
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool openRaw(FatFile* file, uint16_t width, uint16_t height,
+               uint32_t offset = 0);
+  /** Read the whole image.
+   *
+   * \param[in] buf Pixel buffer.
+   * \param[in] size Number of pixels in \a buf.  Rows longer than
+   * \a size are passed to \a sink in pieces.
+   * \param[in] sink Function called with each run of pixels.
+   * \param[in] context Pointer passed to \a sink.
+   *
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool read(uint16_t* buf, uint16_t size, pixelSink_t sink, void* context) {
+    return readRect(0, 0, m_width, m_height, buf, size, sink, context);
+  }
+  /** Read a rectangle of the image.
+   *
+   * The stored rows that hold the rectangle are read in one pass.  If the
+   * rectangle is narrower than the image only the part of each row in
+   * the rectangle is read with FatFile::readRows(), so the time depends
+   * on the bytes in the rectangle.  Use an extent map or a contiguous
+   * file for large images so the seek for each row is fast.
+   *
+   * \param[in] x Column of the left edge.
+   * \param[in] y Row of the top edge, zero is the top row.
+   * \param[in] w Width of the rectangle.
+   * \param[in] h Height of the rectangle.
+   * \param[in] buf Pixel buffer.
+   * \param[in] size Number of pixels in \a buf.
+   * \param[in] sink Function called with each run of pixels.
+   * \param[in] context Pointer passed to \a sink.
+   *
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool readRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h,
+                uint16_t* buf, uint16_t size, pixelSink_t sink,
+                void* context);
+  /** Set the largest gap between rows, in blocks, that readRect()
+   * reads through to keep a multi-block read open.
+   *
+   * \param[in] gap Number of blocks, default zero.
+   */
+  void setReadGap(uint8_t gap) {
+    m_gap = gap;
+  }
+  /** \return The image width in pixels. */
+  uint16_t width() const {
+    return m_width;
+  }
+
+ private:
+  static const uint8_t FMT_565 = 0;  // little-endian RGB565
+  static const uint8_t FMT_555 = 1;  // little-endian RGB555
+  static const uint8_t FMT_888 = 2;  // BGR888
+
+  void flush();
+  void put(const uint8_t* data, size_t n);
+  static void putSink(const uint8_t* data, size_t n, void* context);
+
+  FatFile* m_file;      // image file, zero if not open
+  uint32_t m_offset;    // position of the first stored row
+  uint32_t m_rowSize;   // bytes in a stored row with padding
+  uint16_t m_width;     // image width
+  uint16_t m_height;    // image height
+  uint8_t m_format;     // FMT_565, FMT_555 or FMT_888
+  uint8_t m_bpp;        // bytes per pixel
+  bool m_bottomUp;      // bottom row is stored first
+  uint8_t m_gap;        // gap for FatFile::readRows()
+  // state for readRect()
+  uint32_t m_col;       // byte index in the current row data
+  uint32_t m_span;      // bytes of row data for each row
+  uint32_t m_begin;     // byte index of the first pixel in the rectangle
+  uint32_t m_end;       // byte index after the last pixel in the rectangle
+  uint16_t* m_buf;      // caller's pixel buffer
+  uint16_t m_size;      // pixels in m_buf
+  uint16_t m_count;     // pixels in m_buf waiting for the sink
+  uint16_t m_left;      // left column of the rectangle
+  uint16_t m_x;         // column of m_buf[0]
+  uint16_t m_y;         // current row
+  uint8_t m_carry[3];   // bytes of a pixel split between runs
+  uint8_t m_nCarry;     // bytes in m_carry
+  pixelSink_t m_sink;   // caller's sink
+  void* m_context;      // caller's sink context
+};
+#endif  // FatImage_h
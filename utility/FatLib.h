@@ -21,10 +21,15 @@
 #define FatLib_h
 #include "ArduinoFiles.h"
 #include "ArduinoStream.h"
+#include "FatDisk.h"
 #include "FatFileSystem.h"
 #include "FatLibConfig.h"
 #include "FatVolume.h"
 #include "FatFile.h"
+#include "FatImage.h"
+#include "FatLog.h"
+#include "FatMultiWriter.h"
+#include "FatReadAhead.h"
 #include "StdioStream.h"
 #include "fstream.h"
 //------------------------------------------------------------------------------
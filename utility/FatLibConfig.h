@@ -53,6 +53,13 @@
 #define USE_LONG_FILE_NAMES 1
 #endif  // USE_LONG_FILE_NAMES
 //------------------------------------------------------------------------------
+/**
+ * Size of the name field in FatDirInfo_t records.  Must be at least 13.
+ */
+#ifndef DIR_INFO_NAME_DIM
+#define DIR_INFO_NAME_DIM 13
+#endif  // DIR_INFO_NAME_DIM
+//------------------------------------------------------------------------------
 /** 
  * Set ARDUINO_FILE_USES_STREAM nonzero to use Stream as the base class
  * for the Arduino File class.  If ARDUINO_FILE_USES_STREAM is zero, Print
@@ -79,6 +86,162 @@
 #endif  // __arm__
 #endif  // USE_SEPARATE_FAT_CACHE
 //------------------------------------------------------------------------------
+/**
+ * Set CACHE_BLOCK_COUNT to the number of 512 byte blocks in the volume
+ * cache.  With more than one block the cache keeps the least recently
+ * used blocks so directory, FAT and small file reads do not evict each
+ * other.  FAT blocks use the separate FAT cache if USE_SEPARATE_FAT_CACHE
+ * is nonzero.
+ */
+#ifndef CACHE_BLOCK_COUNT
+#ifdef __arm__
+#define CACHE_BLOCK_COUNT 4
+#else  // __arm__
+#define CACHE_BLOCK_COUNT 1
+#endif  // __arm__
+#endif  // CACHE_BLOCK_COUNT
+//------------------------------------------------------------------------------
+/**
+ * Set ENABLE_CACHE_STATS nonzero to count cache hits, misses, writebacks
+ * and fatGet() calls.  Use FatVolume::cacheHitCount() and
+ * FatVolume::cacheMissCount() to choose CACHE_BLOCK_COUNT.
+ */
+#ifndef ENABLE_CACHE_STATS
+#define ENABLE_CACHE_STATS 0
+#endif  // ENABLE_CACHE_STATS
+//------------------------------------------------------------------------------
+/**
+ * Set USE_CACHE_STORE nonzero to allow FatVolume::setCacheStore() to keep
+ * recently used blocks in a second level cache such as serial SRAM.
+ */
+#ifndef USE_CACHE_STORE
+#define USE_CACHE_STORE 0
+#endif  // USE_CACHE_STORE
+//------------------------------------------------------------------------------
+/**
+ * Set USE_EXTENT_MAP nonzero to allow FatFile::setExtentMap() to map a
+ * file's cluster chain into a user supplied table.  Adds three to five
+ * bytes to each FatFile.
+ */
+#ifndef USE_EXTENT_MAP
+#if defined(RAMEND) && RAMEND < 3000
+#define USE_EXTENT_MAP 0
+#else  // RAMEND
+#define USE_EXTENT_MAP 1
+#endif  // RAMEND
+#endif  // USE_EXTENT_MAP
+//------------------------------------------------------------------------------
+/**
+ * Set MAINTAIN_FREE_CLUSTER_COUNT nonzero to keep a count of free
+ * clusters so FatVolume::freeClusterCount() only scans the FAT once.
+ * For FAT32 the count and next free cluster are read from the FSINFO
+ * sector at mount and written back by sync when they change.
+ */
+#ifndef MAINTAIN_FREE_CLUSTER_COUNT
+#define MAINTAIN_FREE_CLUSTER_COUNT 0
+#endif  // MAINTAIN_FREE_CLUSTER_COUNT
+//------------------------------------------------------------------------------
+/**
+ * Set USE_FREE_CLUSTER_BITMAP nonzero to allow
+ * FatVolume::setFreeClusterBitmap() to give cluster allocation a user
+ * supplied bitmap of free clusters.
+ */
+#ifndef USE_FREE_CLUSTER_BITMAP
+#define USE_FREE_CLUSTER_BITMAP 0
+#endif  // USE_FREE_CLUSTER_BITMAP
+//------------------------------------------------------------------------------
+/**
+ * Set USE_AU_ALLOC nonzero to allow FatVolume::setAllocUnit() to align
+ * cluster allocation to the device's allocation unit.
+ */
+#ifndef USE_AU_ALLOC
+#define USE_AU_ALLOC 0
+#endif  // USE_AU_ALLOC
+//------------------------------------------------------------------------------
+/**
+ * Set USE_DIR_HASH_INDEX nonzero to allow FatVolume::setDirHashIndex()
+ * to give open() a user supplied table of name hashes.
+ */
+#ifndef USE_DIR_HASH_INDEX
+#define USE_DIR_HASH_INDEX 0
+#endif  // USE_DIR_HASH_INDEX
+//------------------------------------------------------------------------------
+/**
+ * Set PATH_CACHE_SIZE to the number of resolved directory paths kept
+ * by each volume.  Zero disables the cache.
+ */
+#ifndef PATH_CACHE_SIZE
+#define PATH_CACHE_SIZE 0
+#endif  // PATH_CACHE_SIZE
+/** Longest directory path prefix kept in the path cache. */
+#ifndef PATH_CACHE_PATH_DIM
+#define PATH_CACHE_PATH_DIM 40
+#endif  // PATH_CACHE_PATH_DIM
+//------------------------------------------------------------------------------
+/**
+ * Set USE_WRITE_BUFFER nonzero to allow FatFile::setWriteBuffer() to
+ * combine small writes into whole block writes.
+ */
+#ifndef USE_WRITE_BUFFER
+#define USE_WRITE_BUFFER 0
+#endif  // USE_WRITE_BUFFER
+//------------------------------------------------------------------------------
+/**
+ * Set USE_FILE_PIN nonzero to allow FatFile::prefetch() to load a region
+ * of a file into a user supplied buffer.  read() then copies data in the
+ * region from the buffer.  Adds ten bytes to each FatFile.
+ */
+#ifndef USE_FILE_PIN
+#define USE_FILE_PIN 0
+#endif  // USE_FILE_PIN
+//------------------------------------------------------------------------------
+/**
+ * Set ENABLE_LAZY_SYNC nonzero to enable FatVolume::setLazySync() and
+ * FatFile::commit().
+ */
+#ifndef ENABLE_LAZY_SYNC
+#define ENABLE_LAZY_SYNC 0
+#endif  // ENABLE_LAZY_SYNC
+//------------------------------------------------------------------------------
+/**
+ * Set ENABLE_WARM_MOUNT nonzero to enable FatVolume::saveGeometry() and
+ * FatVolume::initWarm().
+ */
+#ifndef ENABLE_WARM_MOUNT
+#define ENABLE_WARM_MOUNT 0
+#endif  // ENABLE_WARM_MOUNT
+//------------------------------------------------------------------------------
+/**
+ * Set FAT_READ_ONLY nonzero to remove the write paths.
+ */
+#ifndef FAT_READ_ONLY
+#define FAT_READ_ONLY 0
+#endif  // FAT_READ_ONLY
+//------------------------------------------------------------------------------
+/**
+ * Set USE_APP_CACHE_BUFFER nonzero to use a cache buffer lent by the
+ * application, see FatVolume::setCacheBuffer().
+ */
+#ifndef USE_APP_CACHE_BUFFER
+#define USE_APP_CACHE_BUFFER 0
+#endif  // USE_APP_CACHE_BUFFER
+//------------------------------------------------------------------------------
+/**
+ * Set ENABLE_ERASE_TRIM nonzero to enable erase in
+ * FatFile::createContiguous() and FatVolume::setTrim().
+ */
+#ifndef ENABLE_ERASE_TRIM
+#define ENABLE_ERASE_TRIM 0
+#endif  // ENABLE_ERASE_TRIM
+//------------------------------------------------------------------------------
+/**
+ * Set ENABLE_ASYNC_READ nonzero to enable FatFile::readAsync().  The
+ * device reads blocks in the background if it supports async reads.
+ */
+#ifndef ENABLE_ASYNC_READ
+#define ENABLE_ASYNC_READ 0
+#endif  // ENABLE_ASYNC_READ
+//------------------------------------------------------------------------------
 /**
  * Set USE_MULTI_BLOCK_IO non-zero to use multi-block SD read/write.
  *
@@ -92,6 +255,17 @@
 #endif  // RAMEND
 #endif  // USE_MULTI_BLOCK_IO
 //------------------------------------------------------------------------------
+/**
+ * Set USE_FAT_SCAN_BUFFER nonzero to allow FatVolume::setFatScanBuffer().
+ * Requires USE_MULTI_BLOCK_IO.
+ */
+#ifndef USE_FAT_SCAN_BUFFER
+#define USE_FAT_SCAN_BUFFER 0
+#endif  // USE_FAT_SCAN_BUFFER
+#if USE_FAT_SCAN_BUFFER && !USE_MULTI_BLOCK_IO
+#error USE_FAT_SCAN_BUFFER requires USE_MULTI_BLOCK_IO
+#endif  // USE_FAT_SCAN_BUFFER && !USE_MULTI_BLOCK_IO
+//------------------------------------------------------------------------------
 /**
  * Set DESTRUCTOR_CLOSES_FILE non-zero to close a file in its destructor.
  *
@@ -101,6 +275,23 @@
 #define DESTRUCTOR_CLOSES_FILE 0
 #endif  // DESTRUCTOR_CLOSES_FILE
 //------------------------------------------------------------------------------
+/**
+ * Set ENABLE_LOCK_HOOKS nonzero to allow lock hooks for volumes and files.
+ */
+#ifndef ENABLE_LOCK_HOOKS
+#define ENABLE_LOCK_HOOKS 0
+#endif  // ENABLE_LOCK_HOOKS
+//------------------------------------------------------------------------------
+/**
+ * Size of the read window in fstream and ifstream, zero for none.
+ */
+#ifndef FSTREAM_READ_BUF_SIZE
+#define FSTREAM_READ_BUF_SIZE 0
+#endif  // FSTREAM_READ_BUF_SIZE
+#if FSTREAM_READ_BUF_SIZE > 255
+#error FSTREAM_READ_BUF_SIZE must be less than 256
+#endif  // FSTREAM_READ_BUF_SIZE > 255
+//------------------------------------------------------------------------------
 /**
  * Call flush for endl if ENDL_CALLS_FLUSH is non-zero
  *
@@ -0,0 +1,307 @@
+/* FatLib Library
+ * Copyright (C) 2015 by William Greiman
+ *
+ * This file is part of the FatLib Library
+ *
+ * This Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the FatLib Library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#include "FatLog.h"
+//------------------------------------------------------------------------------
+// Block header: magic, epoch, index, data length and CRC, little-endian.
+const uint8_t HDR_MAGIC = 0;
+const uint8_t HDR_EPOCH = 4;
+const uint8_t HDR_INDEX = 8;
+const uint8_t HDR_LEN = 12;
+const uint8_t HDR_CRC = 14;
+//------------------------------------------------------------------------------
+// CRC-CCITT, four bits at a time to keep the table small.
+#ifdef __AVR__
+static const uint16_t crcTable[16] PROGMEM = {
+#else  // __AVR__
+static const uint16_t crcTable[16] = {
+#endif  // __AVR__
+  0X0000, 0X1021, 0X2042, 0X3063, 0X4084, 0X50A5, 0X60C6, 0X70E7,
+  0X8108, 0X9129, 0XA14A, 0XB16B, 0XC18C, 0XD1AD, 0XE1CE, 0XF1EF
+};
+//------------------------------------------------------------------------------
+static uint16_t crcEntry(uint8_t i) {
+#ifdef __AVR__
+  return pgm_read_word(&crcTable[i]);
+#else  // __AVR__
+  return crcTable[i];
+#endif  // __AVR__
+}
+//------------------------------------------------------------------------------
+static uint16_t crcUpdate(uint16_t crc, const uint8_t* p, size_t n) {
+  while (n--) {
+    crc = (crc << 4) ^ crcEntry((crc >> 12) ^ (*p >> 4));
+    crc = (crc << 4) ^ crcEntry((crc >> 12) ^ (*p++ & 0XF));
+  }
+  return crc;
+}
+//------------------------------------------------------------------------------
+static uint32_t get32(const uint8_t* p) {
+  return p[0] | (uint16_t)p[1] << 8 | (uint32_t)p[2] << 16 |
+         (uint32_t)p[3] << 24;
+}
+//------------------------------------------------------------------------------
+static void put32(uint8_t* p, uint32_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+  p[2] = v >> 16;
+  p[3] = v >> 24;
+}
+//------------------------------------------------------------------------------
+bool FatLog::clear() {
+  if (!m_file) {
+    DBG_FAIL_MACRO;
+    return false;
+  }
+  if (m_stream) {
+    m_stream = false;
+    if (!m_file->writeStreamEnd()) {
+      DBG_FAIL_MACRO;
+      return false;
+    }
+  }
+  // Save the epoch first so a torn block zero can't bring back an old
+  // epoch.  An empty block zero drops the blocks of the old epoch.  The
+  // first data block is written over it.
+  m_epoch++;
+  m_count = 0;
+  m_len = 0;
+  if (!writeEpoch() || !writeBlock()) {
+    DBG_FAIL_MACRO;
+    return false;
+  }
+  m_count = 0;
+  return sync();
+}
+//------------------------------------------------------------------------------
+// Read block index and return its data length, -1 if the block is not
+// valid.  The epoch is not checked for block zero and the epoch block.
+int FatLog::load(uint32_t index, uint8_t* hdr, uint8_t* data) {
+  uint16_t len;
+  uint16_t crc;
+  if (m_stream) {
+    m_stream = false;
+    if (!m_file->writeStreamEnd()) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+  }
+  if (!m_file->seekSet(512*index) ||
+      m_file->read(hdr, HDR_SIZE) != HDR_SIZE) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  len = hdr[HDR_LEN] | hdr[HDR_LEN + 1] << 8;
+  if (get32(hdr + HDR_MAGIC) != LOG_MAGIC ||
+      get32(hdr + HDR_INDEX) != index || len > FAT_LOG_DATA_SIZE ||
+      m_file->read(data, len) != len) {
+    goto fail;
+  }
+  if (index != 0 && index != m_capacity &&
+      get32(hdr + HDR_EPOCH) != m_epoch) {
+    goto fail;
+  }
+  crc = crcUpdate(crcUpdate(0, hdr, HDR_CRC), data, len);
+  if (crc != (hdr[HDR_CRC] | hdr[HDR_CRC + 1] << 8)) {
+    goto fail;
+  }
+  return len;
+
+fail:
+  return -1;
+}
+//------------------------------------------------------------------------------
+bool FatLog::open(FatFile* file, uint8_t* buf) {
+  uint32_t bgn;
+  uint32_t end;
+  uint32_t lo;
+  uint32_t hi;
+  uint32_t saved;
+  int len;
+  m_file = 0;
+  m_buf = buf;
+  m_stream = false;
+  m_len = 0;
+  m_count = 0;
+  m_epoch = 0;
+  m_capacity = file->fileSize() >> 9;
+  if (!file->isFile() || m_capacity < 2 ||
+      !file->contiguousRange(&bgn, &end)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_capacity--;
+  m_file = file;
+  if (load(m_capacity, m_buf, m_buf + HDR_SIZE) == 0) {
+    saved = get32(m_buf + HDR_EPOCH);
+  } else {
+    // new log or the epoch block was torn
+    saved = 0;
+  }
+  len = load(0, m_buf, m_buf + HDR_SIZE);
+  if (get32(m_buf + HDR_MAGIC) == LOG_MAGIC &&
+      get32(m_buf + HDR_EPOCH) > saved) {
+    saved = get32(m_buf + HDR_EPOCH);
+  }
+  if (len < 0 || get32(m_buf + HDR_EPOCH) != saved) {
+    // Block zero is not valid or a clear() was interrupted after the epoch
+    // was saved.  Start an empty log with an epoch that was never used.
+    m_epoch = saved + 1;
+    if (!writeEpoch()) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    return true;
+  }
+  m_epoch = saved;
+  if (len == 0) {
+    // block zero has no data after clear()
+    return true;
+  }
+  // blocks before lo are valid, blocks at hi and after are not
+  lo = 1;
+  hi = m_capacity;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo)/2;
+    if (load(mid, m_buf, m_buf + HDR_SIZE) < 0) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  m_count = lo;
+  return true;
+
+fail:
+  m_file = 0;
+  return false;
+}
+//------------------------------------------------------------------------------
+int FatLog::read(uint32_t index, void* dst) {
+  uint8_t hdr[HDR_SIZE];
+  if (!m_file || index >= m_count) {
+    DBG_FAIL_MACRO;
+    return -1;
+  }
+  return load(index, hdr, reinterpret_cast<uint8_t*>(dst));
+}
+//------------------------------------------------------------------------------
+bool FatLog::sync() {
+  if (!m_file) {
+    DBG_FAIL_MACRO;
+    return false;
+  }
+  if (m_len && !writeBlock()) {
+    DBG_FAIL_MACRO;
+    return false;
+  }
+  if (m_stream) {
+    m_stream = false;
+    return m_file->writeStreamEnd();
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+int FatLog::write(const void* buf, size_t nbyte) {
+  const uint8_t* src = reinterpret_cast<const uint8_t*>(buf);
+  size_t todo = nbyte;
+  if (!m_file) {
+    DBG_FAIL_MACRO;
+    return -1;
+  }
+  while (todo) {
+    if (m_count >= m_capacity) {
+      DBG_FAIL_MACRO;
+      return -1;
+    }
+    size_t n = FAT_LOG_DATA_SIZE - m_len;
+    if (n > todo) {
+      n = todo;
+    }
+    memcpy(m_buf + HDR_SIZE + m_len, src, n);
+    m_len += n;
+    src += n;
+    todo -= n;
+    if (m_len == FAT_LOG_DATA_SIZE && !writeBlock()) {
+      DBG_FAIL_MACRO;
+      return -1;
+    }
+  }
+  return nbyte;
+}
+//------------------------------------------------------------------------------
+// Fill the header of the block in m_buf for block index.
+void FatLog::setHeader(uint32_t index) {
+  uint16_t crc;
+  put32(m_buf + HDR_MAGIC, LOG_MAGIC);
+  put32(m_buf + HDR_EPOCH, m_epoch);
+  put32(m_buf + HDR_INDEX, index);
+  m_buf[HDR_LEN] = m_len;
+  m_buf[HDR_LEN + 1] = m_len >> 8;
+  memset(m_buf + HDR_SIZE + m_len, 0, FAT_LOG_DATA_SIZE - m_len);
+  crc = crcUpdate(crcUpdate(0, m_buf, HDR_CRC), m_buf + HDR_SIZE, m_len);
+  m_buf[HDR_CRC] = crc;
+  m_buf[HDR_CRC + 1] = crc >> 8;
+}
+//------------------------------------------------------------------------------
+// Write the block in m_buf at m_count.
+bool FatLog::writeBlock() {
+  if (m_count >= m_capacity) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (!m_stream) {
+    if (!m_file->seekSet(512*m_count) || !m_file->writeStreamBegin()) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    m_stream = true;
+  }
+  setHeader(m_count);
+  if (m_file->write(m_buf, 512) != 512) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_count++;
+  m_len = 0;
+  return true;
+
+fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+// Save m_epoch in the epoch block.  The stream is ended so the block is on
+// the card before a block uses the epoch.  Discards data in m_buf.
+bool FatLog::writeEpoch() {
+  if (m_stream) {
+    m_stream = false;
+    if (!m_file->writeStreamEnd()) {
+      DBG_FAIL_MACRO;
+      return false;
+    }
+  }
+  m_len = 0;
+  setHeader(m_capacity);
+  if (!m_file->seekSet(512*m_capacity) || !m_file->writeStreamBegin() ||
+      m_file->write(m_buf, 512) != 512 || !m_file->writeStreamEnd()) {
+    DBG_FAIL_MACRO;
+    return false;
+  }
+  return true;
+}
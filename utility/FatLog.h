@@ -0,0 +1,138 @@
+/* FatLib Library
+ * Copyright (C) 2015 by William Greiman
+ *
+ * This file is part of the FatLib Library
+ *
+ * This Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the FatLib Library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#ifndef FatLog_h
+#define FatLog_h
+/**
+ * \file
+ * \brief FatLog class
+ */
+#include "FatFile.h"
+//------------------------------------------------------------------------------
+/** Bytes of data in a FatLog block. */
+const uint16_t FAT_LOG_DATA_SIZE = 496;
+//------------------------------------------------------------------------------
+/**
+ * \class FatLog
+ * \brief Power-fail safe append log in a preallocated contiguous file.
+ *
+ * Each 512 byte block of the file has a header with a magic number, the
+ * log epoch, the block index, the number of data bytes and a CRC.  Blocks
+ * are written in order with a write stream, so the file size and the
+ * directory entry are never updated.
+ *
+ * After a power failure open() finds the end of the log with a binary
+ * search of the block headers, so recovery takes about log2(blocks)
+ * reads.  Blocks that were written and acknowledged by the card are kept
+ * and a block that was being written is dropped.
+ *
+ * The last block of the file holds the newest epoch and is not part of
+ * the log.  It is written before any block uses a new epoch, so an epoch
+ * is never reused even if a rewrite of block zero is torn.  clear()
+ * starts a new epoch at block zero so blocks of the old log no longer
+ * match.
+ */
+class FatLog {
+ public:
+  FatLog() : m_file(0) {}
+  /** \return Number of complete blocks in the log. */
+  uint32_t blockCount() const {
+    return m_count;
+  }
+  /** \return The number of log blocks, one less than the blocks in the
+   * file.
+   */
+  uint32_t capacity() const {
+    return m_capacity;
+  }
+  /** Discard the log and start a new epoch at block zero.
+   *
+   * The new epoch is saved in the epoch block, then block zero is written
+   * with the new epoch and no data so open() finds an empty log.  The
+   * first data block is written over it.  If block zero is torn, open()
+   * finds an empty log with a newer epoch.
+   *
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool clear();
+  /** \return The epoch of the log. */
+  uint32_t epoch() const {
+    return m_epoch;
+  }
+  /** Open a log and find the last valid block.
+   *
+   * \param[in] file A file open for read and write.  Create the file with
+   * createContiguous() so writes never allocate clusters.  The file must
+   * have at least two blocks and stay open while the log is used.  A new
+   * epoch is saved if the log is new or was not found.
+   *
+   * \param[in] buf Block buffer of 512 bytes.  Must stay valid while the
+   * log is used.
+   *
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool open(FatFile* file, uint8_t* buf);
+  /** Read data from a block of the log.
+   *
+   * Ends the write stream, the next write() starts a new one.
+   *
+   * \param[in] index Block index less than blockCount().
+   * \param[out] dst Location for up to FAT_LOG_DATA_SIZE bytes.
+   *
+   * \return The number of data bytes or -1 if an error occurs.
+   */
+  int read(uint32_t index, void* dst);
+  /** Write any partial block and end the write stream.
+   *
+   * The next write() starts a new block, so frequent calls waste space.
+   *
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool sync();
+  /** Append data to the log.  Full blocks are written at once.
+   *
+   * \param[in] buf Data to append.
+   * \param[in] nbyte Number of bytes to append.
+   *
+   * \return The number of bytes written or -1 if an error occurs or the
+   * file is full.
+   */
+  int write(const void* buf, size_t nbyte);
+
+ private:
+  static const uint32_t LOG_MAGIC = 0X474F4C46;  // "FLOG"
+  static const uint8_t HDR_SIZE = 512 - FAT_LOG_DATA_SIZE;
+
+  int load(uint32_t index, uint8_t* hdr, uint8_t* data);
+  void setHeader(uint32_t index);
+  bool writeBlock();
+  bool writeEpoch();
+
+  FatFile* m_file;      // log file, zero if not open
+  uint8_t* m_buf;       // caller's block buffer
+  uint32_t m_capacity;  // log blocks, the epoch block is at m_capacity
+  uint32_t m_count;     // blocks written
+  uint32_t m_epoch;     // epoch of this log
+  uint16_t m_len;       // data bytes in m_buf
+  bool m_stream;        // write stream is open
+};
+#endif  // FatLog_h
@@ -0,0 +1,227 @@
+/* FatLib Library
+ * Copyright (C) 2015 by William Greiman
+ *
+ * This file is part of the FatLib Library
+ *
+ * This Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the FatLib Library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#include "FatMultiWriter.h"
+//------------------------------------------------------------------------------
+int FatMultiWriter::add(FatFile* file) {
+  uint32_t bgn;
+  uint32_t end;
+  channel_t* c;
+  if (!m_pool || m_count >= FAT_MULTI_WRITER_FILES || !file->isFile() ||
+      (file->fileSize() >> 9) == 0 || !file->contiguousRange(&bgn, &end)) {
+    DBG_FAIL_MACRO;
+    return -1;
+  }
+  c = &m_ch[m_count];
+  c->file = file;
+  c->bgn = bgn;
+  c->blocks = file->fileSize() >> 9;
+  c->next = 0;
+  c->len = 0;
+  c->slot = NO_SLOT;
+  return m_count++;
+}
+//------------------------------------------------------------------------------
+// Take a free slot for channel ch.  Return NO_SLOT if the pool is full.
+uint8_t FatMultiWriter::allocSlot(uint8_t ch) {
+  for (uint8_t i = 0; i < m_poolBlocks; i++) {
+    if (!(m_used & (1UL << i))) {
+      m_used |= 1UL << i;
+      m_owner[i] = ch;
+      return i;
+    }
+  }
+  return NO_SLOT;
+}
+//------------------------------------------------------------------------------
+bool FatMultiWriter::begin(uint8_t* pool, uint8_t poolBlocks,
+                           uint8_t flushBlocks, uint16_t flushMillis) {
+  m_pool = 0;
+  m_count = 0;
+  m_used = 0;
+  m_pending = 0;
+  m_timing = false;
+  if (!pool || poolBlocks == 0 || poolBlocks > FAT_MULTI_WRITER_BLOCKS ||
+      flushBlocks == 0) {
+    DBG_FAIL_MACRO;
+    return false;
+  }
+  m_pool = pool;
+  m_poolBlocks = poolBlocks;
+  m_flushBlocks = flushBlocks;
+  m_flushMillis = flushMillis;
+  return true;
+}
+//------------------------------------------------------------------------------
+bool FatMultiWriter::close() {
+  if (!sync()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  for (uint8_t i = 0; i < m_count; i++) {
+    if (!m_ch[i].file->truncate(dataSize(i)) || !m_ch[i].file->sync()) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+  }
+  m_count = 0;
+  m_used = 0;
+  return true;
+
+fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+bool FatMultiWriter::flush() {
+  uint8_t i;
+  uint8_t prev = NO_SLOT;
+  // sort by block so each file's blocks form one write sequence
+  for (i = 1; i < m_pending; i++) {
+    uint8_t slot = m_waiting[i];
+    uint8_t j = i;
+    for (; j > 0 && m_block[m_waiting[j - 1]] > m_block[slot]; j--) {
+      m_waiting[j] = m_waiting[j - 1];
+    }
+    m_waiting[j] = slot;
+  }
+  for (i = 0; i < m_pending; i++) {
+    if (!writeSlot(m_waiting[i], prev)) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    prev = m_waiting[i];
+  }
+  for (i = 0; i < m_pending; i++) {
+    m_used &= ~(1UL << m_waiting[i]);
+  }
+  m_pending = 0;
+  m_timing = false;
+  for (i = 0; i < m_count; i++) {
+    if (!m_ch[i].file->writeStreamEnd()) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+  }
+  return true;
+
+fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+bool FatMultiWriter::poll(uint32_t now) {
+  if (m_pending == 0 || m_flushMillis == 0) {
+    return true;
+  }
+  if (!m_timing) {
+    m_timing = true;
+    m_pendingTime = now;
+    return true;
+  }
+  return (now - m_pendingTime) < m_flushMillis || flush();
+}
+//------------------------------------------------------------------------------
+bool FatMultiWriter::sync() {
+  if (!flush()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  for (uint8_t i = 0; i < m_count; i++) {
+    channel_t* c = &m_ch[i];
+    if (c->len) {
+      uint8_t* dst = slotData(c->slot);
+      memset(dst + c->len, 0, 512 - c->len);
+      if (!c->file->seekSet(512*c->next) ||
+          c->file->write(dst, 512) != 512) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+    }
+    if (!c->file->sync()) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+  }
+  return true;
+
+fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+int FatMultiWriter::write(uint8_t ch, const void* buf, size_t nbyte) {
+  const uint8_t* src = reinterpret_cast<const uint8_t*>(buf);
+  size_t todo = nbyte;
+  channel_t* c;
+  if (ch >= m_count) {
+    DBG_FAIL_MACRO;
+    return -1;
+  }
+  c = &m_ch[ch];
+  while (todo) {
+    if (c->next >= c->blocks) {
+      DBG_FAIL_MACRO;
+      return -1;
+    }
+    if (c->slot == NO_SLOT) {
+      c->slot = allocSlot(ch);
+      if (c->slot == NO_SLOT) {
+        // pool is full, write waiting blocks to free slots
+        if (!flush() || (c->slot = allocSlot(ch)) == NO_SLOT) {
+          DBG_FAIL_MACRO;
+          return -1;
+        }
+      }
+    }
+    size_t n = 512 - c->len;
+    if (n > todo) {
+      n = todo;
+    }
+    memcpy(slotData(c->slot) + c->len, src, n);
+    c->len += n;
+    src += n;
+    todo -= n;
+    if (c->len == 512) {
+      m_block[c->slot] = c->bgn + c->next;
+      m_waiting[m_pending++] = c->slot;
+      c->slot = NO_SLOT;
+      c->len = 0;
+      c->next++;
+      if (m_pending >= m_flushBlocks && !flush()) {
+        DBG_FAIL_MACRO;
+        return -1;
+      }
+    }
+  }
+  return nbyte;
+}
+//------------------------------------------------------------------------------
+// Write a full slot at its block with the file's write stream.  The stream
+// stays open if the slot follows prev, the slot written before it, in the
+// same file.
+bool FatMultiWriter::writeSlot(uint8_t slot, uint8_t prev) {
+  channel_t* c = &m_ch[m_owner[slot]];
+  if (prev == NO_SLOT || m_owner[prev] != m_owner[slot] ||
+      m_block[prev] + 1 != m_block[slot]) {
+    if (!c->file->seekSet(512*(m_block[slot] - c->bgn)) ||
+        !c->file->writeStreamBegin()) {
+      DBG_FAIL_MACRO;
+      return false;
+    }
+  }
+  return c->file->write(slotData(slot), 512) == 512;
+}
@@ -0,0 +1,160 @@
+/* FatLib Library
+ * Copyright (C) 2015 by William Greiman
+ *
+ * This file is part of the FatLib Library
+ *
+ * This Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the FatLib Library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#ifndef FatMultiWriter_h
+#define FatMultiWriter_h
+/**
+ * \file
+ * \brief FatMultiWriter class
+ */
+#include "FatFile.h"
+//------------------------------------------------------------------------------
+/** Maximum number of files in a FatMultiWriter. */
+const uint8_t FAT_MULTI_WRITER_FILES = 8;
+/** Maximum number of 512 byte blocks in a FatMultiWriter pool. */
+const uint8_t FAT_MULTI_WRITER_BLOCKS = 32;
+//------------------------------------------------------------------------------
+/**
+ * \class FatMultiWriter
+ * \brief Interleaved writer for several preallocated contiguous files.
+ *
+ * Data for each file is collected in 512 byte blocks from a pool supplied
+ * by the caller.  Full blocks wait in the pool until the flush budget is
+ * reached, then all waiting blocks are written in order of block number
+ * with a write stream.  Blocks of one file are adjacent on the volume so
+ * each file is written with a single multi-block sequence per flush and
+ * the volume cache is not used for data.
+ *
+ * Files are written from the start and must not have a write buffer.
+ */
+class FatMultiWriter {
+ public:
+  FatMultiWriter() : m_pool(0), m_count(0) {}
+  /** Add a file to the writer.
+   *
+   * \param[in] file A file open for read and write.  Create the file with
+   * createContiguous() so writes never allocate clusters.  The file must
+   * stay open while the writer is used.
+   *
+   * \return The channel number for write() or -1 if an error occurs.
+   */
+  int add(FatFile* file);
+  /** Start a writer with no files.
+   *
+   * \param[in] pool Buffer of 512*poolBlocks bytes.  Must stay valid while
+   * the writer is used.
+   * \param[in] poolBlocks Number of blocks in pool, at most
+   * FAT_MULTI_WRITER_BLOCKS.  Each file keeps one block for data being
+   * collected, so use several blocks more than the number of files.
+   * \param[in] flushBlocks Flush when this many full blocks are waiting.
+   * \param[in] flushMillis Flush when full blocks have waited this long,
+   * see poll().  Zero disables the time budget.
+   *
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool begin(uint8_t* pool, uint8_t poolBlocks,
+             uint8_t flushBlocks, uint16_t flushMillis = 0);
+  /** Write all files, truncate each file to its data and remove the files
+   * from the writer.  The files are not closed.
+   *
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool close();
+  /** \param[in] ch Channel number.
+   * \return Number of bytes written to the channel.
+   */
+  uint32_t dataSize(uint8_t ch) const {
+    return ch < m_count ? 512*m_ch[ch].next + m_ch[ch].len : 0;
+  }
+  /** \return Number of files in the writer. */
+  uint8_t fileCount() const {
+    return m_count;
+  }
+  /** Write all full blocks that are waiting.
+   *
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool flush();
+  /** \return Number of full blocks waiting to be written. */
+  uint8_t pendingBlocks() const {
+    return m_pending;
+  }
+  /** Check the time budget.  Call often with a millisecond clock.
+   *
+   * The budget starts at the first call that finds full blocks waiting,
+   * so blocks may wait up to flushMillis plus the time between calls.
+   *
+   * \param[in] now Milliseconds, for example from millis().
+   *
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool poll(uint32_t now);
+  /** Write full blocks and the partial block of each file and sync the
+   * files.  A partial block is written again when more data arrives.
+   *
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool sync();
+  /** Append data to a file.
+   *
+   * \param[in] ch Channel number returned by add().
+   * \param[in] buf Data to append.
+   * \param[in] nbyte Number of bytes to append.
+   *
+   * \return The number of bytes written or -1 if an error occurs or the
+   * file is full.
+   */
+  int write(uint8_t ch, const void* buf, size_t nbyte);
+
+ private:
+  static const uint8_t NO_SLOT = 0XFF;
+  struct channel_t {
+    FatFile* file;    // contiguous file
+    uint32_t bgn;     // first block of file
+    uint32_t blocks;  // blocks in the file
+    uint32_t next;    // file block index of the collecting slot
+    uint16_t len;     // data bytes in the collecting slot
+    uint8_t slot;     // collecting slot or NO_SLOT
+  };
+  uint8_t* slotData(uint8_t slot) {
+    return m_pool + 512*slot;
+  }
+  uint8_t allocSlot(uint8_t ch);
+  bool writeSlot(uint8_t slot, uint8_t prev);
+
+  uint8_t* m_pool;           // caller's pool of blocks
+  uint32_t m_used;           // bit map of slots in use
+  uint32_t m_pendingTime;    // time of first poll() with blocks waiting
+  uint16_t m_flushMillis;    // time budget, zero for none
+  uint8_t m_poolBlocks;      // slots in the pool
+  uint8_t m_flushBlocks;     // size budget in blocks
+  uint8_t m_count;           // files in the writer
+  uint8_t m_pending;         // full blocks waiting
+  bool m_timing;             // m_pendingTime is valid
+  channel_t m_ch[FAT_MULTI_WRITER_FILES];           // file state
+  uint32_t m_block[FAT_MULTI_WRITER_BLOCKS];        // volume block of slot
+  uint8_t m_owner[FAT_MULTI_WRITER_BLOCKS];         // channel of slot
+  uint8_t m_waiting[FAT_MULTI_WRITER_BLOCKS];       // full slots to write
+};
+#endif  // FatMultiWriter_h
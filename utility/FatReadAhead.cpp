@@ -0,0 +1,158 @@
+/* FatLib Library
+ * Copyright (C) 2015 by William Greiman
+ *
+ * This file is part of the FatLib Library
+ *
+ * This Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the FatLib Library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#include "FatReadAhead.h"
+#if ENABLE_ASYNC_READ
+//------------------------------------------------------------------------------
+bool FatReadAhead::begin(FatFile* file, void* buf, uint8_t count) {
+  if (m_file || !file->isFile() || count < 2) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_file = file;
+  m_buf = reinterpret_cast<uint8_t*>(buf);
+  m_count = count;
+  m_busy = false;
+  if (!seekSet(file->curPosition())) {
+    DBG_FAIL_MACRO;
+    m_file = 0;
+    goto fail;
+  }
+  return true;
+
+fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+bool FatReadAhead::end() {
+  bool rtn;
+  if (!m_file) {
+    return false;
+  }
+  rtn = wait() && m_file->seekSet(m_pos);
+  m_file = 0;
+  return rtn;
+}
+//------------------------------------------------------------------------------
+bool FatReadAhead::fill() {
+  if (m_busy) {
+    int8_t status = m_file->readAsyncStatus();
+    if (status == 0) {
+      return true;
+    }
+    m_busy = false;
+    if (status < 0) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    m_ready++;
+  }
+  if (m_ready < m_count && m_file->curPosition() < m_file->fileSize()) {
+    uint8_t i = (m_head + m_ready) % m_count;
+    if (m_file->readAsync(m_buf + 512*i, 512) <= 0) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    m_busy = true;
+  }
+  return true;
+
+fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+int FatReadAhead::read(void* buf, size_t nbyte) {
+  uint8_t* dst = reinterpret_cast<uint8_t*>(buf);
+  size_t toRead;
+  if (!m_file) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (nbyte > available()) {
+    nbyte = available();
+  }
+  toRead = nbyte;
+  while (toRead) {
+    if (!fill()) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    if (m_ready == 0) {
+      // consumer has caught up with the device
+      continue;
+    }
+    uint16_t offset = m_pos & 0X1FF;
+    size_t n = 512 - offset;
+    if (n > toRead) {
+      n = toRead;
+    }
+    memcpy(dst, m_buf + 512*m_head + offset, n);
+    dst += n;
+    m_pos += n;
+    toRead -= n;
+    if ((m_pos & 0X1FF) == 0) {
+      // buffer consumed, recycle it
+      m_head = m_head + 1 < m_count ? m_head + 1 : 0;
+      m_ready--;
+    }
+  }
+  // keep the pipeline running while the caller processes the data
+  if (!fill()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  return nbyte;
+
+fail:
+  return -1;
+}
+//------------------------------------------------------------------------------
+bool FatReadAhead::seekSet(uint32_t pos) {
+  if (!m_file || pos > m_file->fileSize() || !wait()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_head = 0;
+  m_ready = 0;
+  if (!m_file->seekSet(pos & ~0X1FFUL)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_pos = pos;
+  return fill();
+
+fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+bool FatReadAhead::wait() {
+  while (m_busy) {
+    int8_t status = m_file->readAsyncStatus();
+    if (status < 0) {
+      m_busy = false;
+      return false;
+    }
+    if (status > 0) {
+      m_busy = false;
+      m_ready++;
+    }
+  }
+  return true;
+}
+#endif  // ENABLE_ASYNC_READ
@@ -0,0 +1,110 @@
+/* FatLib Library
+ * Copyright (C) 2015 by William Greiman
+ *
+ * This file is part of the FatLib Library
+ *
+ * This Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the FatLib Library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#ifndef FatReadAhead_h
+#define FatReadAhead_h
+/**
+ * \file
+ * \brief FatReadAhead class
+ */
+#include "FatFile.h"
+#if ENABLE_ASYNC_READ
+//------------------------------------------------------------------------------
+/**
+ * \class FatReadAhead
+ * \brief Sequential file reader that keeps the next blocks in flight.
+ *
+ * The blocks following the current position are read into a ring of
+ * 512 byte buffers with readAsync() while the caller consumes data
+ * from the oldest buffer.  The file must not be accessed directly
+ * between begin() and end().
+ */
+class FatReadAhead {
+ public:
+  FatReadAhead() : m_file(0) {}
+  /** Start read-ahead at the current position of a file.
+   *
+   * \param[in] file An open file.
+   *
+   * \param[in] buf Buffer space of \a count times 512 bytes.
+   *
+   * \param[in] count Number of 512 byte buffers, at least two.
+   *
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool begin(FatFile* file, void* buf, uint8_t count);
+  /** Wait for the pending read and leave the file positioned at the
+   * next byte to be consumed.
+   *
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool end();
+  /** \return The number of bytes between the current position and
+   * the end of the file.
+   */
+  uint32_t available() {
+    return m_file ? m_file->fileSize() - m_pos : 0;
+  }
+  /** \return The current position for the reader. */
+  uint32_t curPosition() const {
+    return m_pos;
+  }
+  /** Read the next byte.
+   *
+   * \return For success the byte is returned, -1 is returned at end
+   * of file or if an error occurs.
+   */
+  int read() {
+    uint8_t b;
+    return read(&b, 1) == 1 ? b : -1;
+  }
+  /** Read data.
+   *
+   * \param[out] buf Pointer to the location that will receive the data.
+   *
+   * \param[in] nbyte Maximum number of bytes to read.
+   *
+   * \return The number of bytes read or -1 if an error occurs.
+   */
+  int read(void* buf, size_t nbyte);
+  /** Cancel read-ahead and restart it at a new position.
+   *
+   * \param[in] pos The new position in bytes from the beginning of the file.
+   *
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool seekSet(uint32_t pos);
+
+ private:
+  bool fill();
+  bool wait();
+
+  FatFile* m_file;  // file being read, zero if idle
+  uint8_t* m_buf;   // ring of m_count blocks
+  uint8_t m_count;  // number of blocks in ring
+  uint8_t m_head;   // index of block that holds m_pos
+  uint8_t m_ready;  // number of blocks with data
+  bool m_busy;      // block after the ready blocks is in flight
+  uint32_t m_pos;   // position of next byte for caller
+};
+#endif  // ENABLE_ASYNC_READ
+#endif  // FatReadAhead_h
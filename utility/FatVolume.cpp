@@ -21,13 +21,35 @@
 #include "FatVolume.h"
 //------------------------------------------------------------------------------
 cache_t* FatCache::read(uint32_t lbn, uint8_t option) {
+#if USE_APP_CACHE_BUFFER
+  if (!m_block) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+#endif  // USE_APP_CACHE_BUFFER
+#if FAT_READ_ONLY
+  // There are no write paths so a fetch for write is an error.
+  if (option & CACHE_STATUS_DIRTY) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (m_lbn != lbn) {
+    m_lbn = 0XFFFFFFFF;
+    if (!m_vol->storeRead(lbn, block()->data)) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    m_lbn = lbn;
+  }
+  return block();
+#else  // FAT_READ_ONLY
   if (m_lbn != lbn) {
     if (!sync()) {
       DBG_FAIL_MACRO;
       goto fail;
     }
     if (!(option & CACHE_OPTION_NO_READ)) {
-      if (!m_vol->readBlock(lbn, m_block.data)) {
+      if (!m_vol->storeRead(lbn, block()->data)) {
         DBG_FAIL_MACRO;
         goto fail;
       }
@@ -36,25 +58,40 @@ cache_t* FatCache::read(uint32_t lbn, uint8_t option) {
     m_lbn = lbn;
   }
   m_status |= option & CACHE_STATUS_MASK;
-  return &m_block;
+  return block();
+#endif  // FAT_READ_ONLY
 
 fail:
   return 0;
 }
 //------------------------------------------------------------------------------
+#if !FAT_READ_ONLY
 bool FatCache::sync() {
   if (m_status & CACHE_STATUS_DIRTY) {
-    if (!m_vol->writeBlock(m_lbn, m_block.data)) {
+#if ENABLE_CACHE_STATS
+    m_vol->m_cacheWritebacks++;
+#endif  // ENABLE_CACHE_STATS
+    if (!m_vol->writeBlock(m_lbn, block()->data)) {
       DBG_FAIL_MACRO;
       goto fail;
     }
+    m_vol->storeUpdate(m_lbn, block()->data);
     // mirror second FAT
     if (m_status & CACHE_STATUS_MIRROR_FAT) {
+#if ENABLE_LAZY_SYNC
+      if (m_vol->m_lazySync) {
+        // Copied to the second FAT by FatVolume::commit().
+        m_vol->fatMirrorDefer(m_lbn);
+        m_status &= ~CACHE_STATUS_DIRTY;
+        return true;
+      }
+#endif  // ENABLE_LAZY_SYNC
       uint32_t lbn = m_lbn + m_vol->blocksPerFat();
-      if (!m_vol->writeBlock(lbn, m_block.data)) {
+      if (!m_vol->writeBlock(lbn, block()->data)) {
         DBG_FAIL_MACRO;
         goto fail;
       }
+      m_vol->storeUpdate(lbn, block()->data);
     }
     m_status &= ~CACHE_STATUS_DIRTY;
   }
@@ -64,35 +101,76 @@ fail:
   return false;
 }
 //------------------------------------------------------------------------------
-bool FatVolume::allocateCluster(uint32_t current, uint32_t* next) {
+bool FatVolume::allocateCluster(uint32_t current, uint32_t* next,
+                                bool stream) {
   uint32_t find = current ? current : m_allocSearchStart;
   uint32_t start = find;
+#if USE_AU_ALLOC
+  // Other allocations skip the free clusters in the AU of the last stream.
+  bool skip = m_auClusters && m_auReserve && !stream;
+  if (m_auClusters && stream && current) {
+    // Grow into the next cluster or start a free AU.
+    int8_t fg = current < m_lastCluster ? fatIsFree(current + 1) : 0;
+    if (fg > 0) {
+      find = current + 1;
+    } else if (fg == 0) {
+      fg = auFind(m_auClusters, &find);
+      if (fg > 0) {
+        m_auSearchStart = find + m_auClusters;
+      }
+    }
+    if (fg < 0) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    if (fg) {
+      m_auReserve = auFloor(find);
+      goto found;
+    }
+  }
+#endif  // USE_AU_ALLOC
   while (1) {
     find++;
     // If at end of FAT go to beginning of FAT.
     if (find > m_lastCluster) {
       find = 2;
     }
-    uint32_t f;
-    int8_t fg = fatGet(find, &f);
+    int8_t fg = fatIsFree(find);
     if (fg < 0) {
       DBG_FAIL_MACRO;
       goto fail;
     }
-    if (fg && f == 0) {
+#if USE_AU_ALLOC
+    if (skip && (find - m_auReserve) < m_auClusters) {
+      fg = 0;
+    }
+#endif  // USE_AU_ALLOC
+    if (fg) {
       break;
     }
     if (find == start) {
+#if USE_AU_ALLOC
+      if (skip) {
+        // Use the reserved AU if no other cluster is free.
+        skip = false;
+        continue;
+      }
+#endif  // USE_AU_ALLOC
       // Can't find space checked all clusters.
       DBG_FAIL_MACRO;
       goto fail;
     }
   }
+#if USE_AU_ALLOC
+
+found:
+#endif  // USE_AU_ALLOC
   // mark end of chain
   if (!fatPutEOC(find)) {
     DBG_FAIL_MACRO;
     goto fail;
   }
+  updateFreeClusterCount(-1);
   if (current) {
     // link clusters
     if (!fatPut(current, find)) {
@@ -114,6 +192,8 @@ fail:
 bool FatVolume::allocContiguous(uint32_t count, uint32_t* firstCluster) {
   // flag to save place to start next search
   bool setStart = true;
+  // flag set when the search has passed the end of the FAT
+  bool wrapped = false;
   // start of group
   uint32_t bgnCluster;
   // end of group
@@ -121,48 +201,81 @@ bool FatVolume::allocContiguous(uint32_t count, uint32_t* firstCluster) {
   // Start at cluster after last allocated cluster.
   uint32_t startCluster = m_allocSearchStart;
   endCluster = bgnCluster = startCluster + 1;
+#if USE_AU_ALLOC
+  if (m_auClusters) {
+    // Start at an AU boundary, use any free clusters if no AU is free.
+    int8_t fg = auFind(count, &bgnCluster);
+    if (fg < 0) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    if (fg) {
+      endCluster = bgnCluster + count - 1;
+      m_auSearchStart = endCluster + 1;
+      goto found;
+    }
+  }
+#endif  // USE_AU_ALLOC
 
-  // search the FAT for free clusters
+  // search the FAT for free clusters a run at a time
+  fatScan(true);
   while (1) {
+    uint32_t n;
+    bool last = false;
     // If past end - start from beginning of FAT.
     if (endCluster > m_lastCluster) {
+      if (wrapped) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      wrapped = true;
       bgnCluster = endCluster = 2;
     }
-    uint32_t f;
-    int8_t fg = fatGet(endCluster, &f);
+    int8_t fg = fatRun(endCluster, &n);
     if (fg < 0) {
       DBG_FAIL_MACRO;
       goto fail;
     }
-    if (f || fg == 0) {
-      // cluster in use try next cluster as bgnCluster
-      bgnCluster = endCluster + 1;
-
+    // Stop at startCluster, all clusters have been checked.
+    if (startCluster >= endCluster && (startCluster - endCluster) < n) {
+      n = startCluster - endCluster + 1;
+      last = true;
+    }
+    if (!fg) {
       // don't update search start if unallocated clusters before endCluster.
       if (bgnCluster != endCluster) {
         setStart = false;
       }
-    } else if ((endCluster - bgnCluster + 1) == count) {
+      // clusters in use try next cluster after run as bgnCluster
+      bgnCluster = endCluster + n;
+    } else if ((endCluster + n - bgnCluster) >= count) {
       // done - found space
+      endCluster = bgnCluster + count - 1;
       break;
     }
     // Can't find space if all clusters checked.
-    if (startCluster == endCluster) {
+    if (last) {
       DBG_FAIL_MACRO;
       goto fail;
     }
-    endCluster++;
+    endCluster += n;
   }
+  fatScan(false);
   // remember possible next free cluster
   if (setStart) {
     m_allocSearchStart = endCluster + 1;
   }
+#if USE_AU_ALLOC
+
+found:
+#endif  // USE_AU_ALLOC
 
   // mark end of chain
   if (!fatPutEOC(endCluster)) {
     DBG_FAIL_MACRO;
     goto fail;
   }
+  updateFreeClusterCount(-(int32_t)count);
   // link clusters
   while (endCluster > bgnCluster) {
     if (!fatPut(endCluster - 1, endCluster)) {
@@ -176,8 +289,108 @@ bool FatVolume::allocContiguous(uint32_t count, uint32_t* firstCluster) {
   return true;
 
 fail:
+  fatScan(false);
   return false;
 }
+#if USE_AU_ALLOC
+//------------------------------------------------------------------------------
+// Find count free clusters that start at an AU boundary.
+// Return -1 for error, zero if not found or one if found.
+int8_t FatVolume::auFind(uint32_t count, uint32_t* firstCluster) {
+  uint32_t start = auCeil(m_auSearchStart);
+  uint32_t bgn = start;
+  bool wrapped = false;
+  int8_t rtn = 0;
+
+  fatScan(true);
+  while (1) {
+    // If the group does not fit start from beginning of FAT.
+    if (bgn > m_lastCluster || (m_lastCluster - bgn) < (count - 1)) {
+      if (wrapped) {
+        break;
+      }
+      wrapped = true;
+      bgn = m_auBase;
+      continue;
+    }
+    if (wrapped && bgn >= start) {
+      break;
+    }
+    uint32_t cluster = bgn;
+    uint32_t n = 0;
+    int8_t fg = 1;
+    while ((cluster - bgn) < count) {
+      fg = fatRun(cluster, &n);
+      if (fg < 0) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      if (!fg) {
+        break;
+      }
+      cluster += n;
+    }
+    if (fg) {
+      *firstCluster = bgn;
+      rtn = 1;
+      break;
+    }
+    // Try the first AU after the clusters in use.
+    bgn = auCeil(cluster + n);
+  }
+  fatScan(false);
+  return rtn;
+
+fail:
+  fatScan(false);
+  return -1;
+}
+#endif  // USE_AU_ALLOC
+#endif  // !FAT_READ_ONLY
+#if USE_AU_ALLOC
+//------------------------------------------------------------------------------
+void FatVolume::setAllocUnit(uint32_t blocks) {
+  uint32_t offset;
+  m_auClusters = blocks >> m_clusterSizeShift;
+  if (!m_fatType || m_auClusters < 2 || (blocks & (blocks - 1))) {
+    m_auClusters = 0;
+    return;
+  }
+  // Blocks from the start of cluster two to the first AU boundary.
+  offset = (0 - m_dataStartBlock) & (blocks - 1);
+  m_auBase = 2 + ((offset + m_blocksPerCluster - 1) >> m_clusterSizeShift);
+  m_auSearchStart = m_auBase;
+  m_auReserve = 0;
+}
+#endif  // USE_AU_ALLOC
+//------------------------------------------------------------------------------
+#if CACHE_BLOCK_COUNT > 1
+cache_t* FatVolume::cacheFetchData(uint32_t blockNumber, uint8_t options) {
+  uint8_t i;
+  uint8_t lru = 0;
+  uint16_t age = 0;
+  // find the block or else the least recently used entry
+  for (i = 0; i < CACHE_BLOCK_COUNT; i++) {
+    if (m_cache[i].lbn() == blockNumber) {
+      break;
+    }
+    // prefer an invalid entry
+    uint16_t tmp = m_cache[i].lbn() == 0XFFFFFFFF ? 0XFFFF
+                   : m_cacheTick - m_cacheUse[i];
+    if (tmp >= age) {
+      age = tmp;
+      lru = i;
+    }
+  }
+  if (i == CACHE_BLOCK_COUNT) {
+    i = lru;
+  }
+  m_cacheUse[i] = ++m_cacheTick;
+  m_curCache = &m_cache[i];
+  cacheCount(m_curCache, blockNumber);
+  return m_curCache->read(blockNumber, options);
+}
+#endif  // CACHE_BLOCK_COUNT > 1
 //------------------------------------------------------------------------------
 uint32_t FatVolume::clusterStartBlock(uint32_t cluster) const {
   return m_dataStartBlock + ((cluster - 2) << m_clusterSizeShift);
@@ -191,6 +404,9 @@ int8_t FatVolume::fatGet(uint32_t cluster, uint32_t* value) {
 
   // error if reserved cluster of beyond FAT
   DBG_HALT_IF(cluster < 2 || cluster > m_lastCluster);
+#if ENABLE_CACHE_STATS
+  m_fatGets++;
+#endif  // ENABLE_CACHE_STATS
 
   if (m_fatType == 32) {
     lba = m_fatStartBlock + (cluster >> 7);
@@ -251,6 +467,117 @@ fail:
   return -1;
 }
 //------------------------------------------------------------------------------
+// Check a FAT entry - return -1 error, 0 in use, else 1.
+int8_t FatVolume::fatIsFree(uint32_t cluster) {
+  uint32_t f;
+  int8_t fg;
+#if USE_FREE_CLUSTER_BITMAP
+  if (m_freeBitmapSize) {
+    uint32_t i = cluster - m_freeBitmapStart;
+    if (i >= m_freeBitmapCount) {
+      // move the window to this cluster
+      if (!freeBitmapFill(cluster)) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      i = cluster - m_freeBitmapStart;
+    }
+    return (m_freeBitmap[i >> 3] >> (i & 7)) & 1;
+  }
+#endif  // USE_FREE_CLUSTER_BITMAP
+  fg = fatGet(cluster, &f);
+  if (fg < 0) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  return fg && f == 0;
+
+fail:
+  return -1;
+}
+//------------------------------------------------------------------------------
+#if USE_FAT_SCAN_BUFFER
+// Return a FAT block from the scan buffer, or zero to use the cache.
+cache_t* FatVolume::fatScanFetch(uint32_t blockNumber) {
+  uint32_t i = blockNumber - m_fatScanStart;
+  if (i >= m_fatScanCount) {
+    uint32_t n = m_fatStartBlock + m_blocksPerFat - blockNumber;
+    m_fatScanCount = 0;
+    if (blockNumber < m_fatStartBlock || n > m_blocksPerFat) {
+      return 0;
+    }
+    if (n > m_fatScanSize) {
+      n = m_fatScanSize;
+    }
+    if (!readBlocks(blockNumber, m_fatScanBuf, n)) {
+      DBG_FAIL_MACRO;
+      return 0;
+    }
+    // cached blocks may be newer than the device
+    for (uint8_t k = 0; k < CACHE_BLOCK_COUNT; k++) {
+      uint32_t j = m_cache[k].lbn() - blockNumber;
+      if (j < n) {
+        memcpy(m_fatScanBuf + 512*j, m_cache[k].block()->data, 512);
+      }
+    }
+#if USE_SEPARATE_FAT_CACHE
+    uint32_t j = m_fatCache.lbn() - blockNumber;
+    if (j < n) {
+      memcpy(m_fatScanBuf + 512*j, m_fatCache.block()->data, 512);
+    }
+#endif  // USE_SEPARATE_FAT_CACHE
+    m_fatScanStart = blockNumber;
+    m_fatScanCount = n;
+    i = 0;
+  }
+  return reinterpret_cast<cache_t*>(m_fatScanBuf + 512*i);
+}
+#endif  // USE_FAT_SCAN_BUFFER
+//------------------------------------------------------------------------------
+// Find the run of clusters with the same free state that starts at cluster
+// and ends in the FAT block for cluster.  Return -1 error, 0 in use, else 1.
+int8_t FatVolume::fatRun(uint32_t cluster, uint32_t* count) {
+  cache_t* pc;
+  uint16_t i;
+  uint16_t k;
+  uint16_t end;
+  int8_t fg;
+  uint8_t shift = m_fatType == 16 ? 8 : 7;
+#if USE_FREE_CLUSTER_BITMAP
+  bool bitmap = m_freeBitmapSize != 0;
+#else  // USE_FREE_CLUSTER_BITMAP
+  bool bitmap = false;
+#endif  // USE_FREE_CLUSTER_BITMAP
+  if (bitmap || (m_fatType != 16 && m_fatType != 32)) {
+    *count = 1;
+    return fatIsFree(cluster);
+  }
+  end = 1 << shift;
+  i = cluster & (end - 1);
+  if ((m_lastCluster - cluster) < (uint32_t)(end - i - 1)) {
+    end = i + m_lastCluster - cluster + 1;
+  }
+  pc = cacheFetchFat(m_fatStartBlock + (cluster >> shift),
+                     FatCache::CACHE_FOR_READ);
+  if (!pc) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (m_fatType == 16) {
+    fg = pc->fat16[i] == 0;
+    for (k = i + 1; k < end && (pc->fat16[k] == 0) == fg; k++) {}
+  } else {
+    fg = (pc->fat32[i] & FAT32MASK) == 0;
+    for (k = i + 1; k < end && ((pc->fat32[k] & FAT32MASK) == 0) == fg; k++) {}
+  }
+  *count = k - i;
+  return fg;
+
+fail:
+  return -1;
+}
+//------------------------------------------------------------------------------
+#if !FAT_READ_ONLY
 // Store a FAT entry
 bool FatVolume::fatPut(uint32_t cluster, uint32_t value) {
   uint32_t lba;
@@ -258,6 +585,9 @@ bool FatVolume::fatPut(uint32_t cluster, uint32_t value) {
 
   // error if reserved cluster of beyond FAT
   DBG_HALT_IF(cluster < 2 || cluster > m_lastCluster);
+#if USE_FREE_CLUSTER_BITMAP
+  freeBitmapPut(cluster, value == 0);
+#endif  // USE_FREE_CLUSTER_BITMAP
 
   if (m_fatType == 32) {
     lba = m_fatStartBlock + (cluster >> 7);
@@ -321,11 +651,49 @@ bool FatVolume::fatPut(uint32_t cluster, uint32_t value) {
 fail:
   return false;
 }
+#endif  // !FAT_READ_ONLY
 //------------------------------------------------------------------------------
+#if USE_FREE_CLUSTER_BITMAP
+// Fill the bitmap for the window that starts at the byte for cluster.
+bool FatVolume::freeBitmapFill(uint32_t cluster) {
+  uint32_t end;
+  m_freeBitmapCount = 0;
+  m_freeBitmapStart = cluster & ~7UL;
+  end = m_freeBitmapStart + m_freeBitmapSize;
+  if (end > m_lastCluster + 1) {
+    end = m_lastCluster + 1;
+  }
+  memset(m_freeBitmap, 0, m_freeBitmapSize >> 3);
+  for (uint32_t c = m_freeBitmapStart < 2 ? 2 : m_freeBitmapStart;
+       c < end; c++) {
+    uint32_t f;
+    int8_t fg = fatGet(c, &f);
+    if (fg < 0) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    if (fg && f == 0) {
+      uint32_t i = c - m_freeBitmapStart;
+      m_freeBitmap[i >> 3] |= 1 << (i & 7);
+    }
+  }
+  m_freeBitmapCount = end - m_freeBitmapStart;
+  return true;
+
+fail:
+  return false;
+}
+#endif  // USE_FREE_CLUSTER_BITMAP
+//------------------------------------------------------------------------------
+#if !FAT_READ_ONLY
 // free a cluster chain
 bool FatVolume::freeChain(uint32_t cluster) {
   uint32_t next;
   int8_t fg;
+#if ENABLE_ERASE_TRIM
+  uint32_t runStart = cluster;
+  uint32_t runCount = 0;
+#endif  // ENABLE_ERASE_TRIM
   do {
     fg = fatGet(cluster, &next);
     if (fg < 0) {
@@ -337,9 +705,24 @@ bool FatVolume::freeChain(uint32_t cluster) {
       DBG_FAIL_MACRO;
       goto fail;
     }
+    updateFreeClusterCount(1);
     if (cluster < m_allocSearchStart) {
       m_allocSearchStart = cluster;
     }
+#if ENABLE_ERASE_TRIM
+    if (m_trim) {
+      runCount++;
+      // erase at end of each run of contiguous clusters
+      if (!fg || next != (cluster + 1)) {
+        if (!eraseClusters(runStart, runCount)) {
+          DBG_FAIL_MACRO;
+          goto fail;
+        }
+        runStart = next;
+        runCount = 0;
+      }
+    }
+#endif  // ENABLE_ERASE_TRIM
     cluster = next;
   } while (fg);
 
@@ -349,12 +732,65 @@ fail:
   return false;
 }
 //------------------------------------------------------------------------------
+#if ENABLE_ERASE_TRIM
+bool FatVolume::eraseClusters(uint32_t cluster, uint32_t count) {
+  uint32_t first = clusterStartBlock(cluster);
+  uint32_t n = count << m_clusterSizeShift;
+  // cached data for the erased blocks must not be written back
+  cacheInvalidate(first, n);
+  return eraseBlocks(first, first + n - 1);
+}
+#endif  // ENABLE_ERASE_TRIM
+#endif  // !FAT_READ_ONLY
+//------------------------------------------------------------------------------
+// Count free entries in a FAT16 block.
+static uint16_t freeCount16(const cache_t* pc, uint16_t n) {
+  uint16_t free = 0;
+#ifdef __AVR__
+  for (uint16_t i = 0; i < n; i++) {
+    if (pc->fat16[i] == 0) {
+      free++;
+    }
+  }
+#else  // __AVR__
+  // Test two entries with each 32-bit word.  Bit 15 of a lane in z is
+  // set only if the lane is zero.
+  uint32_t sum = 0;
+  for (uint16_t i = 0; i < n/2; i++) {
+    uint32_t w = pc->fat32[i];
+    uint32_t z = ~(((w & 0X7FFF7FFF) + 0X7FFF7FFF) | w);
+    sum += (z >> 15) & 0X10001;
+  }
+  free = (sum & 0XFFFF) + (sum >> 16);
+  if (n & 1) {
+    free += pc->fat16[n - 1] == 0;
+  }
+#endif  // __AVR__
+  return free;
+}
+//------------------------------------------------------------------------------
+// Count free entries in a FAT32 block.
+static uint16_t freeCount32(const cache_t* pc, uint16_t n) {
+  uint16_t free = 0;
+  for (uint16_t i = 0; i < n; i++) {
+    free += (pc->fat32[i] & FAT32MASK) == 0;
+  }
+  return free;
+}
+//------------------------------------------------------------------------------
 int32_t FatVolume::freeClusterCount() {
   uint32_t free = 0;
   uint32_t lba;
   uint32_t todo = m_lastCluster + 1;
   uint16_t n;
+  FAT_VOLUME_LOCK(this);
 
+#if MAINTAIN_FREE_CLUSTER_COUNT
+  if (m_freeClusterCount >= 0) {
+    return m_freeClusterCount;
+  }
+#endif  // MAINTAIN_FREE_CLUSTER_COUNT
+  fatScan(true);
   if (FAT12_SUPPORT && m_fatType == 12) {
     for (unsigned i = 2; i < todo; i++) {
       uint32_t c;
@@ -380,17 +816,9 @@ int32_t FatVolume::freeClusterCount() {
         n = todo;
       }
       if (m_fatType == 16) {
-        for (uint16_t i = 0; i < n; i++) {
-          if (pc->fat16[i] == 0) {
-            free++;
-          }
-        }
+        free += freeCount16(pc, n);
       } else {
-        for (uint16_t i = 0; i < n; i++) {
-          if (pc->fat32[i] == 0) {
-            free++;
-          }
-        }
+        free += freeCount32(pc, n);
       }
       todo -= n;
     }
@@ -399,26 +827,221 @@ int32_t FatVolume::freeClusterCount() {
     DBG_FAIL_MACRO;
     goto fail;
   }
+  fatScan(false);
+#if MAINTAIN_FREE_CLUSTER_COUNT
+  m_freeClusterCount = free;
+#endif  // MAINTAIN_FREE_CLUSTER_COUNT
   return free;
 
 fail:
+  fatScan(false);
   return -1;
 }
 //------------------------------------------------------------------------------
-bool FatVolume::init(uint8_t part) {
-  uint32_t clusterCount;
-  uint32_t totalBlocks;
-  uint32_t volumeStartBlock = 0;
-  fat32_boot_t* fbs;
+#if MAINTAIN_FREE_CLUSTER_COUNT
+bool FatVolume::fsInfoSync() {
+  cache_t* pc = cacheFetchData(m_fsInfoBlock, FatCache::CACHE_FOR_WRITE);
+  if (!pc) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  pc->fsinfo.freeCount = m_freeClusterCount;
+  pc->fsinfo.nextFree = m_allocSearchStart < m_lastCluster ?
+                        m_allocSearchStart + 1 : 0XFFFFFFFF;
+  m_fsInfoDirty = false;
+  return true;
+
+fail:
+  return false;
+}
+#endif  // MAINTAIN_FREE_CLUSTER_COUNT
+//------------------------------------------------------------------------------
+#if ENABLE_LAZY_SYNC
+bool FatVolume::commit() {
+#if MAINTAIN_FREE_CLUSTER_COUNT
+  if (m_fsInfoDirty && !fsInfoSync()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+#endif  // MAINTAIN_FREE_CLUSTER_COUNT
+  if (!cacheSync()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  // Copy deferred blocks from the first FAT.
+  while (m_mirrorLast) {
+    cache_t* pc = cacheFetchFat(m_mirrorFirst, FatCache::CACHE_FOR_READ);
+    if (!pc || !writeBlock(m_mirrorFirst + m_blocksPerFat, pc->data)) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    storeUpdate(m_mirrorFirst + m_blocksPerFat, pc->data);
+    if (m_mirrorFirst++ == m_mirrorLast) {
+      m_mirrorLast = 0;
+    }
+  }
+  return true;
+
+fail:
+  return false;
+}
+#endif  // ENABLE_LAZY_SYNC
+//------------------------------------------------------------------------------
+#if USE_DIR_HASH_INDEX
+// Table is open addressed with an index of 0XFFFF for an empty slot.
+bool FatVolume::hashIndexAdd(uint16_t hash, uint16_t index) {
+  uint16_t i = hash % m_hashIndexSize;
+  // Keep one empty slot to end searches.
+  if ((m_hashIndexCount + 1) >= m_hashIndexSize || index == 0XFFFF) {
+    m_hashIndexCount = m_hashIndexSize + 1;
+    return false;
+  }
+  while (m_hashIndex[2*i + 1] != 0XFFFF) {
+    if (++i == m_hashIndexSize) {
+      i = 0;
+    }
+  }
+  m_hashIndex[2*i] = hash;
+  m_hashIndex[2*i + 1] = index;
+  m_hashIndexCount++;
+  return true;
+}
+//------------------------------------------------------------------------------
+bool FatVolume::hashIndexFind(uint16_t hash, uint16_t* slot,
+                              uint16_t* index) {
+  uint16_t i = *slot;
+  while (m_hashIndex[2*i + 1] != 0XFFFF) {
+    uint16_t* p = m_hashIndex + 2*i;
+    if (++i == m_hashIndexSize) {
+      i = 0;
+    }
+    if (p[0] == hash) {
+      *slot = i;
+      *index = p[1];
+      return true;
+    }
+  }
+  return false;
+}
+#endif  // USE_DIR_HASH_INDEX
+#if ENABLE_WARM_MOUNT
+//------------------------------------------------------------------------------
+// Check value for the boot sector parameters, FAT32 extended parameters and
+// volume serial number.
+static uint32_t bootCheck(const uint8_t* data) {
+  uint32_t check = 0;
+  for (uint8_t i = 0; i < 90; i++) {
+    check = ((check << 5) | (check >> 27)) + data[i];
+  }
+  return check;
+}
+//------------------------------------------------------------------------------
+bool FatVolume::initWarm(const FatGeometry_t* geo) {
   cache_t* pc;
-  uint8_t tmp;
+  initState();
+  if (geo->fatType == 0 || (geo->fatType == 12 && !FAT12_SUPPORT)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  pc = cacheFetchData(geo->volumeStartBlock, FatCache::CACHE_FOR_READ);
+  if (!pc || bootCheck(pc->data) != geo->bootCheck) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_volumeStartBlock = geo->volumeStartBlock;
+  m_bootCheck = geo->bootCheck;
+  m_blocksPerFat = geo->blocksPerFat;
+  m_dataStartBlock = geo->dataStartBlock;
+  m_fatStartBlock = geo->fatStartBlock;
+  m_lastCluster = geo->lastCluster;
+  m_rootDirStart = geo->rootDirStart;
+  m_rootDirEntryCount = geo->rootDirEntryCount;
+  m_blocksPerCluster = geo->blocksPerCluster;
+  m_clusterBlockMask = m_blocksPerCluster - 1;
+  m_clusterSizeShift = geo->clusterSizeShift;
+#if MAINTAIN_FREE_CLUSTER_COUNT
+  m_fsInfoBlock = geo->fsInfoBlock;
+#endif  // MAINTAIN_FREE_CLUSTER_COUNT
+  m_fatType = geo->fatType;
+  return true;
+
+fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+bool FatVolume::saveGeometry(FatGeometry_t* geo) {
+  if (!m_fatType) {
+    return false;
+  }
+  geo->volumeStartBlock = m_volumeStartBlock;
+  geo->bootCheck = m_bootCheck;
+#if MAINTAIN_FREE_CLUSTER_COUNT
+  geo->fsInfoBlock = m_fsInfoBlock;
+#else  // MAINTAIN_FREE_CLUSTER_COUNT
+  geo->fsInfoBlock = 0;
+#endif  // MAINTAIN_FREE_CLUSTER_COUNT
+  geo->blocksPerFat = m_blocksPerFat;
+  geo->dataStartBlock = m_dataStartBlock;
+  geo->fatStartBlock = m_fatStartBlock;
+  geo->lastCluster = m_lastCluster;
+  geo->rootDirStart = m_rootDirStart;
+  geo->rootDirEntryCount = m_rootDirEntryCount;
+  geo->blocksPerCluster = m_blocksPerCluster;
+  geo->clusterSizeShift = m_clusterSizeShift;
+  geo->fatType = m_fatType;
+  return true;
+}
+#endif  // ENABLE_WARM_MOUNT
+//------------------------------------------------------------------------------
+// Reset volume state and caches for init.
+void FatVolume::initState() {
   m_fatType = 0;
   m_allocSearchStart = 1;
+#if MAINTAIN_FREE_CLUSTER_COUNT
+  m_freeClusterCount = -1;
+  m_fsInfoBlock = 0;
+  m_fsInfoDirty = false;
+#endif  // MAINTAIN_FREE_CLUSTER_COUNT
+#if USE_DIR_HASH_INDEX
+  m_hashIndexValid = false;
+#endif  // USE_DIR_HASH_INDEX
+  pathCacheInvalidate();
+#if ENABLE_LAZY_SYNC
+  m_mirrorLast = 0;
+#endif  // ENABLE_LAZY_SYNC
+#if USE_FREE_CLUSTER_BITMAP
+  m_freeBitmapCount = 0;
+#endif  // USE_FREE_CLUSTER_BITMAP
+#if USE_AU_ALLOC
+  m_auClusters = 0;
+#endif  // USE_AU_ALLOC
 
-  m_cache.init(this);
+  for (uint8_t i = 0; i < CACHE_BLOCK_COUNT; i++) {
+    m_cache[i].init(this);
+  }
+#if CACHE_BLOCK_COUNT > 1
+  m_curCache = m_cache;
+  m_cacheTick = 0;
+  memset(m_cacheUse, 0, sizeof(m_cacheUse));
+#endif  // CACHE_BLOCK_COUNT > 1
+#if ENABLE_CACHE_STATS
+  cacheResetStats();
+#endif  // ENABLE_CACHE_STATS
 #if USE_SEPARATE_FAT_CACHE
   m_fatCache.init(this);
 #endif  // USE_SEPARATE_FAT_CACHE
+  // The store may hold blocks from another card.
+  storeInvalidate(0, 0XFFFFFFFF);
+}
+//------------------------------------------------------------------------------
+bool FatVolume::init(uint8_t part) {
+  uint32_t clusterCount;
+  uint32_t totalBlocks;
+  uint32_t volumeStartBlock = 0;
+  fat32_boot_t* fbs;
+  cache_t* pc;
+  uint8_t tmp;
+  initState();
 
   // if part == 0 assume super floppy with FAT boot sector in block zero
   // if part > 0 assume mbr volume with partition table
@@ -453,6 +1076,10 @@ bool FatVolume::init(uint8_t part) {
     DBG_FAIL_MACRO;
     goto fail;
   }
+#if ENABLE_WARM_MOUNT
+  m_volumeStartBlock = volumeStartBlock;
+  m_bootCheck = bootCheck(pc->data);
+#endif  // ENABLE_WARM_MOUNT
   m_blocksPerCluster = fbs->sectorsPerCluster;
   m_clusterBlockMask = m_blocksPerCluster - 1;
 
@@ -500,17 +1127,152 @@ bool FatVolume::init(uint8_t part) {
   } else {
     m_rootDirStart = fbs->fat32RootCluster;
     m_fatType = 32;
+#if MAINTAIN_FREE_CLUSTER_COUNT
+    uint32_t lbn = volumeStartBlock + fbs->fat32FSInfo;
+    if (fbs->fat32FSInfo == 0) {
+      return true;
+    }
+    pc = cacheFetchData(lbn, FatCache::CACHE_FOR_READ);
+    if (!pc) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    if (pc->fsinfo.leadSignature == FSINFO_LEAD_SIG &&
+        pc->fsinfo.structSignature == FSINFO_STRUCT_SIG) {
+      m_fsInfoBlock = lbn;
+      if (pc->fsinfo.freeCount <= clusterCount) {
+        m_freeClusterCount = pc->fsinfo.freeCount;
+      }
+      uint32_t next = pc->fsinfo.nextFree;
+      if (next >= 2 && next <= m_lastCluster) {
+        m_allocSearchStart = next - 1;
+      }
+    }
+#endif  // MAINTAIN_FREE_CLUSTER_COUNT
+  }
+  return true;
+
+fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+#if ENABLE_ASYNC_READ
+bool FatVolume::readBlocksAsync(uint32_t block, uint8_t* dst, size_t nb,
+                                readDone_t callback, void* context) {
+#if USE_MULTI_BLOCK_IO
+  if (!readBlocks(block, dst, nb)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+#else  // USE_MULTI_BLOCK_IO
+  for (size_t i = 0; i < nb; i++, dst += 512) {
+    if (!readBlock(block + i, dst)) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+  }
+#endif  // USE_MULTI_BLOCK_IO
+  if (callback) {
+    callback(true, context);
+  }
+  return true;
+
+fail:
+  return false;
+}
+#endif  // ENABLE_ASYNC_READ
+//------------------------------------------------------------------------------
+bool FatVolume::readBlockSink(uint32_t block, readSink_t sink, void* context) {
+  cache_t* pc = cacheFetchData(block, FatCache::CACHE_FOR_READ);
+  if (!pc) {
+    DBG_FAIL_MACRO;
+    goto fail;
   }
+  sink(pc->data, 512, context);
   return true;
 
 fail:
   return false;
 }
+#if USE_CACHE_STORE
+//------------------------------------------------------------------------------
+// Read a block through the store.  The slot is marked empty while it is
+// written so a failed store write leaves no stale data.
+bool FatVolume::storeRead(uint32_t lbn, uint8_t* dst) {
+  uint16_t slot;
+  if (m_storeCount == 0) {
+    return readBlock(lbn, dst);
+  }
+  slot = lbn % m_storeCount;
+  if (m_storeTag[slot] == lbn) {
+    if (m_store->readSlot(slot, dst)) {
+      return true;
+    }
+    m_storeTag[slot] = 0XFFFFFFFF;
+  }
+  if (!readBlock(lbn, dst)) {
+    DBG_FAIL_MACRO;
+    return false;
+  }
+  m_storeTag[slot] = 0XFFFFFFFF;
+  if (m_store->writeSlot(slot, dst)) {
+    m_storeTag[slot] = lbn;
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+// Drop blocks in the range [lbn, lbn + count) from the store.
+void FatVolume::storeInvalidate(uint32_t lbn, uint32_t count) {
+  if (count < m_storeCount) {
+    for (uint32_t n = 0; n < count; n++) {
+      uint16_t slot = (lbn + n) % m_storeCount;
+      if (m_storeTag[slot] == lbn + n) {
+        m_storeTag[slot] = 0XFFFFFFFF;
+      }
+    }
+  } else {
+    for (uint16_t i = 0; i < m_storeCount; i++) {
+      if ((m_storeTag[i] - lbn) < count) {
+        m_storeTag[i] = 0XFFFFFFFF;
+      }
+    }
+  }
+}
+//------------------------------------------------------------------------------
+// Copy a block written to the device to the store if the store has it.
+void FatVolume::storeUpdate(uint32_t lbn, const uint8_t* src) {
+  if (m_storeCount) {
+    uint16_t slot = lbn % m_storeCount;
+    if (m_storeTag[slot] == lbn && !m_store->writeSlot(slot, src)) {
+      m_storeTag[slot] = 0XFFFFFFFF;
+    }
+  }
+}
+#endif  // USE_CACHE_STORE
+#if USE_APP_CACHE_BUFFER
+//------------------------------------------------------------------------------
+bool FatVolume::setCacheBuffer(cache_t* buf) {
+  FAT_VOLUME_LOCK(this);
+  if (m_fatType && !cacheSync()) {
+    DBG_FAIL_MACRO;
+    return false;
+  }
+  for (uint8_t i = 0; i < CACHE_BLOCK_COUNT; i++) {
+    m_cache[i].setBuffer(buf ? buf + i : 0);
+  }
+#if USE_SEPARATE_FAT_CACHE
+  m_fatCache.setBuffer(buf ? buf + CACHE_BLOCK_COUNT : 0);
+#endif  // USE_SEPARATE_FAT_CACHE
+  return true;
+}
+#endif  // USE_APP_CACHE_BUFFER
 //------------------------------------------------------------------------------
+#if !FAT_READ_ONLY
 bool FatVolume::wipe(print_t* pr) {
   cache_t* cache;
   uint16_t count;
   uint32_t lbn;
+  FAT_VOLUME_LOCK(this);
   if (!m_fatType) {
     DBG_FAIL_MACRO;
     goto fail;
@@ -566,6 +1328,12 @@ bool FatVolume::wipe(print_t* pr) {
     goto fail;
   }
   if (m_fatType == 32) {
+#if MAINTAIN_FREE_CLUSTER_COUNT
+    // FSINFO count is unknown until the next mount scans the FAT.
+    m_freeClusterCount = -1;
+    m_allocSearchStart = 1;
+    m_fsInfoDirty = m_fsInfoBlock != 0;
+#endif  // MAINTAIN_FREE_CLUSTER_COUNT
     // Reserve root cluster.
     if (!fatPutEOC(m_rootDirStart) || !cacheSync()) {
       DBG_FAIL_MACRO;
@@ -583,3 +1351,4 @@ fail:
   m_fatType = 0;
   return false;
 }
+#endif  // !FAT_READ_ONLY
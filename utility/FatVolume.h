@@ -62,6 +62,57 @@ class CharWriter {
 typedef CharWriter print_t;
 #endif  // ENABLE_ARDUINO_FEATURES
 //------------------------------------------------------------------------------
+/** Type for a function that accepts a run of data read from a file.
+ * The function is called with a pointer to the data, the number of bytes
+ * in the run and the context pointer supplied by the caller.
+ */
+typedef void (*readSink_t)(const uint8_t* data, size_t n, void* context);
+#if ENABLE_LOCK_HOOKS
+//------------------------------------------------------------------------------
+/** Type for a lock hook.  The hook is called with \a take true to acquire
+ * the lock and false to release it, along with the context pointer
+ * supplied by the caller.  Calls nest so the lock must be recursive, a
+ * FreeRTOS recursive mutex for example.
+ */
+typedef void (*lockHook_t)(bool take, void* context);
+//------------------------------------------------------------------------------
+/**
+ * \class FatLockGuard
+ * \brief Internal - hold a lock hook until the end of a scope.
+ */
+class FatLockGuard {
+ public:
+  /** Acquire a lock.
+   * \param[in] hook Lock hook, zero for none.
+   * \param[in] context Pointer passed to \a hook.
+   */
+  FatLockGuard(lockHook_t hook, void* context)
+    : m_hook(hook), m_context(context) {
+    if (m_hook) {
+      m_hook(true, m_context);
+    }
+  }
+  ~FatLockGuard() {
+    if (m_hook) {
+      m_hook(false, m_context);
+    }
+  }
+
+ private:
+  lockHook_t m_hook;
+  void* m_context;
+};
+/** Internal - hold the lock of volume \a vol until the end of the scope. */
+#define FAT_VOLUME_LOCK(vol) FatLockGuard volumeLock_(\
+  (vol) ? (vol)->m_lockHook : 0, (vol) ? (vol)->m_lockContext : 0)
+#else  // ENABLE_LOCK_HOOKS
+#define FAT_VOLUME_LOCK(vol)
+#endif  // ENABLE_LOCK_HOOKS
+/** Type for a function called when an async read is done.  It is called
+ * with true for success and the context pointer supplied by the caller.
+ */
+typedef void (*readDone_t)(bool success, void* context);
+//------------------------------------------------------------------------------
 // Forward declaration of FatVolume.
 class FatVolume;
 //------------------------------------------------------------------------------
@@ -86,6 +137,100 @@ union cache_t {
   /** Used to access to a cached FAT32 FSINFO sector. */
   fat32_fsinfo_t fsinfo;
 };
+#if PATH_CACHE_SIZE
+//------------------------------------------------------------------------------
+/**
+ * \struct path_cache_t
+ * \brief Internal type for a resolved directory path - do not use in
+ * user apps.
+ */
+struct path_cache_t {
+  /** First cluster of start directory, zero for root. */
+  uint32_t startCluster;
+  /** First cluster of the directory. */
+  uint32_t firstCluster;
+  /** First cluster of the parent directory. */
+  uint32_t dirCluster;
+  /** Block with the directory entry. */
+  uint32_t dirBlock;
+  /** Index of the entry in the parent directory. */
+  uint16_t dirIndex;
+  /** Directory attributes. */
+  uint8_t attr;
+  /** Number of long name entries. */
+  uint8_t lfnOrd;
+  /** Length of path, zero for an unused entry. */
+  uint8_t len;
+  /** Path prefix, not zero terminated. */
+  char path[PATH_CACHE_PATH_DIM];
+};
+#endif  // PATH_CACHE_SIZE
+#if ENABLE_WARM_MOUNT
+//------------------------------------------------------------------------------
+/**
+ * \struct FatGeometry_t
+ * \brief Volume parameters saved by FatVolume::saveGeometry() for a
+ * warm mount.  Treat as opaque.
+ */
+struct FatGeometry_t {
+  /** Boot sector block. */
+  uint32_t volumeStartBlock;
+  /** Check value for the boot sector parameters and serial number. */
+  uint32_t bootCheck;
+  /** FAT32 FSINFO block, zero if none. */
+  uint32_t fsInfoBlock;
+  /** FAT size in blocks. */
+  uint32_t blocksPerFat;
+  /** First data block. */
+  uint32_t dataStartBlock;
+  /** First FAT block. */
+  uint32_t fatStartBlock;
+  /** Last cluster number. */
+  uint32_t lastCluster;
+  /** Root directory start block for FAT16, cluster for FAT32. */
+  uint32_t rootDirStart;
+  /** Entries in the FAT16 root directory. */
+  uint16_t rootDirEntryCount;
+  /** Cluster size in blocks. */
+  uint8_t blocksPerCluster;
+  /** Cluster count to block count shift. */
+  uint8_t clusterSizeShift;
+  /** FAT type, zero if not valid. */
+  uint8_t fatType;
+};
+#endif  // ENABLE_WARM_MOUNT
+#if USE_CACHE_STORE
+//------------------------------------------------------------------------------
+/**
+ * \class FatCacheStore
+ * \brief Interface for second level cache memory such as serial SRAM.
+ *
+ * The store holds 512 byte slots numbered from zero.  A block that is
+ * not in the volume cache is read from the store if it is there, else
+ * it is read from the device and copied to the store.
+ */
+class FatCacheStore {
+ public:
+  /** Read a slot.
+   *
+   * \param[in] slot Slot number.
+   * \param[out] dst Location for 512 bytes.
+   *
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  virtual bool readSlot(uint16_t slot, uint8_t* dst) = 0;
+  /** Write a slot.
+   *
+   * \param[in] slot Slot number.
+   * \param[in] src 512 bytes to store.
+   *
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  virtual bool writeSlot(uint16_t slot, const uint8_t* src) = 0;
+};
+#endif  // USE_CACHE_STORE
 //==============================================================================
 /**
  * \class FatCache
@@ -93,6 +238,11 @@ union cache_t {
  */
 class FatCache {
  public:
+#if USE_APP_CACHE_BUFFER
+  FatCache() : m_block(0) {
+    invalidate();
+  }
+#endif  // USE_APP_CACHE_BUFFER
   /** Cached block is dirty */
   static const uint8_t CACHE_STATUS_DIRTY = 1;
   /** Cashed block is FAT entry and must be mirrored in second FAT. */
@@ -109,13 +259,29 @@ class FatCache {
   /** Reserve cache block for write - do not read from block device. */
   static uint8_t const CACHE_RESERVE_FOR_WRITE
     = CACHE_STATUS_DIRTY | CACHE_OPTION_NO_READ;
+#if USE_APP_CACHE_BUFFER
+  /** \return Cache block address, zero if no buffer has been lent. */
+  cache_t* block() {
+    return m_block;
+  }
+  /** Use a block buffer for the cache.
+   * \param[in] buf Buffer or zero for none.
+   */
+  void setBuffer(cache_t* buf) {
+    m_block = buf;
+    invalidate();
+  }
+#else  // USE_APP_CACHE_BUFFER
   /** \return Cache block address. */
   cache_t* block() {
     return &m_block;
   }
+#endif  // USE_APP_CACHE_BUFFER
   /** Set current block dirty. */
   void dirty() {
+#if !FAT_READ_ONLY
     m_status |= CACHE_STATUS_DIRTY;
+#endif  // !FAT_READ_ONLY
   }
   /** Initialize the cache.
    * \param[in] vol FatVolume that owns this FatCache.
@@ -126,7 +292,9 @@ class FatCache {
   }
   /** Invalidate current cache block. */
   void invalidate() {
+#if !FAT_READ_ONLY
     m_status = 0;
+#endif  // !FAT_READ_ONLY
     m_lbn = 0XFFFFFFFF;
   }
   /** \return Logical block number for cached block. */
@@ -138,16 +306,31 @@ class FatCache {
    * \param[in] option mode for cached block.
    * \return Address of cached block. */
   cache_t* read(uint32_t lbn, uint8_t option);
+#if FAT_READ_ONLY
+  /** Nothing to write in a read-only build.
+   * \return true.
+   */
+  bool sync() {
+    return true;
+  }
+#else  // FAT_READ_ONLY
   /** Write current block if dirty.
    * \return true for success else false.
    */
   bool sync();
+#endif  // FAT_READ_ONLY
 
  private:
+#if !FAT_READ_ONLY
   uint8_t m_status;
+#endif  // !FAT_READ_ONLY
   FatVolume* m_vol;
   uint32_t m_lbn;
+#if USE_APP_CACHE_BUFFER
+  cache_t* m_block;  // buffer lent by the application
+#else  // USE_APP_CACHE_BUFFER
   cache_t m_block;
+#endif  // USE_APP_CACHE_BUFFER
 };
 //==============================================================================
 /**
@@ -158,7 +341,31 @@ class FatVolume {
  public:
   /** Create an instance of FatVolume
    */
-  FatVolume() : m_fatType(0) {}
+  FatVolume() : m_fatType(0) {
+#if USE_FREE_CLUSTER_BITMAP
+    m_freeBitmapSize = 0;
+#endif  // USE_FREE_CLUSTER_BITMAP
+#if USE_DIR_HASH_INDEX
+    m_hashIndexSize = 0;
+#endif  // USE_DIR_HASH_INDEX
+#if USE_FAT_SCAN_BUFFER
+    m_fatScanSize = 0;
+    m_fatScanActive = false;
+#endif  // USE_FAT_SCAN_BUFFER
+#if ENABLE_LAZY_SYNC
+    m_lazySync = false;
+    m_mirrorLast = 0;
+#endif  // ENABLE_LAZY_SYNC
+#if ENABLE_ERASE_TRIM
+    m_trim = false;
+#endif  // ENABLE_ERASE_TRIM
+#if ENABLE_LOCK_HOOKS
+    m_lockHook = 0;
+#endif  // ENABLE_LOCK_HOOKS
+#if USE_CACHE_STORE
+    m_storeCount = 0;
+#endif  // USE_CACHE_STORE
+  }
 
   /** \return The volume's cluster size in blocks. */
   uint8_t blocksPerCluster() const {
@@ -175,9 +382,34 @@ class FatVolume {
     if (!cacheSync()) {
       return 0;
     }
-    m_cache.invalidate();
-    return m_cache.block();
+    for (uint8_t i = 0; i < CACHE_BLOCK_COUNT; i++) {
+      m_cache[i].invalidate();
+    }
+    storeInvalidate(0, 0XFFFFFFFF);
+    return cacheCurrent()->block();
+  }
+#if ENABLE_CACHE_STATS
+  /** \return The number of cache fetches satisfied from the cache. */
+  uint32_t cacheHitCount() const {
+    return m_cacheHits;
+  }
+  /** \return The number of cache fetches that required a device read. */
+  uint32_t cacheMissCount() const {
+    return m_cacheMisses;
+  }
+  /** \return The number of dirty cache blocks written to the device. */
+  uint32_t cacheWritebackCount() const {
+    return m_cacheWritebacks;
   }
+  /** \return The number of calls to fatGet(). */
+  uint32_t fatGetCount() const {
+    return m_fatGets;
+  }
+  /** Set the cache and FAT access counts to zero. */
+  void cacheResetStats() {
+    m_cacheHits = m_cacheMisses = m_cacheWritebacks = m_fatGets = 0;
+  }
+#endif  // ENABLE_CACHE_STATS
   /** \return The total number of clusters in the volume. */
   uint32_t clusterCount() const {
     return m_lastCluster - 1;
@@ -203,6 +435,9 @@ class FatVolume {
     return m_fatType;
   }
   /** Volume free space in clusters.
+   *
+   * If MAINTAIN_FREE_CLUSTER_COUNT is nonzero the FAT is only scanned
+   * if the count is not known from FSINFO or a previous call.
    *
    * \return Count of free clusters for success or -1 if an error occurs.
    */
@@ -227,6 +462,169 @@ class FatVolume {
    * the value false is returned for failure.
    */
   bool init(uint8_t part);
+#if ENABLE_WARM_MOUNT
+  /** Initialize a FAT volume from parameters saved by saveGeometry().
+   *
+   * The boot sector is read and checked against \a geo.  FSINFO is not
+   * read so the free cluster count is found by a FAT scan if needed.
+   *
+   * \param[in] geo Saved volume parameters.
+   * \return The value true is returned for success and
+   * the value false is returned if the volume has changed or an error
+   * occurs.
+   */
+  bool initWarm(const FatGeometry_t* geo);
+  /** Save volume parameters for a later initWarm().
+   *
+   * \param[out] geo Location for the parameters.
+   * \return true for success or false if the volume is not initialized.
+   */
+  bool saveGeometry(FatGeometry_t* geo);
+#endif  // ENABLE_WARM_MOUNT
+#if USE_AU_ALLOC
+  /** \return Blocks in the allocation unit set by setAllocUnit() or zero
+   * if allocation is not aligned.
+   */
+  uint32_t allocUnit() const {
+    return m_auClusters << m_clusterSizeShift;
+  }
+  /** Align cluster allocation to the allocation unit (AU) of the card.
+   *
+   * Contiguous files start at an AU boundary.  A file larger than an AU
+   * that can't grow into the next cluster continues in a free AU, and
+   * other allocations skip the free clusters of that AU.  Call after the
+   * volume is mounted, a mount turns alignment off.
+   *
+   * \param[in] blocks Number of blocks in an AU, a power of two.  Zero or
+   * a value less than two clusters turns alignment off.
+   */
+  void setAllocUnit(uint32_t blocks);
+#endif  // USE_AU_ALLOC
+#if USE_FREE_CLUSTER_BITMAP
+  /** Use a bitmap of free clusters for cluster allocation.  The bitmap
+   * holds one bit for each cluster in a window of the FAT.  It is filled
+   * from the FAT when allocation first looks at a cluster outside the
+   * window so allocation does not read FAT blocks for clusters in the
+   * window.
+   *
+   * \param[in] bitmap RAM for the bitmap.  The caller must keep it
+   * while the volume is in use.
+   *
+   * \param[in] size Size of \a bitmap in bytes.  Zero stops use of the
+   * bitmap.
+   */
+  void setFreeClusterBitmap(uint8_t* bitmap, size_t size) {
+    m_freeBitmap = bitmap;
+    m_freeBitmapSize = 8UL*size;
+    m_freeBitmapCount = 0;
+  }
+#endif  // USE_FREE_CLUSTER_BITMAP
+#if USE_CACHE_STORE
+  /** Use a second level cache for blocks read through the volume cache.
+   * Directory, FAT and partial data blocks are found in the store after
+   * the first read.  Blocks are placed in slot block % \a count.  Cache
+   * writes are also written to the store so it never holds data that
+   * differs from the device.  Call cacheClear() before writes that
+   * bypass the volume, card()->writeBlock() for example.
+   *
+   * \param[in] store The store or null to stop use of a store.
+   *
+   * \param[in] tag RAM for the block number of each slot.  The caller
+   * must keep it while the volume is in use.
+   *
+   * \param[in] count Number of slots in \a store and entries in \a tag.
+   */
+  void setCacheStore(FatCacheStore* store, uint32_t* tag, uint16_t count) {
+    m_store = store;
+    m_storeTag = tag;
+    m_storeCount = store ? count : 0;
+    storeInvalidate(0, 0XFFFFFFFF);
+  }
+#endif  // USE_CACHE_STORE
+#if USE_DIR_HASH_INDEX
+  /** Use a table of name hashes to speed open() in large directories.
+   * The table is built by a scan of a directory the first time a file
+   * is opened in the directory.  Later opens in the same directory only
+   * read entries with a matching hash.  The table is rebuilt after a
+   * file is created or removed.  A rename in the same directory updates
+   * the table.
+   *
+   * \param[in] buf RAM for the table, four bytes for each file.  The
+   * caller must keep it while the volume is in use.
+   *
+   * \param[in] size Size of \a buf in bytes.  Zero stops use of the
+   * table.
+   */
+  void setDirHashIndex(void* buf, size_t size) {
+    size /= 4;
+    m_hashIndex = reinterpret_cast<uint16_t*>(buf);
+    m_hashIndexSize = size < 0X8000 ? size : 0X8000;
+    m_hashIndexValid = false;
+  }
+#endif  // USE_DIR_HASH_INDEX
+#if USE_FAT_SCAN_BUFFER
+  /** Use a buffer for sequential scans of the FAT.  freeClusterCount()
+   * and the search for free clusters by FatFile::createContiguous() read
+   * as many FAT blocks as fit in the buffer with one multi-block read.
+   *
+   * \param[in] buf Word aligned RAM for the buffer.  The caller must keep
+   * it while the volume is in use.
+   *
+   * \param[in] size Size of \a buf in bytes, a multiple of 512.  Less than
+   * 1024 stops use of the buffer.
+   */
+  void setFatScanBuffer(void* buf, size_t size) {
+    size /= 512;
+    m_fatScanBuf = reinterpret_cast<uint8_t*>(buf);
+    m_fatScanSize = size < 2 ? 0 : size < 0X100 ? size : 0XFF;
+  }
+#endif  // USE_FAT_SCAN_BUFFER
+#if ENABLE_LAZY_SYNC
+  /** Write the second FAT and FSINFO updates deferred by lazy sync.
+   *
+   * \return true for success else false.
+   */
+  bool commit();
+  /** \return true if lazy sync is enabled. */
+  bool lazySync() const {
+    return m_lazySync;
+  }
+  /** Defer metadata writes for high rate logging.
+   *
+   * With lazy sync FatFile::sync() writes file data and the first FAT
+   * but does not write the directory entry, blocks of the second FAT or
+   * the FAT32 FSINFO free count.  These are written by FatFile::commit(),
+   * FatFile::close() or commit().
+   *
+   * If power fails before a commit, the directory entry has the size
+   * from the last commit.  Data written since the commit is not in the
+   * file and its clusters are lost clusters that chkdsk can recover.
+   * The second FAT may differ from the first FAT.
+   *
+   * \param[in] enable Set true to enable lazy sync.  Call commit() after
+   * lazy sync is disabled.
+   */
+  void setLazySync(bool enable) {
+    m_lazySync = enable;
+  }
+#endif  // ENABLE_LAZY_SYNC
+#if ENABLE_ERASE_TRIM
+  /** Erase clusters freed by remove(), rmdir() and truncate().
+   *
+   * Runs of freed clusters are erased with one command each so later
+   * writes to them are faster.  Cards without single block erase only
+   * erase whole erase sectors in each run.
+   *
+   * \param[in] enable Set true to erase freed clusters.
+   */
+  void setTrim(bool enable) {
+    m_trim = enable;
+  }
+  /** \return true if freed clusters are erased. */
+  bool trim() const {
+    return m_trim;
+  }
+#endif  // ENABLE_ERASE_TRIM
   /** \return The number of entries in the root directory for FAT16 volumes. */
   uint16_t rootDirEntryCount() const {
     return m_rootDirEntryCount;
@@ -240,11 +638,53 @@ class FatVolume {
   uint32_t volumeBlockCount() const {
     return blocksPerCluster()*clusterCount();
   }
+#if ENABLE_LOCK_HOOKS
+  /** Set a lock for the cache and FAT of the volume.
+   *
+   * The lock is held by FatFile functions and FAT scans while they use
+   * the cache, the FAT or the device so several tasks may use files on
+   * the volume.  Take the lock before using the volume's device directly.
+   *
+   * \param[in] hook Lock hook or zero for none.
+   * \param[in] context Pointer passed to \a hook.
+   */
+  void setLock(lockHook_t hook, void* context = 0) {
+    m_lockHook = hook;
+    m_lockContext = context;
+  }
+#endif  // ENABLE_LOCK_HOOKS
+#if USE_APP_CACHE_BUFFER
+  /** Number of blocks in a buffer for setCacheBuffer(). */
+  static const uint8_t CACHE_BUFFER_BLOCKS =
+    CACHE_BLOCK_COUNT + (USE_SEPARATE_FAT_CACHE ? 1 : 0);
+  /** Lend a buffer to the volume for the cache.
+   *
+   * The buffer must be lent before the volume is mounted and while
+   * files are used.  Call setCacheBuffer(0) to write any dirty blocks
+   * and take the buffer back, for example to render a display row.
+   * Files stay open but fail to read or write until a buffer is lent
+   * again.
+   *
+   * \param[in] buf Buffer of CACHE_BUFFER_BLOCKS blocks or zero.
+   *
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool setCacheBuffer(cache_t* buf);
+#endif  // USE_APP_CACHE_BUFFER
   /** Wipe all data from the volume.
    * \param[in] pr print stream for status dots.
-   * \return true for success else false.
+   * \return true for success else false.  Always fails in
+   * FAT_READ_ONLY builds.
    */
+#if FAT_READ_ONLY
+  bool wipe(print_t* pr = 0) {
+    (void)pr;
+    return false;
+  }
+#else  // FAT_READ_ONLY
   bool wipe(print_t* pr = 0);
+#endif  // FAT_READ_ONLY
   /** Debug access to FAT table
    *
    * \param[in] n cluster number.
@@ -260,6 +700,10 @@ class FatVolume {
   friend class FatCache;
   friend class FatFile;
 //------------------------------------------------------------------------------
+#if ENABLE_LOCK_HOOKS
+  lockHook_t m_lockHook;           // Lock for cache, FAT and device.
+  void*    m_lockContext;          // Argument for m_lockHook.
+#endif  // ENABLE_LOCK_HOOKS
   uint8_t  m_blocksPerCluster;     // Cluster size in blocks.
   uint8_t  m_clusterBlockMask;     // Mask to extract block of cluster.
   uint8_t  m_clusterSizeShift;     // Cluster count to block count shift.
@@ -271,58 +715,306 @@ class FatVolume {
   uint32_t m_fatStartBlock;        // Start block for first FAT.
   uint32_t m_lastCluster;          // Last cluster number in FAT.
   uint32_t m_rootDirStart;         // Start block for FAT16, cluster for FAT32.
+#if ENABLE_WARM_MOUNT
+  uint32_t m_volumeStartBlock;     // Boot sector block.
+  uint32_t m_bootCheck;            // Check value for boot sector.
+#endif  // ENABLE_WARM_MOUNT
+#if MAINTAIN_FREE_CLUSTER_COUNT
+  int32_t  m_freeClusterCount;     // Count of free clusters, -1 if unknown.
+  uint32_t m_fsInfoBlock;          // FAT32 FSINFO block, zero if none.
+  bool     m_fsInfoDirty;          // FSINFO must be written by sync.
+#endif  // MAINTAIN_FREE_CLUSTER_COUNT
+#if USE_AU_ALLOC
+  uint32_t m_auClusters;           // Clusters in an AU, zero if not aligned.
+  uint32_t m_auBase;               // First cluster at an AU boundary.
+  uint32_t m_auSearchStart;        // Start cluster for AU aligned search.
+  uint32_t m_auReserve;            // First cluster of AU of last stream.
+#endif  // USE_AU_ALLOC
+#if USE_FREE_CLUSTER_BITMAP
+  uint8_t* m_freeBitmap;           // One bit for each cluster, set if free.
+  uint32_t m_freeBitmapSize;       // Number of clusters that fit in bitmap.
+  uint32_t m_freeBitmapStart;      // First cluster in bitmap.
+  uint32_t m_freeBitmapCount;      // Clusters in bitmap, zero if not filled.
+#endif  // USE_FREE_CLUSTER_BITMAP
+#if ENABLE_LAZY_SYNC
+  bool     m_lazySync;             // Defer metadata writes to commit().
+  uint32_t m_mirrorFirst;          // First FAT block not in second FAT.
+  uint32_t m_mirrorLast;           // Last FAT block not in second FAT or zero.
+#endif  // ENABLE_LAZY_SYNC
+#if ENABLE_ERASE_TRIM
+  bool     m_trim;                 // Erase clusters freed by freeChain().
+#endif  // ENABLE_ERASE_TRIM
+#if PATH_CACHE_SIZE
+  path_cache_t m_pathCache[PATH_CACHE_SIZE];  // Resolved directory paths.
+  uint8_t m_pathCacheNext;                    // Next entry to replace.
+#endif  // PATH_CACHE_SIZE
+#if USE_DIR_HASH_INDEX
+  uint16_t* m_hashIndex;           // Pairs of name hash and entry index.
+  uint16_t m_hashIndexSize;        // Number of pairs that fit in table.
+  uint16_t m_hashIndexCount;       // Pairs in table, above size if too many.
+  uint32_t m_hashIndexCluster;     // First cluster of directory in table.
+  bool     m_hashIndexValid;       // Table matches the directory.
+#endif  // USE_DIR_HASH_INDEX
+#if USE_FAT_SCAN_BUFFER
+  uint8_t* m_fatScanBuf;           // Buffer for runs of FAT blocks.
+  uint8_t  m_fatScanSize;          // Number of blocks that fit in buffer.
+  uint8_t  m_fatScanCount;         // Blocks in buffer, zero if empty.
+  bool     m_fatScanActive;        // Read FAT blocks through the buffer.
+  uint32_t m_fatScanStart;         // First block in buffer.
+  cache_t* fatScanFetch(uint32_t blockNumber);
+  // Start or end a scan of the FAT with no FAT writes during the scan.
+  void fatScan(bool active) {
+    m_fatScanActive = active && m_fatScanSize;
+    m_fatScanCount = 0;
+  }
+#else  // USE_FAT_SCAN_BUFFER
+  void fatScan(bool active) {}
+#endif  // USE_FAT_SCAN_BUFFER
+#if USE_CACHE_STORE
+  FatCacheStore* m_store;          // Second level cache.
+  uint32_t* m_storeTag;            // Block in each slot, 0XFFFFFFFF if none.
+  uint16_t m_storeCount;           // Number of slots, zero if no store.
+  bool storeRead(uint32_t lbn, uint8_t* dst);
+  void storeInvalidate(uint32_t lbn, uint32_t count);
+  void storeUpdate(uint32_t lbn, const uint8_t* src);
+#else  // USE_CACHE_STORE
+  bool storeRead(uint32_t lbn, uint8_t* dst) {
+    return readBlock(lbn, dst);
+  }
+  void storeInvalidate(uint32_t lbn, uint32_t count) {}
+  void storeUpdate(uint32_t lbn, const uint8_t* src) {}
+#endif  // USE_CACHE_STORE
 //------------------------------------------------------------------------------
 // block caches
-  FatCache m_cache;
+  FatCache m_cache[CACHE_BLOCK_COUNT];
+#if CACHE_BLOCK_COUNT > 1
+  FatCache* m_curCache;                     // Most recently fetched entry.
+  uint16_t m_cacheTick;                     // Fetch count for LRU ages.
+  uint16_t m_cacheUse[CACHE_BLOCK_COUNT];   // Tick of last use of entry.
+  cache_t* cacheFetchData(uint32_t blockNumber, uint8_t options);
+  FatCache* cacheCurrent() {
+    return m_curCache;
+  }
+#else  // CACHE_BLOCK_COUNT > 1
+  cache_t* cacheFetchData(uint32_t blockNumber, uint8_t options) {
+    cacheCount(m_cache, blockNumber);
+    return m_cache[0].read(blockNumber, options);
+  }
+  FatCache* cacheCurrent() {
+    return m_cache;
+  }
+#endif  // CACHE_BLOCK_COUNT > 1
+#if ENABLE_CACHE_STATS
+  uint32_t m_cacheHits;                     // Fetches found in cache.
+  uint32_t m_cacheMisses;                   // Fetches read from device.
+  uint32_t m_cacheWritebacks;               // Dirty blocks written.
+  uint32_t m_fatGets;                       // Calls to fatGet().
+  void cacheCount(FatCache* pc, uint32_t blockNumber) {
+    if (pc->lbn() == blockNumber) {
+      m_cacheHits++;
+    } else {
+      m_cacheMisses++;
+    }
+  }
+#else  // ENABLE_CACHE_STATS
+  void cacheCount(FatCache*, uint32_t) {}
+#endif  // ENABLE_CACHE_STATS
+  bool cacheSyncData() {
+    return cacheCurrent()->sync();
+  }
+  bool cacheSyncAll() {
+    for (uint8_t i = 0; i < CACHE_BLOCK_COUNT; i++) {
+      if (!m_cache[i].sync()) {
+        return false;
+      }
+    }
+    return true;
+  }
+#if MAINTAIN_FREE_CLUSTER_COUNT
+  bool fsInfoSync();
+  void updateFreeClusterCount(int32_t change) {
+    if (m_freeClusterCount >= 0) {
+      m_freeClusterCount += change;
+    }
+    m_fsInfoDirty = m_fsInfoBlock != 0;
+  }
+  bool cacheSyncFsInfo() {
+#if ENABLE_LAZY_SYNC
+    if (m_lazySync) {
+      // Written by commit().
+      return true;
+    }
+#endif  // ENABLE_LAZY_SYNC
+    return !m_fsInfoDirty || fsInfoSync();
+  }
+#else  // MAINTAIN_FREE_CLUSTER_COUNT
+  void updateFreeClusterCount(int32_t change) {}
+  bool cacheSyncFsInfo() {
+    return true;
+  }
+#endif  // MAINTAIN_FREE_CLUSTER_COUNT
+#if USE_FREE_CLUSTER_BITMAP
+  bool freeBitmapFill(uint32_t cluster);
+  void freeBitmapPut(uint32_t cluster, bool free) {
+    uint32_t i = cluster - m_freeBitmapStart;
+    if (i < m_freeBitmapCount) {
+      if (free) {
+        m_freeBitmap[i >> 3] |= 1 << (i & 7);
+      } else {
+        m_freeBitmap[i >> 3] &= ~(1 << (i & 7));
+      }
+    }
+  }
+#endif  // USE_FREE_CLUSTER_BITMAP
+#if USE_DIR_HASH_INDEX
+  bool hashIndexAdd(uint16_t hash, uint16_t index);
+  bool hashIndexFind(uint16_t hash, uint16_t* slot, uint16_t* index);
+  void hashIndexInvalidate() {
+    m_hashIndexValid = false;
+  }
+#else  // USE_DIR_HASH_INDEX
+  void hashIndexInvalidate() {}
+#endif  // USE_DIR_HASH_INDEX
+#if PATH_CACHE_SIZE
+  void pathCacheInvalidate() {
+    for (uint8_t i = 0; i < PATH_CACHE_SIZE; i++) {
+      m_pathCache[i].len = 0;
+    }
+    m_pathCacheNext = 0;
+  }
+#else  // PATH_CACHE_SIZE
+  void pathCacheInvalidate() {}
+#endif  // PATH_CACHE_SIZE
+#if ENABLE_LAZY_SYNC
+  void fatMirrorDefer(uint32_t lbn) {
+    if (m_mirrorLast == 0) {
+      m_mirrorFirst = m_mirrorLast = lbn;
+    } else if (lbn < m_mirrorFirst) {
+      m_mirrorFirst = lbn;
+    } else if (lbn > m_mirrorLast) {
+      m_mirrorLast = lbn;
+    }
+  }
+#endif  // ENABLE_LAZY_SYNC
+  int8_t fatIsFree(uint32_t cluster);
+  int8_t fatRun(uint32_t cluster, uint32_t* count);
 #if USE_SEPARATE_FAT_CACHE
   FatCache m_fatCache;
   cache_t* cacheFetchFat(uint32_t blockNumber, uint8_t options) {
+#if USE_FAT_SCAN_BUFFER
+    if (m_fatScanActive && options == FatCache::CACHE_FOR_READ) {
+      cache_t* pc = fatScanFetch(blockNumber);
+      if (pc) {
+        return pc;
+      }
+    }
+#endif  // USE_FAT_SCAN_BUFFER
+    cacheCount(&m_fatCache, blockNumber);
     return m_fatCache.read(blockNumber,
                            options | FatCache::CACHE_STATUS_MIRROR_FAT);
   }
   bool cacheSync() {
-    return m_cache.sync() && m_fatCache.sync();
+    return cacheSyncFsInfo() && cacheSyncAll() && m_fatCache.sync();
   }
 #else  //
   cache_t* cacheFetchFat(uint32_t blockNumber, uint8_t options) {
+#if USE_FAT_SCAN_BUFFER
+    if (m_fatScanActive && options == FatCache::CACHE_FOR_READ) {
+      cache_t* pc = fatScanFetch(blockNumber);
+      if (pc) {
+        return pc;
+      }
+    }
+#endif  // USE_FAT_SCAN_BUFFER
     return cacheFetchData(blockNumber,
                           options | FatCache::CACHE_STATUS_MIRROR_FAT);
   }
   bool cacheSync() {
-    return m_cache.sync();
+    return cacheSyncFsInfo() && cacheSyncAll();
   }
 #endif  // USE_SEPARATE_FAT_CACHE
-  cache_t* cacheFetchData(uint32_t blockNumber, uint8_t options) {
-    return m_cache.read(blockNumber, options);
-  }
   void cacheInvalidate() {
-    m_cache.invalidate();
+    cacheCurrent()->invalidate();
   }
-  bool cacheSyncData() {
-    return m_cache.sync();
+  // Return true if a block in the range [lbn, lbn + count) is cached.
+  bool cacheInRange(uint32_t lbn, size_t count) {
+    for (uint8_t i = 0; i < CACHE_BLOCK_COUNT; i++) {
+      if ((m_cache[i].lbn() - lbn) < count) {
+        return true;
+      }
+    }
+    return false;
+  }
+  // Invalidate cached blocks in the range [lbn, lbn + count) before the
+  // blocks are written to the device.
+  void cacheInvalidate(uint32_t lbn, size_t count) {
+    for (uint8_t i = 0; i < CACHE_BLOCK_COUNT; i++) {
+      if ((m_cache[i].lbn() - lbn) < count) {
+        m_cache[i].invalidate();
+      }
+    }
+    storeInvalidate(lbn, count);
   }
   cache_t *cacheAddress() {
-    return m_cache.block();
+    return cacheCurrent()->block();
   }
   uint32_t cacheBlockNumber() {
-    return m_cache.lbn();
+    return cacheCurrent()->lbn();
   }
   void cacheDirty() {
-    m_cache.dirty();
+    cacheCurrent()->dirty();
   }
 //------------------------------------------------------------------------------
-  bool allocateCluster(uint32_t current, uint32_t* next);
+  void initState();
+#if FAT_READ_ONLY
+  // Cluster allocation and FAT updates are removed from read-only builds.
+  bool allocateCluster(uint32_t current, uint32_t* next,
+                       bool stream = false) {
+    return false;
+  }
+  bool allocContiguous(uint32_t count, uint32_t* firstCluster) {
+    return false;
+  }
+#else  // FAT_READ_ONLY
+  bool allocateCluster(uint32_t current, uint32_t* next,
+                       bool stream = false);
   bool allocContiguous(uint32_t count, uint32_t* firstCluster);
+#endif  // FAT_READ_ONLY
+#if USE_AU_ALLOC
+  // First AU aligned cluster at or after cluster.
+  uint32_t auCeil(uint32_t cluster) const {
+    return cluster <= m_auBase ? m_auBase : m_auBase +
+           ((cluster - m_auBase + m_auClusters - 1) & ~(m_auClusters - 1));
+  }
+  // First cluster of the AU that holds cluster.
+  uint32_t auFloor(uint32_t cluster) const {
+    return cluster < m_auBase ? 2 :
+           cluster - ((cluster - m_auBase) & (m_auClusters - 1));
+  }
+  int8_t auFind(uint32_t count, uint32_t* firstCluster);
+#endif  // USE_AU_ALLOC
   uint8_t blockOfCluster(uint32_t position) const {
     return (position >> 9) & m_clusterBlockMask;
   }
   uint32_t clusterStartBlock(uint32_t cluster) const;
   int8_t fatGet(uint32_t cluster, uint32_t* value);
+#if FAT_READ_ONLY
+  bool fatPut(uint32_t cluster, uint32_t value) {
+    return false;
+  }
+  bool freeChain(uint32_t cluster) {
+    return false;
+  }
+#else  // FAT_READ_ONLY
   bool fatPut(uint32_t cluster, uint32_t value);
+  bool freeChain(uint32_t cluster);
+#endif  // FAT_READ_ONLY
   bool fatPutEOC(uint32_t cluster) {
     return fatPut(cluster, 0x0FFFFFFF);
   }
-  bool freeChain(uint32_t cluster);
+#if ENABLE_ERASE_TRIM
+  bool eraseClusters(uint32_t cluster, uint32_t count);
+#endif  // ENABLE_ERASE_TRIM
   bool isEOC(uint32_t cluster) const {
     return cluster > m_lastCluster;
   }
@@ -334,5 +1026,39 @@ class FatVolume {
   virtual bool readBlocks(uint32_t block, uint8_t* dst, size_t nb) = 0;
   virtual bool writeBlocks(uint32_t block, const uint8_t* src, size_t nb) = 0;
 #endif  // USE_MULTI_BLOCK_IO
+  // Pass a block to sink.  Default reads the block into the cache.
+  virtual bool readBlockSink(uint32_t block, readSink_t sink, void* context);
+#if ENABLE_ASYNC_READ
+  // Start an async read.  Default reads the blocks before returning.
+  virtual bool readBlocksAsync(uint32_t block, uint8_t* dst, size_t nb,
+                               readDone_t callback, void* context);
+  // Return one if done, zero if busy, or minus one for failure.
+  virtual int8_t readAsyncStatus() {
+    return 1;
+  }
+#endif  // ENABLE_ASYNC_READ
+  // End any transfer the device has left open between calls.
+  virtual bool syncBlocks() {
+    return true;
+  }
+  // Return true if the device is busy programming written data.
+  virtual bool isBusy() {
+    return false;
+  }
+  // Start a run of sequential writes at block and pre-erase eraseCount
+  // blocks.  Default does nothing.
+  virtual bool writeStart(uint32_t block, uint32_t eraseCount) {
+    (void)block;
+    (void)eraseCount;
+    return true;
+  }
+#if ENABLE_ERASE_TRIM
+  // Erase blocks firstBlock through lastBlock.  Default does nothing.
+  virtual bool eraseBlocks(uint32_t firstBlock, uint32_t lastBlock) {
+    (void)firstBlock;
+    (void)lastBlock;
+    return true;
+  }
+#endif  // ENABLE_ERASE_TRIM
 };
 #endif  // FatVolume
@@ -207,30 +207,55 @@ char* fmtDec(uint16_t n, char* p) {
   return p;
 }
 //------------------------------------------------------------------------------
-// format 32-bit unsigned
-char* fmtDec(uint32_t n, char* p) {
-  while (n >> 16) {
+// Divide 32-bit unsigned by ten and return the remainder
+static inline uint8_t divmod10(uint32_t* pn) {
+  uint32_t n = *pn;
 #ifdef USE_STIMMER
-    uint8_t tmp8, r;
-    divmod10_asm32(n, r, tmp8);
+  uint8_t tmp8, r;
+  divmod10_asm32(n, r, tmp8);
 #else  //  USE_STIMMER
-    uint32_t t = n;
-    n = (n >> 1) + (n >> 2);
-    n = n + (n >> 4);
-    n = n + (n >> 8);
-    n = n + (n >> 16);
-    n = n >> 3;
-    uint8_t r = t - (((n << 2) + n) << 1);
-    if (r > 9) {
-      n++;
-      r -= 10;
-    }
+  uint32_t t = n;
+  n = (n >> 1) + (n >> 2);
+  n = n + (n >> 4);
+  n = n + (n >> 8);
+  n = n + (n >> 16);
+  n = n >> 3;
+  uint8_t r = t - (((n << 2) + n) << 1);
+  if (r > 9) {
+    n++;
+    r -= 10;
+  }
 #endif  // USE_STIMMER
-    *--p = r + '0';
+  *pn = n;
+  return r;
+}
+//------------------------------------------------------------------------------
+// format 32-bit unsigned
+char* fmtDec(uint32_t n, char* p) {
+  while (n >> 16) {
+    *--p = divmod10(&n) + '0';
   }
   return fmtDec((uint16_t)n, p);
 }
 //------------------------------------------------------------------------------
+// Format fixed point, value is the number times 10^places.  No floating
+// point math is used.  Stores at most 12 characters for places <= 9.
+char* fmtFixed(int32_t value, char* p, uint8_t places) {
+  bool neg = value < 0;
+  uint32_t n = neg ? -(uint32_t)value : value;
+  if (places) {
+    while (places--) {
+      *--p = divmod10(&n) + '0';
+    }
+    *--p = '.';
+  }
+  p = fmtDec(n, p);
+  if (neg) {
+    *--p = '-';
+  }
+  return p;
+}
+//------------------------------------------------------------------------------
 char* fmtFloat(float value, char* p, uint8_t prec) {
   char sign = value < 0 ? '-' : 0;
   if (sign) {
@@ -451,5 +476,39 @@ float scanFloat(const char* str, char** ptr) {
 fail:
   return 0;
 }
+//------------------------------------------------------------------------------
+int32_t scanDec(const char* str, char** ptr) {
+  uint32_t v = 0;
+  uint8_t cutlim;
+  bool neg;
+  int c;
+
+  if (ptr) {
+    *ptr = const_cast<char*>(str);
+  }
+  while (isSpace((c = *str++))) {}
+  neg = c == '-';
+  if (c == '-' || c == '+') {
+    c = *str++;
+  }
+  if (!isDigit(c)) {
+    return 0;
+  }
+  // last digit limit for 2147483647 or -2147483648
+  cutlim = neg ? 8 : 7;
+  do {
+    uint8_t d = c - '0';
+    if (v > 214748364UL || (v == 214748364UL && d > cutlim)) {
+      // overflow
+      return 0;
+    }
+    v = 10*v + d;
+    c = *str++;
+  } while (isDigit(c));
+  if (ptr) {
+    *ptr = const_cast<char*>(str - 1);
+  }
+  return neg ? -v : v;
+}
 
 
@@ -30,9 +30,11 @@ inline bool isSpace(char c) {
 #include <stdint.h>
 char* fmtDec(uint16_t n, char* p);
 char* fmtDec(uint32_t n, char* p);
+char* fmtFixed(int32_t value, char* p, uint8_t places);
 char* fmtFloat(float value, char* p, uint8_t prec);
 char* fmtFloat(float value, char* ptr, uint8_t prec, char expChar);
 char* fmtHex(uint32_t n, char* p);
 float scale10(float v, int8_t n);
 float scanFloat(const char* str, char** ptr);
+int32_t scanDec(const char* str, char** ptr);
 #endif  // FmtNumber_h
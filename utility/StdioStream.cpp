@@ -136,7 +136,7 @@ bool StdioStream::fopen(const char* path, const char* mode) {
   }
   m_r = 0;
   m_w = 0;
-  m_p = m_buf;
+  m_p = m_base;
   return true;
 
 fail:
@@ -195,7 +195,7 @@ int StdioStream::fseek(int32_t offset, int origin) {
       goto fail;
     }
     pos += offset;
-    if (!FatFile::seekCur(pos)) {
+    if (!FatFile::seekSet(pos)) {
       goto fail;
     }
     break;
@@ -216,7 +216,7 @@ int StdioStream::fseek(int32_t offset, int origin) {
     goto fail;
   }
   m_r = 0;
-  m_p = m_buf;
+  m_p = m_base;
   return 0;
 
 fail:
@@ -231,7 +231,7 @@ int32_t StdioStream::ftell() {
     }
     pos -= m_r;
   } else if (m_flags & F_SWR) {
-    pos += m_p - m_buf;
+    pos += m_p - m_base;
   }
   return pos;
 }
@@ -271,7 +271,7 @@ int StdioStream::write(const void* buf, size_t count) {
     m_p += m_w;
     src += m_w;
     todo -= m_w;
-    if (!flushBuf()) {
+    if (!flushBlocks()) {
       return EOF;
     }
   }
@@ -437,6 +437,38 @@ int StdioStream::printDec(int32_t n) {
   return rtn > 0 ? rtn + s : -1;
 }
 //------------------------------------------------------------------------------
+int StdioStream::printFixed(int32_t value, uint8_t places) {
+  char buf[24];
+  if (places > 9) {
+    places = 9;
+  }
+  char* ptr = fmtFixed(value, buf + sizeof(buf), places);
+  return write(ptr, buf + sizeof(buf) - ptr);
+}
+//------------------------------------------------------------------------------
+int StdioStream::printRow(const int32_t* value, uint8_t count,
+                          uint8_t places, char sep) {
+  // fields are formatted in the stream buffer
+  int rtn = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    int n = printFixed(value[i], places);
+    if (n < 0) {
+      return -1;
+    }
+    rtn += n;
+    if ((i + 1) < count) {
+      if (putc(sep) < 0) {
+        return -1;
+      }
+      rtn++;
+    }
+  }
+  if (putCRLF() < 0) {
+    return -1;
+  }
+  return rtn + 2;
+}
+//------------------------------------------------------------------------------
 int StdioStream::printDec(uint32_t n) {
 #ifdef NEW_WAY
   char buf[10];
@@ -490,6 +522,17 @@ int StdioStream::printHex(uint32_t n) {
 #endif
 }
 //------------------------------------------------------------------------------
+// private - discard buffered data and switch to read for readNumbers()
+bool StdioStream::readBegin() {
+  if (!(m_flags & (F_SRD | F_SRW)) || fseek(0, SEEK_CUR)) {
+    return false;
+  }
+  m_flags &= ~F_SWR;
+  m_flags |= F_SRD;
+  m_w = 0;
+  return true;
+}
+//------------------------------------------------------------------------------
 bool StdioStream::rewind() {
   if (m_flags & F_SWR) {
     if (!flushBuf()) {
@@ -501,6 +544,22 @@ bool StdioStream::rewind() {
   return true;
 }
 //------------------------------------------------------------------------------
+bool StdioStream::setBuffer(void* buf, size_t size) {
+  if (m_flags) {
+    return false;
+  }
+  if (!buf) {
+    buf = m_buf;
+    size = sizeof(m_buf);
+  }
+  if (size <= UNGETC_BUF_SIZE) {
+    return false;
+  }
+  m_base = m_p = reinterpret_cast<uint8_t*>(buf);
+  m_size = size < STREAM_BUF_MAX ? size : STREAM_BUF_MAX;
+  return true;
+}
+//------------------------------------------------------------------------------
 int StdioStream::ungetc(int c) {
   // error if EOF.
   if (c == EOF) {
@@ -511,7 +570,7 @@ int StdioStream::ungetc(int c) {
     return EOF;
   }
   // error if no space.
-  if (m_p == m_buf) {
+  if (m_p == m_base) {
     return EOF;
   }
   m_r++;
@@ -546,8 +605,8 @@ bool StdioStream::fillBuf() {
       m_w = 0;
     }
   }
-  m_p = m_buf + UNGETC_BUF_SIZE;
-  int nr = FatFile::read(m_p, sizeof(m_buf) - UNGETC_BUF_SIZE);
+  m_p = m_base + UNGETC_BUF_SIZE;
+  int nr = FatFile::read(m_p, m_size - UNGETC_BUF_SIZE);
   if (nr <= 0) {
     m_flags |= nr < 0 ? F_ERR : F_EOF;
     m_r = 0;
@@ -568,22 +627,41 @@ bool StdioStream::flushBuf() {
     m_flags &= ~F_SRD;
     m_flags |= F_SWR;
     m_r = 0;
-    m_w = sizeof(m_buf);
-    m_p = m_buf;
+    m_w = m_size;
+    m_p = m_base;
     return true;
   }
-  uint8_t n = m_p - m_buf;
-  m_p = m_buf;
-  m_w = sizeof(m_buf);
-  if (FatFile::write(m_buf, n) == n) {
+  uint16_t n = m_p - m_base;
+  m_p = m_base;
+  m_w = m_size;
+  if (FatFile::write(m_base, n) == n) {
     return true;
   }
   m_flags |= F_ERR;
   return false;
 }
 //------------------------------------------------------------------------------
+// private - write the part of a full buffer that ends on a block boundary
+bool StdioStream::flushBlocks() {
+  if (!(m_flags & F_SWR) || m_size < 1024) {
+    return flushBuf();
+  }
+  uint16_t n = m_p - m_base;
+  uint16_t r = (FatFile::curPosition() + n) & 0X1FF;
+  n -= r;
+  if (FatFile::write(m_base, n) != n) {
+    m_flags |= F_ERR;
+    return false;
+  }
+  // keep the partial block for the next write
+  memmove(m_base, m_base + n, r);
+  m_p = m_base + r;
+  m_w = m_size - r;
+  return true;
+}
+//------------------------------------------------------------------------------
 int StdioStream::flushPut(uint8_t c) {
-  if (!flushBuf()) {
+  if (!flushBlocks()) {
     return EOF;
   }
   m_w--;
@@ -592,7 +670,7 @@ int StdioStream::flushPut(uint8_t c) {
 //------------------------------------------------------------------------------
 char* StdioStream::fmtSpace(uint8_t len) {
   if (m_w < len) {
-    if (!flushBuf() || m_w < len) {
+    if (!flushBlocks() || m_w < len) {
       return 0;
     }
   }
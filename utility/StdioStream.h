@@ -32,6 +32,14 @@
 const uint8_t STREAM_BUF_SIZE = 64;
 /** Amount of buffer allocated for ungetc during input. */
 const uint8_t UNGETC_BUF_SIZE = 2;
+/** Largest buffer for setBuffer().  A buffer read or write must fit the
+  * int returned by FatFile::read() and FatFile::write().
+  */
+#if INT_MAX < 0XFE00
+const uint16_t STREAM_BUF_MAX = INT_MAX & ~0X1FF;
+#else  // INT_MAX < 0XFE00
+const uint16_t STREAM_BUF_MAX = 0XFE00;
+#endif  // INT_MAX < 0XFE00
 //------------------------------------------------------------------------------
 // Get rid of any macros defined in <stdio.h>.
 #include <stdio.h>
@@ -111,7 +119,8 @@ class StdioStream : private FatFile {
    */
   StdioStream() {
     m_w = m_r = 0;
-    m_p = m_buf;
+    m_p = m_base = m_buf;
+    m_size = sizeof(m_buf);
     m_flags = 0;
   }
   //----------------------------------------------------------------------------
@@ -385,7 +394,7 @@ class StdioStream : private FatFile {
   inline __attribute__((always_inline))
   int putCRLF() {
     if (m_w < 2) {
-      if (!flushBuf()) {
+      if (!flushBlocks()) {
         return -1;
       }
     }
@@ -602,6 +611,34 @@ class StdioStream : private FatFile {
     return rtn < 0 || putc(term) < 0 ? -1 : rtn + 1;
   }
   //----------------------------------------------------------------------------
+  /** Print a fixed point number with integer math only.
+   * \param[in] value The number times 10^places.
+   * \param[in] places Number of digits after decimal point.
+   * \return The number of bytes written or -1 if an error occurs.
+   */
+  int printFixed(int32_t value, uint8_t places);
+  //----------------------------------------------------------------------------
+  /** Print a fixed point number followed by a field terminator.
+   * \param[in] value The number times 10^places.
+   * \param[in] term The field terminator.
+   * \param[in] places Number of digits after decimal point.
+   * \return The number of bytes written or -1 if an error occurs.
+   */
+  int printFieldFixed(int32_t value, char term, uint8_t places) {
+    int rtn = printFixed(value, places);
+    return rtn < 0 || putc(term) < 0 ? -1 : rtn + 1;
+  }
+  //----------------------------------------------------------------------------
+  /** Print a row of fixed point numbers followed by CR/LF.
+   * \param[in] value Array of numbers, each times 10^places.
+   * \param[in] count Number of elements in \a value.
+   * \param[in] places Number of digits after decimal point.
+   * \param[in] sep The field separator.
+   * \return The number of bytes written or -1 if an error occurs.
+   */
+  int printRow(const int32_t* value, uint8_t count,
+               uint8_t places = 0, char sep = ',');
+  //----------------------------------------------------------------------------
   /** Print HEX
    * \param[in] n number to be printed as HEX.
    *
@@ -619,6 +656,32 @@ class StdioStream : private FatFile {
     return  rtn < 0 || putCRLF() != 2 ? -1 : rtn + 2;
   }
   //----------------------------------------------------------------------------
+  /** Read decimal integers into an array.
+   *
+   * Numbers are parsed in place in the stream buffer, a buffer supplied
+   * with setBuffer() makes large tables load faster.  See
+   * FatFile::readNumbers().
+   *
+   * \param[out] value Array that will receive the numbers.
+   * \param[in] count Maximum number of values to read.
+   *
+   * \return The number of values read or -1 if an error occurs.
+   */
+  int readNumbers(int32_t* value, size_t count) {
+    return readNumbersT(value, count);
+  }
+  //----------------------------------------------------------------------------
+  /** Read floating point numbers into an array.
+   *
+   * \param[out] value Array that will receive the numbers.
+   * \param[in] count Maximum number of values to read.
+   *
+   * \return The number of values read or -1 if an error occurs.
+   */
+  int readNumbers(float* value, size_t count) {
+    return readNumbersT(value, count);
+  }
+  //----------------------------------------------------------------------------
   /** Set position of a stream to the beginning.
    *
    * The rewind function sets the file position to the beginning of the
@@ -644,13 +707,39 @@ class StdioStream : private FatFile {
    * back after conversion. Otherwise it returns EOF.
    */
   int ungetc(int c);
+  //----------------------------------------------------------------------------
+  /** Use a user supplied buffer for the stream.
+   *
+   * A buffer of 1024 bytes or more makes output flush whole blocks at
+   * block boundaries of the file so FatFile::write() can use multiple
+   * block writes.  Sizes that are a multiple of 512 work best.
+   *
+   * \param[in] buf The buffer or null to use the internal buffer.  Must
+   * remain valid until the stream is closed.
+   * \param[in] size Size of \a buf in bytes, more than UNGETC_BUF_SIZE.
+   * At most STREAM_BUF_MAX bytes are used, 32256 if int is 16 bits.
+   *
+   * \return true for success or false if the stream is open or \a size is
+   * too small.
+   */
+  bool setBuffer(void* buf, size_t size);
   //============================================================================
  private:
   bool fillBuf();
   int fillGet();
+  bool flushBlocks();
   bool flushBuf();
   int flushPut(uint8_t c);
   char* fmtSpace(uint8_t len);
+  bool readBegin();
+  template <typename T> int readNumbersT(T* value, size_t count) {
+    int n = readBegin() ? FatFile::readNumbers(value, count,
+                          reinterpret_cast<char*>(m_base), m_size) : -1;
+    if (n < 0) {
+      m_flags |= F_ERR;
+    }
+    return n;
+  }
   int write(const void* buf, size_t count);
   //----------------------------------------------------------------------------
   // F_SRD and F_WR are never simultaneously asserted
@@ -662,8 +751,10 @@ class StdioStream : private FatFile {
   //----------------------------------------------------------------------------
   uint8_t  m_flags;
   uint8_t* m_p;
-  uint8_t  m_r;
-  uint8_t  m_w;
+  uint8_t* m_base;                 // Current buffer.
+  uint16_t m_size;                 // Size of current buffer.
+  uint16_t m_r;
+  uint16_t m_w;
   uint8_t  m_buf[STREAM_BUF_SIZE];
 };
 //------------------------------------------------------------------------------
@@ -21,10 +21,9 @@
 //==============================================================================
 /// @cond SHOW_PROTECTED
 int16_t FatStreamBase::getch() {
-  uint8_t c;
-  int8_t s = read(&c, 1);
-  if (s != 1) {
-    if (s < 0) {
+  int16_t c = readByte();
+  if (c < 0) {
+    if (c < -1) {
       setstate(badbit);
     } else {
       setstate(eofbit);
@@ -34,15 +33,81 @@ int16_t FatStreamBase::getch() {
   if (c != '\r' || (getmode() & ios::binary)) {
     return c;
   }
-  s = read(&c, 1);
-  if (s == 1 && c == '\n') {
+  c = readByte();
+  if (c == '\n') {
     return c;
   }
-  if (s == 1) {
+  if (c >= 0) {
+#if FSTREAM_READ_BUF_SIZE
+    m_rdIdx--;
+#else  // FSTREAM_READ_BUF_SIZE
     seekCur(-1);
+#endif  // FSTREAM_READ_BUF_SIZE
   }
   return '\r';
 }
+#if FSTREAM_READ_BUF_SIZE
+//------------------------------------------------------------------------------
+void FatStreamBase::getpos(FatPos_t* pos) {
+  if (m_rdIdx == 0 && m_rdCount) {
+    *pos = m_rdStart;
+  } else {
+    // The window is in one cluster so the current cluster is correct.
+    FatFile::getpos(pos);
+    pos->position -= m_rdCount - m_rdIdx;
+  }
+}
+//------------------------------------------------------------------------------
+// Move the file position back to the next unread character.
+void FatStreamBase::readDiscard() {
+  if (m_rdIdx < m_rdCount) {
+    FatPos_t pos;
+    getpos(&pos);
+    FatFile::setpos(&pos);
+  }
+  m_rdCount = 0;
+  m_rdIdx = 0;
+}
+//------------------------------------------------------------------------------
+void FatStreamBase::setpos(FatPos_t* pos) {
+  if (m_rdCount && pos->position >= m_rdStart.position &&
+      pos->position <= (m_rdStart.position + m_rdCount)) {
+    m_rdIdx = pos->position - m_rdStart.position;
+  } else {
+    m_rdCount = 0;
+    m_rdIdx = 0;
+    FatFile::setpos(pos);
+  }
+}
+#endif  // FSTREAM_READ_BUF_SIZE
+//------------------------------------------------------------------------------
+// Return next byte, -1 for EOF or -2 for an error.
+int16_t FatStreamBase::readByte() {
+#if FSTREAM_READ_BUF_SIZE
+  if (m_rdIdx >= m_rdCount) {
+    if (!isOpen()) {
+      return -2;
+    }
+    // Don't cross a cluster boundary so getpos() is simple.
+    uint32_t mask = (512UL << volume()->clusterSizeShift()) - 1;
+    uint32_t room = mask + 1 - (FatFile::curPosition() & mask);
+    size_t n = room < sizeof(m_rdBuf) ? room : sizeof(m_rdBuf);
+    FatFile::getpos(&m_rdStart);
+    int nr = read(m_rdBuf, n);
+    m_rdIdx = 0;
+    if (nr <= 0) {
+      m_rdCount = 0;
+      return nr < 0 ? -2 : -1;
+    }
+    m_rdCount = nr;
+  }
+  return m_rdBuf[m_rdIdx++];
+#else  // FSTREAM_READ_BUF_SIZE
+  uint8_t c;
+  int8_t s = read(&c, 1);
+  return s == 1 ? c : s < 0 ? -2 : -1;
+#endif  // FSTREAM_READ_BUF_SIZE
+}
 //------------------------------------------------------------------------------
 void FatStreamBase::open(const char* path, ios::openmode mode) {
   uint8_t flags;
@@ -80,6 +145,7 @@ void FatStreamBase::open(const char* path, ios::openmode mode) {
   if (mode & ios::ate) {
     flags |= O_AT_END;
   }
+  readReset();
   if (!FatFile::open(path, flags)) {
     goto fail;
   }
@@ -154,10 +220,12 @@ bool FatStreamBase::seekoff(off_type off, seekdir way) {
  * \param[in] pos
  */
 bool FatStreamBase::seekpos(pos_type pos) {
+  readDiscard();
   return seekSet(pos);
 }
 //------------------------------------------------------------------------------
 int FatStreamBase::write(const void* buf, size_t n) {
+  readDiscard();
   return FatFile::write(buf, n);
 }
 //------------------------------------------------------------------------------
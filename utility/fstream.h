@@ -33,6 +33,37 @@
 class FatStreamBase : protected FatFile, virtual public ios {
  protected:
   /// @cond SHOW_PROTECTED
+#if FSTREAM_READ_BUF_SIZE
+  FatStreamBase() : m_rdCount(0), m_rdIdx(0) {}
+  /** Internal do not use
+   * \return position of the next character to be read
+   */
+  uint32_t curPosition() {
+    return FatFile::curPosition() - (m_rdCount - m_rdIdx);
+  }
+  void getpos(FatPos_t* pos);
+  void readDiscard();
+  /** Internal do not use */
+  void readReset() {
+    m_rdCount = 0;
+    m_rdIdx = 0;
+  }
+  void setpos(FatPos_t* pos);
+#else  // FSTREAM_READ_BUF_SIZE
+  void getpos(FatPos_t* pos) {
+    FatFile::getpos(pos);
+  }
+  void readDiscard() {}
+  void readReset() {}
+  void setpos(FatPos_t* pos) {
+    FatFile::setpos(pos);
+  }
+#endif  // FSTREAM_READ_BUF_SIZE
+  /** Internal do not use */
+  void close() {
+    readReset();
+    FatFile::close();
+  }
   int16_t getch();
   void putch(char c);
   void putstr(const char *str);
@@ -55,7 +86,14 @@ class FatStreamBase : protected FatFile, virtual public ios {
   void write(char c);
   /// @endcond
  private:
+  int16_t readByte();
   ios::openmode m_mode;
+#if FSTREAM_READ_BUF_SIZE
+  FatPos_t m_rdStart;       // File position of m_rdBuf[0].
+  uint8_t m_rdCount;        // Bytes in m_rdBuf.
+  uint8_t m_rdIdx;          // Index of next byte in m_rdBuf.
+  uint8_t m_rdBuf[FSTREAM_READ_BUF_SIZE];  // Read window, in one cluster.
+#endif  // FSTREAM_READ_BUF_SIZE
 };
 //==============================================================================
 /**
@@ -88,7 +126,7 @@ class fstream : public iostream, FatStreamBase {
    *  to be written to the storage device.
    */
   void close() {
-    FatFile::close();
+    FatStreamBase::close();
   }
   /** Open a fstream
    * \param[in] path file to open
@@ -119,6 +157,21 @@ class fstream : public iostream, FatStreamBase {
   bool is_open() {
     return FatFile::isOpen();
   }
+#if USE_WRITE_BUFFER
+  /** Combine output in a user supplied buffer so whole blocks are written
+   * with multiple block writes.  Call after the file is opened for write.
+   * See FatFile::setWriteBuffer().
+   *
+   * \param[in] buf Buffer or null to stop use of a buffer.
+   * \param[in] size Size of \a buf in bytes, rounded down to a multiple
+   * of 512.
+   *
+   * \return true for success else false.
+   */
+  bool setWriteBuffer(void* buf, size_t size) {
+    return FatFile::setWriteBuffer(buf, size);
+  }
+#endif  // USE_WRITE_BUFFER
 
  protected:
   /// @cond SHOW_PROTECTED
@@ -132,7 +185,7 @@ class fstream : public iostream, FatStreamBase {
   * \param[out] pos
   */
   void getpos(FatPos_t* pos) {
-    FatFile::getpos(pos);
+    FatStreamBase::getpos(pos);
   }
   /** Internal - do not use
    * \param[in] c
@@ -156,7 +209,7 @@ class fstream : public iostream, FatStreamBase {
     return FatStreamBase::seekpos(pos);
   }
   void setpos(FatPos_t* pos) {
-    FatFile::setpos(pos);
+    FatStreamBase::setpos(pos);
   }
   bool sync() {
     return FatStreamBase::sync();
@@ -189,7 +242,7 @@ class ifstream : public istream, FatStreamBase {
    *  to be written to the storage device.
    */
   void close() {
-    FatFile::close();
+    FatStreamBase::close();
   }
   /** \return True if stream is open else false. */
   bool is_open() {
@@ -204,6 +257,31 @@ class ifstream : public istream, FatStreamBase {
   void open(const char* path, openmode mode = in) {
     FatStreamBase::open(path, mode | in);
   }
+  /** Read an array of numbers much faster than operator>>.
+   *
+   * See FatFile::readNumbers().  Sets failbit if fewer than \a count
+   * values are read and badbit if an error occurs.
+   *
+   * \param[out] value Array of int32_t or float for the numbers.
+   * \param[in] count Maximum number of values to read.
+   * \param[in] buf Optional scratch buffer, a small buffer on the stack
+   * is used if null.
+   * \param[in] size Size of \a buf.
+   *
+   * \return The number of values read or -1 if an error occurs.
+   */
+  template <typename T>
+  int readNumbers(T* value, size_t count, char* buf = 0, size_t size = 0) {
+    readDiscard();
+    int n = buf ? FatFile::readNumbers(value, count, buf, size)
+                : FatFile::readNumbers(value, count);
+    if (n < 0) {
+      setstate(badbit);
+    } else if ((size_t)n < count) {
+      setstate(failbit);
+    }
+    return n;
+  }
 
  protected:
   /// @cond SHOW_PROTECTED
@@ -217,7 +295,7 @@ class ifstream : public istream, FatStreamBase {
    * \param[out] pos
    */
   void getpos(FatPos_t* pos) {
-    FatFile::getpos(pos);
+    FatStreamBase::getpos(pos);
   }
   /** Internal - do not use
    * \param[in] pos
@@ -229,7 +307,7 @@ class ifstream : public istream, FatStreamBase {
     return FatStreamBase::seekpos(pos);
   }
   void setpos(FatPos_t* pos) {
-    FatFile::setpos(pos);
+    FatStreamBase::setpos(pos);
   }
   pos_type tellpos() {
     return FatStreamBase::curPosition();
@@ -265,7 +343,7 @@ class ofstream : public ostream, FatStreamBase {
    *  to be written to the storage device.
    */
   void close() {
-    FatFile::close();
+    FatStreamBase::close();
   }
   /** Open an ofstream
    * \param[in] path file to open
@@ -280,6 +358,21 @@ class ofstream : public ostream, FatStreamBase {
   bool is_open() {
     return FatFile::isOpen();
   }
+#if USE_WRITE_BUFFER
+  /** Combine output in a user supplied buffer so whole blocks are written
+   * with multiple block writes.  Call after the file is opened for write.
+   * See FatFile::setWriteBuffer().
+   *
+   * \param[in] buf Buffer or null to stop use of a buffer.
+   * \param[in] size Size of \a buf in bytes, rounded down to a multiple
+   * of 512.
+   *
+   * \return true for success else false.
+   */
+  bool setWriteBuffer(void* buf, size_t size) {
+    return FatFile::setWriteBuffer(buf, size);
+  }
+#endif  // USE_WRITE_BUFFER
 
  protected:
   /// @cond SHOW_PROTECTED